@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "concurrentunionfind.h"
+
+/* ============================================================================
+   ConcurrentUnionFind class
+
+   Anderson and Woll, "Wait-free parallel algorithms for the union-find
+   problem" (STOC 1991), with linking by index instead of by rank, which
+   needs no extra state to stay acyclic.
+   ============================================================================ */
+
+ConcurrentUnionFind::ConcurrentUnionFind(void) {}
+
+ConcurrentUnionFind::ConcurrentUnionFind(unsigned int size)
+{   Reset(size);    }
+
+/* ----------------------------------------------------------------------------
+   void ConcurrentUnionFind::Reset(unsigned int size);
+
+   Makes size elements, each its own component.  Must not run concurrently
+   with any other call.
+   ---------------------------------------------------------------------------- */
+void ConcurrentUnionFind::Reset(unsigned int size)
+{
+    // atomics cannot be moved, so the vector is rebuilt rather than resized
+    std::vector<std::atomic<unsigned int> > items(size);
+
+    if (items.size() != size)
+        throw UNIONFIND_ERR_OUTOFMEMORY;
+
+    for (unsigned int i = 0; i < size; i++)
+        items[i].store(i, std::memory_order_relaxed);
+
+    parent.swap(items);
+}
+
+/* ----------------------------------------------------------------------------
+   bool ConcurrentUnionFind::Join(unsigned int i, unsigned int j);
+
+   Links the root of the component with the larger root under the other
+   root.  Returns false if i and j were already in the same component.
+   ---------------------------------------------------------------------------- */
+bool ConcurrentUnionFind::Join(unsigned int i, unsigned int j)
+{
+    if ((i >= parent.size()) || (j >= parent.size()))
+        throw UNIONFIND_ERR_INDEXOUTOFRANGE;
+
+    while (true)
+    {
+        unsigned int ri = Find(i);
+        unsigned int rj = Find(j);
+
+        if (ri == rj)
+            return false;
+
+        if (ri < rj)
+            std::swap(ri, rj);
+
+        // ri may have been linked since Find() saw it as a root, then retry
+        unsigned int expected = ri;
+        if (parent[ri].compare_exchange_strong(expected, rj, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int ConcurrentUnionFind::Find(unsigned int i);
+
+   Returns the root of element i as of some moment during the call, pointing
+   each element on the way at its grandparent.
+   ---------------------------------------------------------------------------- */
+unsigned int ConcurrentUnionFind::Find(unsigned int i)
+{
+    if (i >= parent.size())
+        throw UNIONFIND_ERR_INDEXOUTOFRANGE;
+
+    while (true)
+    {
+        unsigned int p = parent[i].load(std::memory_order_acquire);
+        unsigned int gp = parent[p].load(std::memory_order_acquire);
+
+        if (p == gp)
+            return p;
+
+        // path splitting:  point i at its grandparent and go on from its old
+        // parent;  a failed CAS means another thread moved i up already, and
+        // leaves i's current parent in p
+        parent[i].compare_exchange_weak(p, gp, std::memory_order_acq_rel, std::memory_order_relaxed);
+        i = p;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   bool ConcurrentUnionFind::Same(unsigned int i, unsigned int j);
+
+   Returns true if i and j are in the same component.  With concurrent joins
+   the answer is correct for some moment during the call.
+   ---------------------------------------------------------------------------- */
+bool ConcurrentUnionFind::Same(unsigned int i, unsigned int j)
+{
+    while (true)
+    {
+        unsigned int ri = Find(i);
+        unsigned int rj = Find(j);
+
+        if (ri == rj)
+            return true;
+
+        // different roots, and ri still a root:  they were apart at this point
+        if (parent[ri].load(std::memory_order_acquire) == ri)
+            return false;
+    }
+}
+
+unsigned int ConcurrentUnionFind::Count(void)
+{   return parent.size();   }
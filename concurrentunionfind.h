@@ -0,0 +1,39 @@
+#ifndef _CONCURRENTUNIONFIND_H_
+#define _CONCURRENTUNIONFIND_H_
+
+#include <vector>
+#include <atomic>
+#include "unionfind.h"
+
+/* ============================================================================
+   ConcurrentUnionFind class
+
+   Union-find that many threads may join and query at once, without locks.
+   A root is always linked under a root with a smaller index, by a CAS on its
+   parent, so links never form a cycle and every component's root is its
+   smallest element.  Find() shortens the path it walks by path splitting:
+   each element visited is pointed at its grandparent, also with a CAS, which
+   may fail harmlessly when another thread got there first.
+
+   Joins are lock-free:  a Join() only retries when another thread's link
+   changed one of the two roots in the meantime.
+   ============================================================================ */
+class ConcurrentUnionFind {
+    public:
+    ConcurrentUnionFind(void);
+    ConcurrentUnionFind(unsigned int size);
+    void Reset(unsigned int size);              // not thread safe
+    bool Join(unsigned int i, unsigned int j);  // join elements i and j, false if already joined
+    unsigned int Find(unsigned int i);          // retrieve root of element i
+    bool Same(unsigned int i, unsigned int j);  // i and j are in the same component
+    unsigned int Count(void);                   // number of elements
+
+    private:
+    std::vector<std::atomic<unsigned int> > parent;
+
+    // no copies, atomics cannot be copied
+    ConcurrentUnionFind(const ConcurrentUnionFind &);
+    ConcurrentUnionFind &operator=(const ConcurrentUnionFind &);
+};
+
+#endif
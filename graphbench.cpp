@@ -0,0 +1,462 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "hexboard.h"
+#include "mingraph.hpp"
+#include "hexthreadpool.h"
+
+/* ============================================================================
+   graphbench
+
+   Connectivity benchmarks for MinGraph on large synthetic graphs.
+
+   usage:  graphbench [-vertices n] [-degree d] [-graph grid|random|all] [-queries n] [-threads n]
+
+   Graphs (default: both, 1000000 vertices):
+        grid        a square lattice with each edge kept with probability
+                    1/2, the percolation threshold, so there are many
+                    components of every size
+        random      uniformly random edges, d / 2 per vertex on average
+                    (default d = 3, well above the giant component threshold)
+
+   For each graph this reports:
+        haspath     time per MinGraph::HasPath query between random vertices
+        bfs         labelling every component with one BFS pass, serially
+        components  MinGraph::Components on a pool of 1 thread up to one per
+                    core (or -threads n), with the speedup over 1 thread
+        same        time per MinGraphComponents::Same query afterwards
+        search      MinGraph::BFS from one vertex to the whole graph on 1 to
+                    n threads, against a serial queue-based BFS, and how
+                    many of its levels went bottom-up
+        load        rebuilding the graph with AddEdge, against LoadEdges
+                    from binary and text edge lists and MinGraph::Load, on
+                    1 to n threads, and MinGraph::Save
+   The labels and distances are checked against the serial BFS, and the
+   loaded graphs against the generated one.
+   ============================================================================ */
+
+typedef MinGraph<char> BenchGraph;
+
+static double secondsSince(std::chrono::steady_clock::time_point t0)
+{   return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();   }
+
+// a side x side lattice, each edge kept with probability 1/2
+static void gridGraph(unsigned int nVertices, BenchGraph &G)
+{
+    unsigned int side = 1;
+    while ((side + 1) * (side + 1) <= nVertices)
+        side++;
+
+    G.Reset(side * side, 0);
+
+    for (unsigned int r = 0; r < side; r++)
+    {
+        for (unsigned int c = 0; c < side; c++)
+        {
+            unsigned int v = r * side + c;
+            if ((c + 1 < side) && (HexRandom(2) == 0)) G.AddEdge(v, v + 1);
+            if ((r + 1 < side) && (HexRandom(2) == 0)) G.AddEdge(v, v + side);
+        }
+    }
+}
+
+// nVertices vertices and nVertices * degree / 2 random edges (self loops skipped)
+static void randomGraph(unsigned int nVertices, double degree, BenchGraph &G)
+{
+    G.Reset(nVertices, 0);
+
+    unsigned long nEdges = (unsigned long) (nVertices * degree / 2);
+    for (unsigned long i = 0; i < nEdges; i++)
+    {
+        unsigned int u = HexRandom(nVertices), v = HexRandom(nVertices);
+        if (u != v)
+            G.AddEdge(u, v);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static unsigned int bfsLabels(BenchGraph &G, std::vector<VertexID> &label);
+
+   Labels each vertex with the smallest vertex of its component, by BFS from
+   every vertex not yet labelled in increasing order.  Returns the number of
+   components.
+   ---------------------------------------------------------------------------- */
+static unsigned int bfsLabels(BenchGraph &G, std::vector<VertexID> &label)
+{
+    const VertexID none = (VertexID) -1;
+    unsigned int nComponents = 0;
+    VertexIDSet neighbors;
+    std::queue<VertexID> Q;
+
+    label.assign(G.V(), none);
+
+    for (VertexID s = 0; s < (VertexID) G.V(); s++)
+    {
+        if (label[s] != none)
+            continue;
+
+        nComponents++;
+        label[s] = s;
+        Q.push(s);
+
+        while (!Q.empty())
+        {
+            VertexID x = Q.front();
+            Q.pop();
+
+            G.Neighbors(x, neighbors);
+            for (unsigned int i = 0; i < neighbors.size(); i++)
+            {
+                if (label[neighbors[i]] == none)
+                {
+                    label[neighbors[i]] = s;
+                    Q.push(neighbors[i]);
+                }
+            }
+        }
+    }
+
+    return nComponents;
+}
+
+/* ----------------------------------------------------------------------------
+   static void queueDistances(BenchGraph &G, VertexID source, std::vector<unsigned int> &dist);
+
+   Distances from source by a plain queue-based BFS, MINGRAPH_UNREACHED for
+   vertices in other components.
+   ---------------------------------------------------------------------------- */
+static void queueDistances(BenchGraph &G, VertexID source, std::vector<unsigned int> &dist)
+{
+    VertexIDSet neighbors;
+    std::queue<VertexID> Q;
+
+    dist.assign(G.V(), MINGRAPH_UNREACHED);
+    dist[source] = 0;
+    Q.push(source);
+
+    while (!Q.empty())
+    {
+        VertexID x = Q.front();
+        Q.pop();
+
+        G.Neighbors(x, neighbors);
+        for (unsigned int i = 0; i < neighbors.size(); i++)
+        {
+            if (dist[neighbors[i]] == MINGRAPH_UNREACHED)
+            {
+                dist[neighbors[i]] = dist[x] + 1;
+                Q.push(neighbors[i]);
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static double poolSeconds(unsigned int nThreads, std::function<void(HexThreadPool &)> work);
+
+   Runs work on a pool of nThreads workers, from a pool task so that exactly
+   nThreads threads work, and returns the seconds it took.
+   ---------------------------------------------------------------------------- */
+static double poolSeconds(unsigned int nThreads, std::function<void(HexThreadPool &)> work)
+{
+    HexThreadPool pool(nThreads);
+    double seconds = 0;
+
+    pool.Submit([&]() {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        work(pool);
+        seconds = secondsSince(t0);
+    });
+
+    pool.Wait();
+    return seconds;
+}
+
+// true if G and H have the same vertices and the same neighbors, in any order
+static bool sameGraph(BenchGraph &G, BenchGraph &H)
+{
+    VertexIDSet a, b;
+
+    if (G.V() != H.V())
+        return false;
+
+    for (VertexID v = 0; v < (VertexID) G.V(); v++)
+    {
+        G.Neighbors(v, a);
+        H.Neighbors(v, b);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        if (a != b)
+            return false;
+    }
+
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   static bool benchLoad(BenchGraph &G, unsigned int maxThreads);
+
+   Times building G again with AddEdge, with LoadEdges from binary and text
+   edge lists, and with Save and Load, through files in the current
+   directory that are removed afterwards.  Returns false if a loaded graph
+   differs from G.
+   ---------------------------------------------------------------------------- */
+static bool benchLoad(BenchGraph &G, unsigned int maxThreads)
+{
+    const char *binaryFile = "graphbench.edges", *textFile = "graphbench.txt", *graphFile = "graphbench.graph";
+    std::vector<uint32_t> ends;
+    VertexIDSet neighbors;
+
+    for (VertexID u = 0; u < (VertexID) G.V(); u++)
+    {
+        G.Neighbors(u, neighbors);
+        for (unsigned int i = 0; i < neighbors.size(); i++)
+        {
+            if (neighbors[i] > u)
+            {
+                ends.push_back(u);
+                ends.push_back(neighbors[i]);
+            }
+        }
+    }
+
+    FILE *f = fopen(binaryFile, "wb");
+    if ((f == (FILE *)0) || (fwrite(ends.data(), sizeof(uint32_t), ends.size(), f) != ends.size()) || (fclose(f) != 0))
+    {
+        std::cout << "  load         cannot write " << binaryFile << "\n\n";
+        return true;
+    }
+
+    std::ofstream text(textFile);
+    text << "# " << G.V() << " vertices\n";
+    for (size_t i = 0; i < ends.size(); i += 2)
+        text << ends[i] << ' ' << ends[i + 1] << '\n';
+    text.close();
+
+    BenchGraph H;
+    bool ok = true;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    H.Reset(G.V(), 0);
+    for (size_t i = 0; i < ends.size(); i += 2)
+        H.AddEdge(ends[i], ends[i + 1]);
+    std::cout << "  load         addedge       " << std::setprecision(2) << 1000.0 * secondsSince(t0) << " ms\n"
+              << "  load         threads    binary ms   text ms   save ms   load ms\n";
+
+    for (unsigned int nThreads = 1; nThreads <= maxThreads; nThreads++)
+    {
+        double binary = poolSeconds(nThreads, [&](HexThreadPool &pool) {
+            ok = H.LoadEdges(binaryFile, MINGRAPH_EDGES_BINARY, G.V(), &pool) && ok;
+        });
+        ok = ok && sameGraph(G, H);
+
+        double parsed = poolSeconds(nThreads, [&](HexThreadPool &pool) {
+            ok = H.LoadEdges(textFile, MINGRAPH_EDGES_TEXT, G.V(), &pool) && ok;
+        });
+        ok = ok && sameGraph(G, H);
+
+        t0 = std::chrono::steady_clock::now();
+        H.Save(graphFile);
+        double saved = secondsSince(t0);
+
+        double loaded = poolSeconds(nThreads, [&](HexThreadPool &pool) { ok = H.Load(graphFile, &pool) && ok; });
+        ok = ok && sameGraph(G, H);
+
+        std::cout << "             " << std::setw(8) << nThreads
+                  << std::setw(13) << 1000.0 * binary << std::setw(10) << 1000.0 * parsed
+                  << std::setw(10) << 1000.0 * saved << std::setw(10) << 1000.0 * loaded << "\n" << std::flush;
+    }
+
+    remove(binaryFile);
+    remove(textFile);
+    remove(graphFile);
+
+    std::cout << "  loaded       " << (ok ? "match" : "DIFFER from") << " the generated graph\n\n";
+    return ok;
+}
+
+/* ----------------------------------------------------------------------------
+   static bool benchGraph(const char *name, BenchGraph &G, unsigned int nQueries, unsigned int maxThreads);
+
+   Runs every measurement on G, with 1 to maxThreads threads for the
+   parallel ones.  Returns false if labels or distances did not match the
+   serial BFS, or a loaded graph did not match G.
+   ---------------------------------------------------------------------------- */
+static bool benchGraph(const char *name, BenchGraph &G, unsigned int nQueries, unsigned int maxThreads)
+{
+    unsigned int n = G.V();
+    unsigned long nEdges = 0;
+    VertexIDSet neighbors;
+
+    for (VertexID v = 0; v < n; v++)
+    {
+        G.Neighbors(v, neighbors);
+        nEdges += neighbors.size();
+    }
+    nEdges /= 2;
+
+    std::vector<VertexID> from(nQueries), to(nQueries);
+    for (unsigned int i = 0; i < nQueries; i++)
+    {
+        from[i] = HexRandom(n);
+        do { to[i] = HexRandom(n); } while (to[i] == from[i]);
+    }
+
+    std::cout << name << ": " << n << " vertices, " << nEdges << " edges\n" << std::fixed;
+
+    // a few HasPath queries are enough to show their cost
+    unsigned int nPathQueries = std::min(nQueries, 10u), nConnected = 0;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < nPathQueries; i++)
+        nConnected += G.HasPath(from[i], to[i]);
+    std::cout << "  haspath      " << std::setprecision(3) << 1000.0 * secondsSince(t0) / nPathQueries
+              << " ms/query (" << nConnected << " of " << nPathQueries << " connected)\n";
+
+    std::vector<VertexID> label;
+    t0 = std::chrono::steady_clock::now();
+    unsigned int nComponents = bfsLabels(G, label);
+    double bfs = secondsSince(t0);
+    std::cout << "  bfs          " << std::setprecision(3) << 1000.0 * bfs << " ms, " << nComponents << " components\n"
+              << "  components   threads        ms   speedup   vs bfs   Medges/s\n";
+
+    MinGraphComponents cc;
+    double base = 0;
+
+    for (unsigned int nThreads = 1; nThreads <= maxThreads; nThreads++)
+    {
+        double seconds = poolSeconds(nThreads, [&](HexThreadPool &pool) { G.Components(cc, false, &pool); });
+        if (nThreads == 1)
+            base = seconds;
+
+        std::cout << "             " << std::setw(8) << nThreads
+                  << std::setw(10) << std::setprecision(2) << 1000.0 * seconds
+                  << std::setw(10) << base / seconds
+                  << std::setw(9) << bfs / seconds
+                  << std::setw(11) << nEdges / seconds / 1e6 << "\n" << std::flush;
+    }
+
+    bool ok = (cc.Count() == nComponents);
+    for (VertexID v = 0; ok && (v < n); v++)
+        ok = (cc.Component(v) == label[v]);
+
+    t0 = std::chrono::steady_clock::now();
+    nConnected = 0;
+    for (unsigned int i = 0; i < nQueries; i++)
+        nConnected += cc.Same(from[i], to[i]);
+    std::cout << "  same         " << std::setprecision(1) << 1e9 * secondsSince(t0) / nQueries
+              << " ns/query (" << nConnected << " of " << nQueries << " connected)\n"
+              << "  labels       " << (ok ? "match bfs" : "DIFFER from bfs") << "\n";
+
+    // search from the source of the first query, which tends to be in the largest component
+    std::vector<unsigned int> dist;
+    t0 = std::chrono::steady_clock::now();
+    queueDistances(G, from[0], dist);
+    bfs = secondsSince(t0);
+    std::cout << "  search       serial queue " << std::setprecision(3) << 1000.0 * bfs << " ms\n"
+              << "  search       threads        ms   speedup   vs bfs   levels   bottom-up\n";
+
+    MinGraphBFS search;
+    bool distOk = true;
+
+    for (unsigned int nThreads = 1; nThreads <= maxThreads; nThreads++)
+    {
+        double seconds = poolSeconds(nThreads, [&](HexThreadPool &pool) { G.BFS(from[0], search, false, &pool); });
+        if (nThreads == 1)
+            base = seconds;
+
+        for (VertexID v = 0; distOk && (v < n); v++)
+            distOk = (search.Distance(v) == dist[v]);
+
+        std::cout << "             " << std::setw(8) << nThreads
+                  << std::setw(10) << std::setprecision(2) << 1000.0 * seconds
+                  << std::setw(10) << base / seconds
+                  << std::setw(9) << bfs / seconds
+                  << std::setw(9) << search.Levels()
+                  << std::setw(12) << search.BottomUpLevels() << "\n" << std::flush;
+    }
+
+    std::cout << "  distances    " << (distOk ? "match bfs" : "DIFFER from bfs") << " (" << search.Count()
+              << " reached)\n";
+
+    return benchLoad(G, maxThreads) && ok && distOk;
+}
+
+static void usage(void)
+{
+    std::cout << "usage: graphbench [-vertices n] [-degree d] [-graph grid|random|all] [-queries n] [-threads n]\n";
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int nVertices = 1000000, nQueries = 1000000;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    double degree = 3.0;
+    std::string graph = "all";
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        if (iArg + 1 >= argc)
+            usage();
+
+        const char *opt = argv[iArg++];
+        std::istringstream ss(argv[iArg]);
+
+        if (!strcmp(opt, "-vertices"))
+        {
+            ss >> nVertices;
+            if (ss.fail() || (nVertices < 2)) usage();
+        }
+        else if (!strcmp(opt, "-degree"))
+        {
+            ss >> degree;
+            if (ss.fail() || (degree < 0)) usage();
+        }
+        else if (!strcmp(opt, "-queries"))
+        {
+            ss >> nQueries;
+            if (ss.fail() || (nQueries == 0)) usage();
+        }
+        else if (!strcmp(opt, "-threads"))
+        {
+            ss >> maxThreads;
+            if (ss.fail() || (maxThreads == 0)) usage();
+        }
+        else if (!strcmp(opt, "-graph"))
+        {
+            graph = argv[iArg];
+            if ((graph != "grid") && (graph != "random") && (graph != "all")) usage();
+        }
+        else
+            usage();
+    }
+
+    HexRandomSeed(12345);
+    bool ok = true;
+
+    if ((graph == "grid") || (graph == "all"))
+    {
+        BenchGraph G;
+        gridGraph(nVertices, G);
+        ok = benchGraph("grid", G, nQueries, maxThreads) && ok;
+    }
+
+    if ((graph == "random") || (graph == "all"))
+    {
+        BenchGraph G;
+        randomGraph(nVertices, degree, G);
+        ok = benchGraph("random", G, nQueries, maxThreads) && ok;
+    }
+
+    return (ok ? 0 : 2);
+}
@@ -0,0 +1,403 @@
+#ifndef _HEXABPLAYER_HPP_
+#define _HEXABPLAYER_HPP_
+
+#include <stdint.h>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include "hexboard.h"
+#include "hexpattern.h"
+#include "hexeval.h"
+#include "hextrace.h"
+
+/* ============================================================================
+   HexABPlayer class
+
+   Implements an automatic Hex player that searches the game tree with
+   alpha-beta (negamax), scoring the leaves with a static HexEvaluator
+   (two-distance by default, or circuit resistance) instead of rollouts.
+
+   The search deepens iteratively, one ply at a time, until the time limit
+   or the maximum depth is reached;  an iteration cut short by the time
+   limit is discarded, and the move of the deepest complete one is played.
+   A new iteration is not started once half of the time is spent, since it
+   would hardly ever complete.
+
+   At the root, dead and captured cells are filled in and only the pattern
+   engine's candidates are searched, as in HexMCPlayer.  Inner nodes search
+   the blank cells in the order of the evaluator's priorities (cells on the
+   shortest two-distance paths of either side first), and only the first
+   few of them:  the search is selective, so a score saying that a side
+   wins means it wins against the replies considered.  The best move of the
+   previous iteration is searched first, and a transposition table keeps
+   scores and best moves across iterations and moves.
+
+   Wins score HEXEVAL_WIN minus the number of moves to them, so that the
+   quickest win (and the slowest loss) is preferred;  the search stops as
+   soon as an iteration finds a win.
+   ============================================================================ */
+typedef struct structHexABStats {
+    unsigned long nodes;        // positions searched, over all iterations
+    unsigned int  depth;        // depth of the deepest complete iteration
+    int           score;        // score of the move played, for the mover
+    bool          timeout;      // an iteration was cut short by the time limit
+} HexABStats;
+
+typedef enum enumHexABBound {
+    HEXAB_EXACT,
+    HEXAB_LOWER,                // score is at least the stored one
+    HEXAB_UPPER                 // score is at most the stored one
+} HexABBound;
+
+typedef struct structHexABEntry {
+    uint64_t       key;         // 0 if unused
+    int            score;       // wins as moves from this position
+    unsigned short move;        // best cell found, HEXAB_NOMOVE if none
+    unsigned char  depth;
+    unsigned char  bound;       // HexABBound
+} HexABEntry;
+
+const unsigned int HEXAB_TABLESIZE = 1 << 18;   // transposition table entries, a power of 2
+const unsigned int HEXAB_MAXDEPTH = 64;
+const unsigned short HEXAB_NOMOVE = 0xFFFF;
+
+// scores beyond this are wins (or losses), counted in moves
+const int HEXAB_WON = HEXEVAL_WIN - 1000;
+
+class HexABPlayer : public HexPlayer {
+    public:
+    HexABPlayer(double seconds=1.0);
+    void SetEvaluator(HexEvaluator *e);
+    bool SetOption(const char *optname, bool optval);
+    void SetTimeLimit(double seconds);
+    void SetMaxDepth(unsigned int depth);
+    void SetWidth(unsigned int w);
+    HexABStats GetStats(void);
+    virtual const char *Name(void) { return "ab"; }
+
+    private:
+    virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+    int search(HexColor turn, unsigned int depth, unsigned int ply, int alpha, int beta);
+    void orderMoves(std::vector<unsigned int> &moves, const std::vector<int> &priority, unsigned int first);
+    uint64_t key(HexColor turn);
+    void play(unsigned int iCell, HexColor color);
+    void reset(unsigned int n);
+
+    HexPatternEngine patterns;
+    HexTwoDistance   twoDistance;
+    HexResistance    resistance;
+    HexEvaluator     *evaluator;
+    double           timeLimit;         // seconds per move
+    unsigned int     maxDepth;
+    unsigned int     width;             // moves searched at inner nodes
+    HexABStats       stats;
+
+    unsigned int     size;
+    HexCellColors    cells;             // position being searched
+    uint64_t         hash;              // of cells
+    std::vector<uint64_t> zobrist;      // per cell, blue then red;  then red to move
+    std::vector<HexABEntry> table;
+    std::vector<std::vector<int> > priorities;          // per ply
+    std::vector<std::vector<unsigned int> > moves;      // per ply
+    std::chrono::steady_clock::time_point deadline;
+    bool             aborted;           // the time limit was reached during this iteration
+};
+
+HexABPlayer::HexABPlayer(double seconds)
+{
+    evaluator = &twoDistance;
+    timeLimit = seconds;
+    maxDepth = HEXAB_MAXDEPTH;
+    width = 12;
+    size = 0;
+    hash = 0;
+    aborted = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+// score leaves with the given evaluator instead of two-distance (caller retains ownership)
+void HexABPlayer::SetEvaluator(HexEvaluator *e)
+{
+    evaluator = ((e == (HexEvaluator *)0) ? &twoDistance : e);
+    std::fill(table.begin(), table.end(), HexABEntry());
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexABPlayer::SetOption(const char *optname, bool optval)
+   Sets the value of a boolean option, returns true if successful
+
+   Options:
+    resistance: score leaves by circuit resistance instead of two-distance
+                (default off)
+   ---------------------------------------------------------------------------- */
+bool HexABPlayer::SetOption(const char *optname, bool optval)
+{
+    if (!strcmp(optname, "resistance"))
+    {
+        SetEvaluator(optval ? (HexEvaluator *) &resistance : (HexEvaluator *) &twoDistance);
+        return true;
+    }
+
+    return false;
+}
+
+// limit the search of each move to about the given number of seconds
+void HexABPlayer::SetTimeLimit(double seconds)
+{   timeLimit = seconds;    }
+
+// search at most the given number of plies (at most HEXAB_MAXDEPTH)
+void HexABPlayer::SetMaxDepth(unsigned int depth)
+{   maxDepth = std::max(1u, std::min(depth, HEXAB_MAXDEPTH));  }
+
+// search only the given number of moves at inner nodes, best first
+void HexABPlayer::SetWidth(unsigned int w)
+{   width = std::max(1u, w);    }
+
+// return counters describing the most recent move
+HexABStats HexABPlayer::GetStats(void)
+{   return stats;   }
+
+void HexABPlayer::Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col)
+{
+    HEXTRACE_SCOPE("ab.move");
+    memset(&stats, 0, sizeof(stats));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeLimit));
+
+    // fill in dead and captured cells, and search only the live candidates
+    HexBoard pruned(board);
+    patterns.FillIn(pruned);
+
+    HexCellSet candidates;
+    patterns.Candidates(pruned, turn, candidates);
+
+    // if fill-in already decided the game, any open cell will do
+    if (candidates.size() == 0)
+    {
+        unsigned int idPlay;
+        HexMoveGenerator open(board);
+        open.Next(idPlay, row, col);
+        return;
+    }
+
+    if (board.Size() != size)
+        reset(board.Size());
+
+    GetCellColors(pruned, cells);
+    hash = 0;
+    unsigned int nBlank = 0;
+    for (unsigned int i = 0; i < cells.size(); i++)
+    {
+        if (cells[i] == HEXBLANK)
+            nBlank++;
+        else
+            hash ^= zobrist[2 * i + ((cells[i] == HEXBLUE) ? 0 : 1)];
+    }
+
+    // root moves, ordered by the evaluator
+    std::vector<unsigned int> &rootMoves = moves[0];
+    rootMoves.clear();
+    for (unsigned int i = 0; i < candidates.size(); i++)
+        rootMoves.push_back(candidates[i].row * size + candidates[i].col);
+
+    evaluator->Evaluate(cells, size, turn, &priorities[0]);
+    orderMoves(rootMoves, priorities[0], HEXAB_NOMOVE);
+
+    HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+    unsigned int bestMove = rootMoves[0];
+    int bestScore = 0;
+    aborted = false;
+
+    for (unsigned int depth = 1; (depth <= maxDepth) && (depth <= nBlank); depth++)
+    {
+        HEXTRACE_SCOPE("ab.iteration", depth);
+
+        // search the previous iteration's best move first
+        std::vector<unsigned int>::iterator it = std::find(rootMoves.begin(), rootMoves.end(), bestMove);
+        std::rotate(rootMoves.begin(), it, it + 1);
+
+        int alpha = -HEXEVAL_WIN - 1;
+        unsigned int iterationMove = rootMoves[0];
+
+        for (unsigned int i = 0; (i < rootMoves.size()) && !aborted; i++)
+        {
+            play(rootMoves[i], turn);
+            int score = -search(opponent, depth - 1, 1, -HEXEVAL_WIN - 1, -alpha);
+            play(rootMoves[i], HEXBLANK);
+
+            if (!aborted && (score > alpha))
+            {
+                alpha = score;
+                iterationMove = rootMoves[i];
+            }
+        }
+
+        if (aborted)
+        {
+            stats.timeout = true;
+            break;
+        }
+
+        bestMove = iterationMove;
+        bestScore = alpha;
+        stats.depth = depth;
+
+        // a win needs no deeper search, and the next iteration would not finish in time
+        if ((bestScore > HEXAB_WON) ||
+            (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= timeLimit / 2))
+            break;
+    }
+
+    stats.score = bestScore;
+    row = bestMove / size;
+    col = bestMove % size;
+}
+
+/* ----------------------------------------------------------------------------
+   int HexABPlayer::search(HexColor turn, unsigned int depth, unsigned int ply, int alpha, int beta);
+
+   Negamax alpha-beta search of cells, with turn to move, depth plies deep;
+   ply is the distance from the root.  Returns the score for turn (fail
+   soft), or 0 once the time limit is reached, after setting aborted.
+   ---------------------------------------------------------------------------- */
+int HexABPlayer::search(HexColor turn, unsigned int depth, unsigned int ply, int alpha, int beta)
+{
+    // check the clock every 256 nodes
+    if ((++stats.nodes & 0xFF) == 0 && (std::chrono::steady_clock::now() >= deadline))
+        aborted = true;
+    if (aborted)
+        return 0;
+
+    // positions in the table were searched before, and are not won
+    uint64_t k = key(turn);
+    HexABEntry &entry = table[k & (HEXAB_TABLESIZE - 1)];
+    unsigned int tableMove = HEXAB_NOMOVE;
+
+    if (entry.key == k)
+    {
+        tableMove = entry.move;
+
+        if (entry.depth >= depth)
+        {
+            int score = entry.score;
+            if (score > HEXAB_WON) score -= ply;
+            else if (score < -HEXAB_WON) score += ply;
+
+            if ((entry.bound == HEXAB_EXACT) ||
+                ((entry.bound == HEXAB_LOWER) && (score >= beta)) ||
+                ((entry.bound == HEXAB_UPPER) && (score <= alpha)))
+                return score;
+        }
+    }
+
+    std::vector<int> &priority = priorities[ply];
+    int eval = evaluator->Evaluate(cells, size, turn, (depth > 0) ? &priority : (std::vector<int> *)0);
+
+    if (eval >= HEXEVAL_WIN)
+        return HEXEVAL_WIN - ply;
+    if (eval <= -HEXEVAL_WIN)
+        return -(HEXEVAL_WIN - ply);
+    if (depth == 0)
+        return eval;
+
+    // the most urgent blank cells, the table's move first
+    std::vector<unsigned int> &list = moves[ply];
+    list.clear();
+    for (unsigned int i = 0; i < cells.size(); i++)
+        if (cells[i] == HEXBLANK)
+            list.push_back(i);
+
+    orderMoves(list, priority, tableMove);
+    if (list.size() > width)
+        list.resize(width);
+
+    HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+    int alpha0 = alpha;
+    int best = -HEXEVAL_WIN - 1;
+    unsigned int bestMove = list[0];
+
+    for (unsigned int i = 0; i < list.size(); i++)
+    {
+        play(list[i], turn);
+        int score = -search(opponent, depth - 1, ply + 1, -beta, -alpha);
+        play(list[i], HEXBLANK);
+
+        if (aborted)
+            return 0;
+
+        if (score > best)
+        {
+            best = score;
+            bestMove = list[i];
+
+            if (score > alpha)
+                alpha = score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    // wins are stored as moves from this position, not from the root
+    entry.key = k;
+    entry.score = best;
+    if (best > HEXAB_WON) entry.score += ply;
+    else if (best < -HEXAB_WON) entry.score -= ply;
+    entry.move = bestMove;
+    entry.depth = depth;
+    entry.bound = ((best <= alpha0) ? HEXAB_UPPER : ((best >= beta) ? HEXAB_LOWER : HEXAB_EXACT));
+
+    return best;
+}
+
+// sort moves by decreasing priority, keeping first (if among them) in front
+void HexABPlayer::orderMoves(std::vector<unsigned int> &moves, const std::vector<int> &priority, unsigned int first)
+{
+    std::stable_sort(moves.begin(), moves.end(), [&](unsigned int a, unsigned int b) {
+        return priority[a] > priority[b];
+    });
+
+    std::vector<unsigned int>::iterator it = std::find(moves.begin(), moves.end(), first);
+    if (it != moves.end())
+        std::rotate(moves.begin(), it, it + 1);
+}
+
+// transposition table key of cells with turn to move
+uint64_t HexABPlayer::key(HexColor turn)
+{   return ((turn == HEXRED) ? (hash ^ zobrist[2 * size * size]) : hash);   }
+
+// set a cell of the position being searched to color (HEXBLANK to undo a move)
+void HexABPlayer::play(unsigned int iCell, HexColor color)
+{
+    HexColor old = ((color == HEXBLANK) ? cells[iCell] : color);
+    hash ^= zobrist[2 * iCell + ((old == HEXBLUE) ? 0 : 1)];
+    cells[iCell] = color;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexABPlayer::reset(unsigned int n);
+
+   Sizes the search for a board of n x n cells:  draws the hash keys (from a
+   fixed seed, so that searches are reproducible) and clears the table.
+   ---------------------------------------------------------------------------- */
+void HexABPlayer::reset(unsigned int n)
+{
+    size = n;
+
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    zobrist.resize(2 * n * n + 1);
+    for (unsigned int i = 0; i < zobrist.size(); i++)
+    {
+        // splitmix64
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        zobrist[i] = z ^ (z >> 31);
+    }
+
+    table.assign(HEXAB_TABLESIZE, HexABEntry());
+    priorities.resize(HEXAB_MAXDEPTH + 1);
+    moves.resize(HEXAB_MAXDEPTH + 1);
+}
+
+#endif
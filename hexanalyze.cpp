@@ -0,0 +1,348 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include "hexboard.h"
+#include "hexrecord.h"
+#include "hexthreadpool.h"
+#include "hexmcplayer.hpp"
+
+/* ============================================================================
+   hexanalyze
+
+   Estimates win rates for many positions at once, spreading the positions
+   over a pool of worker threads.
+
+   usage:  hexanalyze [-trials n] [-threads n] [-policy bridge|random] [file]
+           hexanalyze [-trials n] [-threads n] [-policy bridge|random] -records file
+
+   Positions are read from file, or from stdin if there is no file (or it is
+   "-"), one per line:
+
+        <size> <turn> <cells>
+
+   where turn is B (blue) or R (red) and cells lists the size * size cells
+   row by row as '.' (blank), 'O' (blue) or 'X' (red), as HexGameIO prints
+   them.  Blank lines and lines starting with '#' are skipped.  With
+   -records, every position reached in the games of a record file (before
+   each move) is analyzed instead.
+
+   For every position, each blank cell is evaluated with the given number of
+   rollouts (default 1000) for the player to move.  One JSON object is
+   written per position, in input order, as soon as it and all earlier
+   positions are done:
+
+        {"id": 0, "size": 3, "turn": "BLUE", "best": [1, 1], "winrate": 0.81,
+         "rates": [[0.52, ...], ...]}
+
+   Occupied cells have a rate of -1.  A position that cannot be parsed gets
+   {"id": n, "error": "..."} instead.
+   ============================================================================ */
+
+typedef struct structAnalyzeOptions {
+    unsigned int trials;
+    unsigned int threads;
+    bool bridge;                        // bridge rollouts rather than random
+} AnalyzeOptions;
+
+/* ----------------------------------------------------------------------------
+   OrderedOutput class
+
+   Results finish in any order;  this holds each one until all earlier ones
+   have been written, so the output stream follows the input.
+   ---------------------------------------------------------------------------- */
+class OrderedOutput {
+    public:
+    OrderedOutput(void) : next(0) {}
+    void Write(unsigned long id, const std::string &line);
+
+    private:
+    std::mutex lock;
+    std::map<unsigned long, std::string> waiting;
+    unsigned long next;
+};
+
+void OrderedOutput::Write(unsigned long id, const std::string &line)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    waiting[id] = line;
+    while (!waiting.empty() && (waiting.begin()->first == next))
+    {
+        std::cout << waiting.begin()->second;
+        waiting.erase(waiting.begin());
+        next++;
+    }
+    std::cout << std::flush;
+}
+
+/* ----------------------------------------------------------------------------
+   static bool parsePosition(const std::string &line, HexBoard &board, HexColor &turn,
+                             std::string &error);
+
+   Reads a position in the input format described above.  Returns false,
+   with a message in error, if the line is not a valid position.
+   ---------------------------------------------------------------------------- */
+static bool parsePosition(const std::string &line, HexBoard &board, HexColor &turn, std::string &error)
+{
+    std::istringstream ss(line);
+    unsigned int size;
+    std::string sTurn, cells;
+
+    ss >> size >> sTurn >> cells;
+    if (ss.fail())
+    {
+        error = "expected: size turn cells";
+        return false;
+    }
+
+    if ((size < HEXMINSIZE) || (size > HEXMAXSIZE))
+    {
+        error = "invalid board size";
+        return false;
+    }
+
+    if ((sTurn != "B") && (sTurn != "R"))
+    {
+        error = "turn must be B or R";
+        return false;
+    }
+
+    if (cells.size() != size * size)
+    {
+        error = "expected size * size cells";
+        return false;
+    }
+
+    turn = ((sTurn == "B") ? HEXBLUE : HEXRED);
+    board = HexBoard(size);
+
+    for (unsigned int i = 0; i < cells.size(); i++)
+    {
+        if (cells[i] == 'O')
+            board.SetColor(i / size, i % size, HEXBLUE);
+        else if (cells[i] == 'X')
+            board.SetColor(i / size, i % size, HEXRED);
+        else if (cells[i] != '.')
+        {
+            error = "cells must be '.', 'O' or 'X'";
+            return false;
+        }
+    }
+
+    if (board.Winner() != HEXBLANK)
+    {
+        error = "game is already over";
+        return false;
+    }
+
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   static void analyze(unsigned long id, std::string line, AnalyzeOptions &opt, OrderedOutput &out);
+
+   Worker task:  evaluates every blank cell of one position and writes the
+   result.
+   ---------------------------------------------------------------------------- */
+static void analyze(unsigned long id, std::string line, AnalyzeOptions &opt, OrderedOutput &out)
+{
+    std::ostringstream result;
+    HexBoard board(HEXMINSIZE);
+    HexColor turn = HEXBLUE;
+    std::string error;
+
+    if (!parsePosition(line, board, turn, error))
+    {
+        result << "{\"id\": " << id << ", \"error\": \"" << error << "\"}\n";
+        out.Write(id, result.str());
+        return;
+    }
+
+    HexRolloutPolicy randomPolicy;
+    HexBridgePolicy bridgePolicy;
+    HexRolloutPolicy &policy = (opt.bridge ? (HexRolloutPolicy &) bridgePolicy : randomPolicy);
+
+    unsigned int n = board.Size();
+    std::vector<double> rates(n * n, -1.0);
+    int bestScore = -1;
+    unsigned int bestRow = 0, bestCol = 0, nRun;
+
+    for (unsigned int row = 0; row < n; row++)
+    {
+        for (unsigned int col = 0; col < n; col++)
+        {
+            if (board.GetColor(row, col) != HEXBLANK)
+                continue;
+
+            // no cutoff:  every cell gets its full budget, so that rates are comparable
+            int score = EvaluateMove(board, turn, row, col, opt.trials, -1, policy, nRun);
+            rates[row * n + col] = ((double) score) / opt.trials;
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestRow = row;
+                bestCol = col;
+            }
+        }
+    }
+
+    result << "{\"id\": " << id << ", \"size\": " << n
+           << ", \"turn\": \"" << ((turn == HEXBLUE) ? "BLUE" : "RED") << "\""
+           << ", \"best\": [" << bestRow << ", " << bestCol << "]"
+           << ", \"winrate\": " << ((double) bestScore) / opt.trials
+           << ", \"rates\": [";
+
+    for (unsigned int row = 0; row < n; row++)
+    {
+        result << ((row > 0) ? ", [" : "[");
+        for (unsigned int col = 0; col < n; col++)
+            result << ((col > 0) ? ", " : "") << rates[row * n + col];
+        result << "]";
+    }
+
+    result << "]}\n";
+    out.Write(id, result.str());
+}
+
+/* ----------------------------------------------------------------------------
+   static bool recordPositions(const char *filename, std::vector<std::string> &lines);
+
+   Converts every position reached in a record file (before each move) to an
+   input line.  Returns false if the file cannot be read.
+   ---------------------------------------------------------------------------- */
+static bool recordPositions(const char *filename, std::vector<std::string> &lines)
+{
+    HexRecordReader reader;
+    HexGameRecord game;
+
+    if (!reader.Open(filename))
+        return false;
+
+    while (reader.Next(game))
+    {
+        unsigned int n = game.Size();
+        std::string cells(n * n, '.');
+
+        for (unsigned int i = 0; i < game.Moves(); i++)
+        {
+            std::ostringstream ss;
+            ss << n << " " << ((game.Color(i) == HEXBLUE) ? "B" : "R") << " " << cells;
+            lines.push_back(ss.str());
+
+            unsigned int row, col;
+            game.Move(i, row, col);
+            cells[row * n + col] = ((game.Color(i) == HEXBLUE) ? 'O' : 'X');
+        }
+    }
+
+    return true;
+}
+
+static void usage(void)
+{
+    std::cout << "usage: hexanalyze [-trials n] [-threads n] [-policy bridge|random] [file]\n"
+              << "       hexanalyze [-trials n] [-threads n] [-policy bridge|random] -records file\n";
+    exit(1);
+}
+
+static unsigned int readArg(int argc, char *argv[], int &iArg)
+{
+    if (++iArg >= argc)
+        usage();
+
+    std::istringstream ss(argv[iArg]);
+    unsigned int t;
+    ss >> t;
+    if (ss.fail())
+        usage();
+
+    return t;
+}
+
+int main(int argc, char *argv[])
+{
+    AnalyzeOptions opt;
+    opt.trials = 1000;
+    opt.threads = 0;
+    opt.bridge = true;
+
+    const char *filename = (const char *)0;
+    const char *records = (const char *)0;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        if (!strcmp(argv[iArg], "-trials"))         opt.trials = readArg(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-threads"))   opt.threads = readArg(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-policy"))
+        {
+            if (++iArg >= argc) usage();
+            if (!strcmp(argv[iArg], "bridge"))      opt.bridge = true;
+            else if (!strcmp(argv[iArg], "random")) opt.bridge = false;
+            else usage();
+        }
+        else if (!strcmp(argv[iArg], "-records"))
+        {
+            if (++iArg >= argc) usage();
+            records = argv[iArg];
+        }
+        else if ((filename == (const char *)0) && ((argv[iArg][0] != '-') || !strcmp(argv[iArg], "-")))
+            filename = argv[iArg];
+        else
+            usage();
+    }
+
+    if ((opt.trials == 0) || ((records != (const char *)0) && (filename != (const char *)0)))
+        usage();
+
+    std::vector<std::string> recordLines;
+    if ((records != (const char *)0) && !recordPositions(records, recordLines))
+    {
+        std::cout << "could not read " << records << "\n";
+        return 1;
+    }
+
+    std::ifstream file;
+    if ((filename != (const char *)0) && strcmp(filename, "-"))
+    {
+        file.open(filename);
+        if (!file)
+        {
+            std::cout << "could not read " << filename << "\n";
+            return 1;
+        }
+    }
+    std::istream &in = (file.is_open() ? (std::istream &) file : std::cin);
+
+    srand(time(0));
+
+    OrderedOutput out;
+    HexThreadPool pool(opt.threads);
+    unsigned long id = 0;
+
+    // positions are queued as they are read, so output starts before the input ends
+    if (records != (const char *)0)
+    {
+        for (unsigned int i = 0; i < recordLines.size(); i++)
+            pool.Submit(std::bind(analyze, id++, recordLines[i], std::ref(opt), std::ref(out)));
+    }
+    else
+    {
+        std::string line;
+        while (getline(in, line))
+        {
+            if ((line.find_first_not_of(" \t\r") == std::string::npos) || (line[0] == '#'))
+                continue;
+            pool.Submit(std::bind(analyze, id++, line, std::ref(opt), std::ref(out)));
+        }
+    }
+
+    pool.Wait();
+    return 0;
+}
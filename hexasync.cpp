@@ -0,0 +1,249 @@
+#include <chrono>
+#include "hexasync.h"
+#include "hexstats.h"
+#include "hextrace.h"
+
+/* ============================================================================
+   HexComputePlayer class
+
+   Adapts a blocking HexPlayer to the asynchronous interface by running its
+   moves as tasks on a compute pool.
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexComputePlayer(HexPlayer *p, HexThreadPool &pool, bool owner=false)
+                                        -- runs p's moves on pool;  deletes p
+                                           when destroyed if owner is true
+   ---------------------------------------------------------------------------- */
+HexComputePlayer::HexComputePlayer(HexPlayer *p, HexThreadPool &pool, bool owner) : engine(p), compute(pool), ownsEngine(owner)
+{
+}
+
+HexComputePlayer::~HexComputePlayer(void)
+{
+    if (ownsEngine)
+        delete engine;
+}
+
+const char *HexComputePlayer::Name(void)
+{   return engine->Name();  }
+
+/* ----------------------------------------------------------------------------
+   void HexComputePlayer::StartMove(const HexBoard &board, HexColor turn, HexMoveCallback done);
+
+   Queues the engine's move on the compute pool and returns at once.  The
+   engine gets its own copy of the board, as in HexGame.  The work recorded
+   is the engine's own count (HexPlayer::LastMoveWork) when it keeps one,
+   else the counters of the compute thread during the move:  other games
+   run on the pool at the same time, so process wide counters would mix
+   their work in.
+   ---------------------------------------------------------------------------- */
+void HexComputePlayer::StartMove(const HexBoard &board, HexColor turn, HexMoveCallback done)
+{
+    HexPlayer *p = engine;
+
+    compute.Submit([p, board, turn, done]() {
+        HexBoard boardCopy(board);
+        HexRecordMoveStats work;
+        unsigned int row, col;
+
+        uint64_t rollouts = HexStats::ThreadCount(HEXSTAT_ROLLOUTS);
+        uint64_t candidates = HexStats::ThreadCount(HEXSTAT_CANDIDATES);
+        uint64_t cutoffs = HexStats::ThreadCount(HEXSTAT_CUTOFFS);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            HEXTRACE_SCOPE(((turn == HEXBLUE) ? "blue move" : "red move"));
+            p->Move(boardCopy, turn, row, col);
+        }
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        HexStats::Record(HEXTIMER_MOVE, ns);
+
+        HexMoveWork engineWork;
+        if (!p->LastMoveWork(engineWork))
+        {
+            engineWork.rollouts = HexStats::ThreadCount(HEXSTAT_ROLLOUTS) - rollouts;
+            engineWork.candidates = HexStats::ThreadCount(HEXSTAT_CANDIDATES) - candidates;
+            engineWork.cutoffs = HexStats::ThreadCount(HEXSTAT_CUTOFFS) - cutoffs;
+        }
+
+        work.micros = ns / 1000;
+        work.rollouts = engineWork.rollouts;
+        work.candidates = engineWork.candidates;
+        work.cutoffs = engineWork.cutoffs;
+
+        done(row, col, work);
+    });
+}
+
+/* ============================================================================
+   HexAsyncGame class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor
+    HexAsyncGame(unsigned int n, HexAsyncPlayer *bluePlayer, HexAsyncPlayer *redPlayer,
+                 HexColor movesFirst=HEXBLUE)
+                                        -- a game on an empty n x n board;
+                                           throws HEXGAME_ERR_INVALIDCOLOR if
+                                           movesFirst is not blue or red
+   ---------------------------------------------------------------------------- */
+HexAsyncGame::HexAsyncGame(unsigned int n, HexAsyncPlayer *bluePlayer, HexAsyncPlayer *redPlayer, HexColor movesFirst) : board(n)
+{
+    if ((movesFirst != HEXBLUE) && (movesFirst != HEXRED))
+        throw HEXGAME_ERR_INVALIDCOLOR;
+
+    players[0] = bluePlayer;
+    players[1] = redPlayer;
+    first = movesFirst;
+    turn = movesFirst;
+    winner = HEXBLANK;
+}
+
+// append the game to filename once it is finished
+void HexAsyncGame::SetRecord(const char *filename)
+{   recordFile = filename;  }
+
+// HEXBLANK until the game is finished
+HexColor HexAsyncGame::Winner(void)
+{   return winner;  }
+
+// moves played so far, in order
+const HexCellSet &HexAsyncGame::Moves(void)
+{   return moves;   }
+
+HexBoard &HexAsyncGame::Board(void)
+{   return board;   }
+
+/* ============================================================================
+   HexGameScheduler class
+
+   Each game has at most one event in flight (a move request or its reply),
+   so a game's state is only ever touched by one thread at a time and needs
+   no lock of its own;  handing the game between threads through the pools'
+   queues orders the accesses.
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexGameScheduler(unsigned int nGameThreads=1)
+                                        -- starts nGameThreads threads to run
+                                           the games' turns
+    ~HexGameScheduler(void)             -- waits for the games to finish
+   ---------------------------------------------------------------------------- */
+HexGameScheduler::HexGameScheduler(unsigned int nGameThreads) : active(0), gameThreads((nGameThreads == 0) ? 1 : nGameThreads)
+{
+}
+
+HexGameScheduler::~HexGameScheduler(void)
+{
+    Wait();
+}
+
+/* ----------------------------------------------------------------------------
+   void HexGameScheduler::Add(HexAsyncGame *game, HexGameCallback finished);
+
+   Starts playing a game;  finished is called when it has a winner.  The game
+   is not owned and must live until then.
+   ---------------------------------------------------------------------------- */
+void HexGameScheduler::Add(HexAsyncGame *game, HexGameCallback finished)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        active++;
+    }
+
+    game->record.Start(game->board.Size(), game->first, game->players[0]->Name(), game->players[1]->Name());
+    gameThreads.Submit(std::bind(&HexGameScheduler::requestMove, this, game, finished));
+}
+
+/* ----------------------------------------------------------------------------
+   void HexGameScheduler::Wait(void);
+
+   Blocks until every game added so far, and every game their finished
+   callbacks added, has finished.
+   ---------------------------------------------------------------------------- */
+void HexGameScheduler::Wait(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (active > 0)
+        allDone.wait(guard);
+}
+
+// number of games being played
+unsigned int HexGameScheduler::Active(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return active;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexGameScheduler::requestMove(HexAsyncGame *game, HexGameCallback finished);
+
+   Game thread:  asks the player to move for the game's next turn.  The reply
+   is queued back to the game threads rather than handled on the player's
+   thread, so compute threads only ever run engine work.
+   ---------------------------------------------------------------------------- */
+void HexGameScheduler::requestMove(HexAsyncGame *game, HexGameCallback finished)
+{
+    HexAsyncPlayer *player = game->players[(game->turn == HEXBLUE) ? 0 : 1];
+
+    player->StartMove(game->board, game->turn,
+        [this, game, finished](unsigned int row, unsigned int col, const HexRecordMoveStats &work) {
+            gameThreads.Submit(std::bind(&HexGameScheduler::applyMove, this, game, finished, row, col, work));
+        });
+}
+
+/* ----------------------------------------------------------------------------
+   void HexGameScheduler::applyMove(HexAsyncGame *game, HexGameCallback finished,
+                                    unsigned int row, unsigned int col, HexRecordMoveStats work);
+
+   Game thread:  plays a move the player returned and either finishes the
+   game or asks for the next move.  An illegal move is asked for again, as
+   HexGame prompts again.
+   ---------------------------------------------------------------------------- */
+void HexGameScheduler::applyMove(HexAsyncGame *game, HexGameCallback finished, unsigned int row, unsigned int col,
+                                 HexRecordMoveStats work)
+{
+    if (game->board.SetColor(row, col, game->turn) != HEXMOVE_OK)
+    {
+        requestMove(game, finished);
+        return;
+    }
+
+    HexCell cell;
+    cell.row = row;
+    cell.col = col;
+    cell.color = game->turn;
+    game->moves.push_back(cell);
+    game->record.Move(row, col, work);
+
+    game->winner = game->board.Winner();
+    if (game->winner != HEXBLANK)
+    {
+        finish(game, finished);
+        return;
+    }
+
+    game->turn = ((game->turn == HEXBLUE) ? HEXRED : HEXBLUE);
+    requestMove(game, finished);
+}
+
+/* ----------------------------------------------------------------------------
+   void HexGameScheduler::finish(HexAsyncGame *game, HexGameCallback finished);
+
+   Game thread:  records a finished game and reports it.  The game is not
+   touched after the callback, which may delete it.
+   ---------------------------------------------------------------------------- */
+void HexGameScheduler::finish(HexAsyncGame *game, HexGameCallback finished)
+{
+    if (!game->recordFile.empty())
+        game->record.Finish(game->winner, game->recordFile.c_str());
+
+    finished(*game);
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (--active == 0)
+        allDone.notify_all();
+}
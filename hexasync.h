@@ -0,0 +1,122 @@
+#ifndef _HEXASYNC_H_
+#define _HEXASYNC_H_
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "hexboard.h"
+#include "hexrecord.h"
+#include "hexthreadpool.h"
+
+// called with the move a player chose and the work it took (zeros if not
+// measured), from whatever thread produced it
+typedef std::function<void(unsigned int row, unsigned int col, const HexRecordMoveStats &work)> HexMoveCallback;
+
+/* ============================================================================
+   HexAsyncPlayer class
+
+   A player that is asked for a move and answers later, through a callback,
+   instead of blocking the caller.  The callback may be invoked from any
+   thread, exactly once per StartMove.  Players waiting on something external
+   (a network peer, a GUI) keep the callback and invoke it when the move
+   arrives, holding no thread in the meantime.
+   ============================================================================ */
+class HexAsyncPlayer {
+    public:
+    virtual ~HexAsyncPlayer(void) {}
+    virtual const char *Name(void) = 0;
+    virtual void StartMove(const HexBoard &board, HexColor turn, HexMoveCallback done) = 0;
+};
+
+/* ============================================================================
+   HexComputePlayer class
+
+   Runs a blocking HexPlayer (an engine) on a shared compute pool, measuring
+   the time and engine counters of each move.  Each wrapper asks its engine
+   for one move at a time, so an engine must not be shared between wrappers.
+   ============================================================================ */
+class HexComputePlayer : public HexAsyncPlayer {
+    public:
+    HexComputePlayer(HexPlayer *p, HexThreadPool &pool, bool owner=false);
+    virtual ~HexComputePlayer(void);
+    virtual const char *Name(void);
+    virtual void StartMove(const HexBoard &board, HexColor turn, HexMoveCallback done);
+
+    private:
+    HexPlayer *engine;
+    HexThreadPool &compute;
+    bool ownsEngine;
+
+    // no copies, the engine may be owned
+    HexComputePlayer(const HexComputePlayer &);
+    HexComputePlayer &operator=(const HexComputePlayer &);
+};
+
+/* ============================================================================
+   HexAsyncGame class
+
+   The state of one game driven by a HexGameScheduler:  whose turn it is, the
+   board and the moves so far.  Players are not owned.  With a record file,
+   the finished game is appended to it as HexGame's record option does.
+   ============================================================================ */
+class HexAsyncGame {
+    public:
+    HexAsyncGame(unsigned int n, HexAsyncPlayer *bluePlayer, HexAsyncPlayer *redPlayer, HexColor movesFirst=HEXBLUE);
+    void SetRecord(const char *filename);
+    HexColor Winner(void);
+    const HexCellSet &Moves(void);
+    HexBoard &Board(void);
+
+    private:
+    HexBoard board;
+    HexAsyncPlayer *players[2];         // blue, red
+    HexColor first;
+    HexColor turn;
+    HexColor winner;
+    HexCellSet moves;
+    std::string recordFile;             // empty if none
+    HexRecordWriter record;
+
+    friend class HexGameScheduler;
+};
+
+/* ============================================================================
+   HexGameScheduler class
+
+   Interleaves many games on a small pool of game threads.  A game holds no
+   thread while its player thinks:  the scheduler asks the player for a move,
+   and the player's callback queues the rest of the turn (applying the move,
+   checking for a winner, asking the next player) back on the game threads.
+   Engine work goes to whatever pool the players use, typically one compute
+   pool shared by all games.  The finished callback runs on a game thread
+   once the game has a winner;  it may delete the game and add new ones.
+   ============================================================================ */
+typedef std::function<void(HexAsyncGame &game)> HexGameCallback;
+
+class HexGameScheduler {
+    public:
+    HexGameScheduler(unsigned int nGameThreads=1);
+    ~HexGameScheduler(void);
+    void Add(HexAsyncGame *game, HexGameCallback finished);
+    void Wait(void);
+    unsigned int Active(void);
+
+    private:
+    std::mutex lock;
+    std::condition_variable allDone;
+    unsigned int active;                // games added but not yet finished
+    HexThreadPool gameThreads;          // last, so its threads stop before the rest is destroyed
+
+    void requestMove(HexAsyncGame *game, HexGameCallback finished);
+    void applyMove(HexAsyncGame *game, HexGameCallback finished, unsigned int row, unsigned int col,
+                   HexRecordMoveStats work);
+    void finish(HexAsyncGame *game, HexGameCallback finished);
+
+    // no copies, the scheduler owns its threads
+    HexGameScheduler(const HexGameScheduler &);
+    HexGameScheduler &operator=(const HexGameScheduler &);
+};
+
+#endif
@@ -0,0 +1,1146 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include "hexboard.h"
+#include "hexbitboard.h"
+#include "unionfind.h"
+#include "rollbackunionfind.hpp"
+#include "hexperf.h"
+#include "hexthreadpool.h"
+#include "hexmcplayer.hpp"
+#include "hexeval.h"
+#include "hexnet.h"
+
+/* ============================================================================
+   hexbench
+
+   Microbenchmarks for the board, graph and rollout hot paths.
+
+   usage:  hexbench [-sizes min-max] [-time seconds] [-compare baseline.json] [-threshold pct]
+           hexbench -ordering [size [positions]]
+           hexbench -scaling [-pin] [size [seconds]]
+
+   The first form measures, for each board size (default 3-15), the time per
+   operation of:
+        setcolor         HexBoard::SetColor / HexBitBoard::SetColor
+        winner_partial   Winner() on a half filled board
+        winner_full      Winner() on a full board
+        haspath          MinGraph::HasPath, unrestricted and restricted to similar
+        shortestpath     MinGraph::ShortestPaths from the top row of a half
+                         filled board, by 0-1 BFS and by radix heap Dijkstra,
+                         reusing one MinGraphPaths
+        evaluate         HexEvaluator::Evaluate on a half filled board and on
+                         its children, alternately (as in a search), for
+                         two-distance and for resistance, warm started from
+                         the previous solution or not
+        netforward       HexNet::Evaluate per position, in batches of 16, for
+                         an untrained network with one hidden layer of 128,
+                         fp32 and int8 weights, portable and AVX2 kernels
+        copy             HexBoard copy
+        uf_join          UnionFind::Join (including Reset, amortized)
+        uf_find          UnionFind::Find
+        uf_rollback      RollbackUnionFind Join between Checkpoint and Rollback
+                         (per join, the rollback included);  uf_join and
+                         uf_find are also measured for RollbackUnionFind, for
+                         8, 16 and 32 bit indices
+        movegen          HexMoveGenerator construction
+        shuffle          HexMoveGenerator::Shuffle
+        rollout          one playout plus Winner(), per rollout policy, and on
+                         a HexBitBoard
+        rollout_snapshot a random playout from a half filled board, finding
+                         the winner with a RollbackUnionFind checkpointed at
+                         the starting position
+   Board measurements are taken for both representations side by side, and
+   the winners they report are cross-checked on random boards;  so is
+   HexBoard::DropSymmetric(), on random self-symmetric boards.
+
+   Where the system allows it (Linux perf_event_open), each measurement also
+   reports hardware counters per operation:  cycles, instructions, IPC, cache
+   misses and branch misses.  Otherwise only times are reported, and
+   "perf_counters" in the output says why.
+
+   Results are written to stdout as JSON, one result object per line.  With
+   -compare, the results are instead compared against a JSON file saved from
+   an earlier run, and any operation slower by more than the threshold
+   (default 10%) is flagged; the exit status is 1 if any operation regressed,
+   2 if the board representations disagreed on a winner or DropSymmetric()
+   failed its check.
+
+   The second form measures how many rollouts HexMCPlayer runs per move with
+   and without candidate ordering, over a set of random early-game positions.
+   Without a size, sizes 5, 7 and 9 are measured.
+
+   The third form measures how the thread pool scales from 1 thread to one
+   per core, on a board of the given size (default 11):  throughput of
+   batches of independent rollouts spread with ParallelFor, and the time of
+   a parallel HexMCPlayer move on a fixed set of positions.  The amount of
+   work is fixed (calibrated to about the given seconds, default 1, on one
+   thread), so speedup = time on 1 thread / time on n threads.  With -pin,
+   worker threads are bound to cores.
+   ============================================================================ */
+
+typedef struct structBenchResult {
+    std::string name;
+    std::string impl;
+    unsigned int size;
+    double nsPerOp;
+    double perOp[HEXPERF_NEVENTS];          // hardware counts per operation
+    bool   hasPerOp[HEXPERF_NEVENTS];
+} BenchResult;
+
+// results are folded into this, so that the compiler cannot drop the work being measured
+static volatile unsigned long sink;
+
+// hardware counters around each timed run, and the counts of the last run nsPerOp kept
+static HexPerfCounters perf;
+static HexPerfSample lastSample;
+static double lastOps;
+
+/* ----------------------------------------------------------------------------
+   template <class Op> static double nsPerOp(Op op, unsigned int opsPerCall, double minSeconds);
+
+   Calls op() repeatedly, doubling the number of calls until a run lasts at
+   least minSeconds.  Returns nanoseconds per operation, where each call of op
+   performs opsPerCall operations.  The hardware counts of the final run are
+   left in lastSample (and its number of operations in lastOps).
+   ---------------------------------------------------------------------------- */
+template <class Op>
+static double nsPerOp(Op op, unsigned int opsPerCall, double minSeconds)
+{
+    for (unsigned long nCalls = 1; ; nCalls *= 2)
+    {
+        perf.Start();
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < nCalls; i++)
+            op();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        perf.Stop(lastSample);
+
+        if (seconds >= minSeconds)
+        {
+            lastOps = ((double) nCalls) * opsPerCall;
+            return seconds * 1e9 / lastOps;
+        }
+    }
+}
+
+// record a measurement, along with the hardware counts nsPerOp left behind
+static void addResult(std::vector<BenchResult> &results, const char *name, const char *impl, unsigned int n, double ns)
+{
+    BenchResult r;
+    r.name = name;
+    r.impl = impl;
+    r.size = n;
+    r.nsPerOp = ns;
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        r.hasPerOp[i] = lastSample.valid[i];
+        r.perOp[i] = (lastSample.valid[i] ? lastSample.count[i] / lastOps : 0.0);
+    }
+    results.push_back(r);
+}
+
+// fill every cell of both boards with random colors (blank cells allowed if partial)
+static void randomFill(HexBoard &board, HexBitBoard &bits, bool partial)
+{
+    unsigned int n = board.Size();
+
+    for (unsigned int row = 0; row < n; row++)
+    {
+        for (unsigned int col = 0; col < n; col++)
+        {
+            unsigned int x = HexRandom(partial ? 4 : 2);
+            HexColor color = ((x == 0) ? HEXBLUE : ((x == 1) ? HEXRED : HEXBLANK));
+
+            if (color != HEXBLANK)
+                board.SetColor(row, col, color);
+            bits.SetColor(row, col, color);
+        }
+    }
+}
+
+// build a MinGraph with the adjacency of an n x n hex board (no virtual cells)
+static void hexGraph(unsigned int n, MinGraph<HexColor> &G)
+{
+    G.Reset(n * n, HEXBLANK);
+
+    for (unsigned int r = 0; r < n; r++)
+    {
+        for (unsigned int c = 0; c < n; c++)
+        {
+            unsigned int iCell = r * n + c;
+            if (r < (n - 1))
+            {
+                G.AddEdge(iCell, iCell + n);
+                if (c > 0) G.AddEdge(iCell, iCell + n - 1);
+            }
+            if (c < (n - 1))
+                G.AddEdge(iCell, iCell + 1);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   template <class Index> static void joinCell(RollbackUnionFind<Index> &uf,
+                                               std::vector<HexColor> &cells, unsigned int n,
+                                               unsigned int iCell);
+
+   Joins cell iCell of an n x n board to its neighbors of the same color, and
+   to the virtual edges it touches:  n * n and n * n + 1 are the top and
+   bottom (blue), n * n + 2 and n * n + 3 the left and right (red).
+   ---------------------------------------------------------------------------- */
+template <class Index>
+static void joinCell(RollbackUnionFind<Index> &uf, std::vector<HexColor> &cells, unsigned int n, unsigned int iCell)
+{
+    static const int dr[6] = {-1, -1, 0, 1,  1,  0};
+    static const int dc[6] = { 0,  1, 1, 0, -1, -1};
+
+    int r = iCell / n, c = iCell % n;
+    HexColor color = cells[iCell];
+
+    for (unsigned int k = 0; k < 6; k++)
+    {
+        int nr = r + dr[k], nc = c + dc[k];
+        if ((nr >= 0) && (nr < (int) n) && (nc >= 0) && (nc < (int) n) && (cells[nr * n + nc] == color))
+            uf.Join(iCell, nr * n + nc);
+    }
+
+    if (color == HEXBLUE)
+    {
+        if (r == 0)             uf.Join(iCell, n * n);
+        if (r == (int) n - 1)   uf.Join(iCell, n * n + 1);
+    }
+    else if (color == HEXRED)
+    {
+        if (c == 0)             uf.Join(iCell, n * n + 2);
+        if (c == (int) n - 1)   uf.Join(iCell, n * n + 3);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   template <class Index> static void benchRollback(unsigned int n, const char *impl,
+                                                    std::vector<unsigned int> &pairs, double minSeconds,
+                                                    std::vector<BenchResult> &results);
+
+   RollbackUnionFind measurements for board size n, with Index wide indices
+   ---------------------------------------------------------------------------- */
+template <class Index>
+static void benchRollback(unsigned int n, const char *impl, std::vector<unsigned int> &pairs, double minSeconds,
+                          std::vector<BenchResult> &results)
+{
+    unsigned int n2 = n * n;
+    RollbackUnionFind<Index> uf(n2 + 4);
+
+    // Reset only undoes the joins of the previous call
+    addResult(results, "uf_join", impl, n, nsPerOp([&]() {
+        uf.Reset(n2 + 4);
+        for (unsigned int i = 0; i < n2; i++)
+            uf.Join(pairs[2 * i], pairs[2 * i + 1]);
+    }, n2, minSeconds));
+    addResult(results, "uf_find", impl, n, nsPerOp([&]() {
+        for (unsigned int i = 0; i < n2; i++)
+            sink += uf.Find(i);
+    }, n2, minSeconds));
+
+    // the second half of the joins, on top of the first half
+    uf.Reset(n2 + 4);
+    for (unsigned int i = 0; i < n2 / 2; i++)
+        uf.Join(pairs[2 * i], pairs[2 * i + 1]);
+
+    addResult(results, "uf_rollback", impl, n, nsPerOp([&]() {
+        uf.Checkpoint();
+        for (unsigned int i = n2 / 2; i < n2; i++)
+            uf.Join(pairs[2 * i], pairs[2 * i + 1]);
+        uf.Rollback();
+    }, n2 - n2 / 2, minSeconds));
+
+    // rollouts from a snapshot:  the starting position's connectivity is built once
+    HexBoard board(n);
+    HexBitBoard bits(n);
+    randomFill(board, bits, true);
+
+    std::vector<HexColor> start(n2), cells(n2);
+    std::vector<unsigned int> open;
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        start[i] = bits.GetColor(i / n, i % n);
+        if (start[i] == HEXBLANK)
+            open.push_back(i);
+    }
+
+    uf.Reset(n2 + 4);
+    for (unsigned int i = 0; i < n2; i++)
+        if (start[i] != HEXBLANK)
+            joinCell(uf, start, n, i);
+
+    addResult(results, "rollout_snapshot", impl, n, nsPerOp([&]() {
+        cells = start;
+        HexShuffle(open);
+        for (unsigned int i = 0; i < open.size(); i++)
+            cells[open[i]] = (((i % 2) == 0) ? HEXBLUE : HEXRED);
+
+        uf.Checkpoint();
+        for (unsigned int i = 0; i < open.size(); i++)
+            joinCell(uf, cells, n, open[i]);
+        sink += uf.Connected(n2, n2 + 1);
+        uf.Rollback();
+    }, 1, minSeconds));
+}
+
+/* ----------------------------------------------------------------------------
+   static unsigned int checkWinners(unsigned int n, unsigned int nBoards);
+
+   Fills nBoards random boards (half of them partially) in both
+   representations and returns the number of boards where the winners differ.
+   ---------------------------------------------------------------------------- */
+static unsigned int checkWinners(unsigned int n, unsigned int nBoards)
+{
+    unsigned int nMismatches = 0;
+
+    for (unsigned int i = 0; i < nBoards; i++)
+    {
+        HexBoard board(n);
+        HexBitBoard bits(n);
+
+        randomFill(board, bits, ((i % 2) == 1));
+
+        if (board.Winner() != bits.Winner())
+            nMismatches++;
+    }
+
+    return nMismatches;
+}
+
+/* ----------------------------------------------------------------------------
+   static unsigned int checkSymmetric(unsigned int n, unsigned int nBoards);
+
+   On nBoards random self-symmetric boards, takes the pattern engine's
+   candidates, and also those candidates without the first cell of one
+   rotated pair (a pruned partner), and returns the number of sets where
+   HexBoard::DropSymmetric() lost both cells of a pair or kept both.
+   ---------------------------------------------------------------------------- */
+
+// true if every pair with a cell in before has exactly one cell in after
+static bool pairsKept(const HexCellSet &before, const HexCellSet &after, unsigned int n)
+{
+    unsigned int n2 = n * n;
+    std::vector<bool> inBefore(n2, false), inAfter(n2, false);
+
+    for (unsigned int i = 0; i < before.size(); i++)
+        inBefore[before[i].row * n + before[i].col] = true;
+    for (unsigned int i = 0; i < after.size(); i++)
+        inAfter[after[i].row * n + after[i].col] = true;
+
+    for (unsigned int iCell = 0; iCell < n2; iCell++)
+    {
+        unsigned int image = n2 - 1 - iCell;
+        bool present = (inBefore[iCell] || inBefore[image]);
+        unsigned int kept = (inAfter[iCell] ? 1 : 0) + ((inAfter[image] && (image != iCell)) ? 1 : 0);
+
+        if (present && (kept != 1))
+            return false;
+    }
+
+    return true;
+}
+
+static unsigned int checkSymmetric(unsigned int n, unsigned int nBoards)
+{
+    unsigned int n2 = n * n;
+    unsigned int nMismatches = 0;
+    HexPatternEngine patterns;
+
+    for (unsigned int i = 0; i < nBoards; i++)
+    {
+        HexBoard board(n);
+
+        for (unsigned int iCell = 0; iCell <= (n2 - 1) / 2; iCell++)
+        {
+            unsigned int x = HexRandom(4);
+            HexColor color = ((x == 0) ? HEXBLUE : ((x == 1) ? HEXRED : HEXBLANK));
+            unsigned int image = n2 - 1 - iCell;
+
+            // the center cell of an odd board is its own image, leave it blank
+            if ((color == HEXBLANK) || (image == iCell))
+                continue;
+
+            board.SetColor(iCell / n, iCell % n, color);
+            board.SetColor(image / n, image % n, color);
+        }
+
+        HexCellSet candidates, pruned, dropped;
+        patterns.Candidates(board, ((i % 2) == 0) ? HEXBLUE : HEXRED, candidates);
+
+        dropped = candidates;
+        board.DropSymmetric(dropped);
+        if (!pairsKept(candidates, dropped, n))
+            nMismatches++;
+
+        // leave out the first cell of the first pair present in full
+        pruned = candidates;
+        for (unsigned int j = 0; j < pruned.size(); j++)
+        {
+            unsigned int iCell = pruned[j].row * n + pruned[j].col;
+            unsigned int image = n2 - 1 - iCell;
+
+            if ((iCell < image) && (board.GetColor(image / n, image % n) == HEXBLANK))
+            {
+                pruned.erase(pruned.begin() + j);
+                break;
+            }
+        }
+
+        dropped = pruned;
+        board.DropSymmetric(dropped);
+        if (!pairsKept(pruned, dropped, n))
+            nMismatches++;
+    }
+
+    return nMismatches;
+}
+
+/* ----------------------------------------------------------------------------
+   static void benchSize(unsigned int n, double minSeconds, std::vector<BenchResult> &results);
+
+   Runs all the microbenchmarks for board size n
+   ---------------------------------------------------------------------------- */
+static void benchSize(unsigned int n, double minSeconds, std::vector<BenchResult> &results)
+{
+    unsigned int n2 = n * n;
+
+    // ----- SetColor, cycling through all cells with alternating colors ------
+    {
+        HexBoard board(n);
+        HexBitBoard bits(n);
+        unsigned int i = 0, j = 0;
+
+        board.SetTrialMode();
+        addResult(results, "setcolor", "mingraph", n, nsPerOp([&]() {
+            board.SetColor(i / n, i % n, ((i & 1) ? HEXBLUE : HEXRED));
+            if (++i == n2) i = 0;
+        }, 1, minSeconds));
+        addResult(results, "setcolor", "bitboard", n, nsPerOp([&]() {
+            bits.SetColor(j / n, j % n, ((j & 1) ? HEXBLUE : HEXRED));
+            if (++j == n2) j = 0;
+        }, 1, minSeconds));
+    }
+
+    // ----- Winner on partial and full boards --------------------------------
+    for (unsigned int iFull = 0; iFull < 2; iFull++)
+    {
+        HexBoard board(n);
+        HexBitBoard bits(n);
+        const char *name = ((iFull == 0) ? "winner_partial" : "winner_full");
+
+        randomFill(board, bits, (iFull == 0));
+        board.SetTrialMode();       // winner is recomputed from scratch in trial mode
+
+        addResult(results, name, "mingraph", n, nsPerOp([&]() { sink += board.Winner(); }, 1, minSeconds));
+        addResult(results, name, "bitboard", n, nsPerOp([&]() { sink += bits.Winner(); }, 1, minSeconds));
+    }
+
+    // ----- MinGraph::HasPath between opposite corners ------------------------
+    {
+        MinGraph<HexColor> G;
+        hexGraph(n, G);
+
+        addResult(results, "haspath", "any", n, nsPerOp([&]() { sink += G.HasPath(0, n2 - 1); }, 1, minSeconds));
+
+        for (unsigned int i = 0; i < n2; i++)
+            G.SetVertexValue(i, ((HexRandom(2) == 0) ? HEXBLUE : HEXRED));
+        G.SetVertexValue(n2 - 1, G.GetVertexValue(0));
+
+        addResult(results, "haspath", "similar", n, nsPerOp([&]() { sink += G.HasPath(0, n2 - 1, true); }, 1, minSeconds));
+    }
+
+    // ----- MinGraph::ShortestPaths from the top row, on a half filled board -----
+    {
+        MinGraph<HexColor> G;
+        hexGraph(n, G);
+
+        for (unsigned int i = 0; i < n2; i++)
+        {
+            unsigned int x = HexRandom(4);
+            G.SetVertexValue(i, ((x == 0) ? HEXBLUE : ((x == 1) ? HEXRED : HEXBLANK)));
+        }
+
+        VertexIDSet top;
+        for (unsigned int c = 0; c < n; c++)
+            top.push_back(c);
+
+        // blue stones free, blank cells 1 (2 for the radix heap), red blocked
+        std::vector<unsigned int> unit(4, MINGRAPH_BLOCKED), general(4, MINGRAPH_BLOCKED);
+        unit[HEXBLANK] = 1;
+        unit[HEXBLUE] = 0;
+        general[HEXBLANK] = 2;
+        general[HEXBLUE] = 0;
+
+        MinGraphPaths paths;
+        addResult(results, "shortestpath", "01bfs", n, nsPerOp([&]() { sink += G.ShortestPaths(top, paths, unit); }, 1, minSeconds));
+        addResult(results, "shortestpath", "radix", n, nsPerOp([&]() { sink += G.ShortestPaths(top, paths, general); }, 1, minSeconds));
+    }
+
+    // ----- static evaluation, alternating between a position and its children -----
+    {
+        HexCellColors cells(n2, HEXBLANK);
+        std::vector<unsigned int> blanks;
+
+        for (unsigned int i = 0; i < n2; i++)
+        {
+            unsigned int x = HexRandom(4);
+            cells[i] = ((x == 0) ? HEXBLUE : ((x == 1) ? HEXRED : HEXBLANK));
+            if (cells[i] == HEXBLANK)
+                blanks.push_back(i);
+        }
+
+        HexTwoDistance twoDistance;
+        HexResistance warm, cold;
+        cold.SetWarmStart(false);
+
+        HexEvaluator *evaluators[3] = {&twoDistance, &warm, &cold};
+        const char *impls[3] = {"twodistance", "resistance_warm", "resistance_cold"};
+
+        for (unsigned int e = 0; e < 3; e++)
+        {
+            unsigned int i = 0;
+            addResult(results, "evaluate", impls[e], n, nsPerOp([&]() {
+                sink += evaluators[e]->Evaluate(cells, n, HEXBLUE);
+                if (blanks.empty()) return;
+
+                unsigned int iCell = blanks[i++ % blanks.size()];
+                cells[iCell] = HEXRED;
+                sink += evaluators[e]->Evaluate(cells, n, HEXBLUE);
+                cells[iCell] = HEXBLANK;
+            }, 2, minSeconds));
+        }
+    }
+
+    // ----- policy/value network inference ----------------------------------------
+    {
+        const unsigned int batch = 16;
+        std::vector<unsigned int> hidden(1, 128);
+        std::vector<float> planes(batch * HEXNET_PLANES * n2), logits(batch * n2), values(batch);
+
+        for (unsigned int i = 0; i < planes.size(); i++)
+            planes[i] = HexRandom(2);
+
+        for (unsigned int w = 0; w < 2; w++)
+        {
+            HexNet net;
+            net.Reset(n, hidden, ((w == 0) ? HEXNET_FP32 : HEXNET_INT8));
+
+            for (unsigned int s = 0; s < 2; s++)
+            {
+                net.SetSIMD(s == 1);
+                if ((s == 1) && !net.SIMD())
+                    continue;
+
+                const char *impls[2][2] = {{"fp32_scalar", "fp32_avx2"}, {"int8_scalar", "int8_avx2"}};
+                addResult(results, "netforward", impls[w][s], n, nsPerOp([&]() {
+                    net.Evaluate(&planes[0], batch, &logits[0], &values[0]);
+                    sink += (values[0] > 0);
+                }, batch, minSeconds));
+            }
+        }
+    }
+
+    // ----- HexBoard copy ------------------------------------------------------
+    {
+        HexBoard board(n);
+        HexBitBoard bits(n);
+        randomFill(board, bits, true);
+
+        addResult(results, "copy", "mingraph", n, nsPerOp([&]() { HexBoard c(board); sink += c.Size(); }, 1, minSeconds));
+        addResult(results, "copy", "bitboard", n, nsPerOp([&]() { HexBitBoard c(bits); sink += c.Size(); }, 1, minSeconds));
+    }
+
+    // ----- UnionFind ------------------------------------------------------------
+    {
+        UnionFind uf(n2);
+        std::vector<unsigned int> pairs(2 * n2);
+        for (unsigned int i = 0; i < pairs.size(); i++)
+            pairs[i] = HexRandom(n2);
+
+        addResult(results, "uf_join", "unionfind", n, nsPerOp([&]() {
+            uf.Reset(n2);
+            for (unsigned int i = 0; i < n2; i++)
+                uf.Join(pairs[2 * i], pairs[2 * i + 1]);
+        }, n2, minSeconds));
+        addResult(results, "uf_find", "unionfind", n, nsPerOp([&]() {
+            for (unsigned int i = 0; i < n2; i++)
+                sink += uf.Find(i);
+        }, n2, minSeconds));
+
+        // bytes fit every board size, cells plus the 4 virtual edges
+        benchRollback<uint8_t>(n, "rollback8", pairs, minSeconds, results);
+        benchRollback<uint16_t>(n, "rollback16", pairs, minSeconds, results);
+        benchRollback<uint32_t>(n, "rollback32", pairs, minSeconds, results);
+    }
+
+    // ----- HexMoveGenerator ---------------------------------------------------
+    {
+        HexBoard board(n);
+        HexBitBoard bits(n);
+        randomFill(board, bits, true);
+        HexMoveGenerator mg(board);
+
+        addResult(results, "movegen", "mingraph", n, nsPerOp([&]() { HexMoveGenerator g(board); sink += g.Count(); }, 1, minSeconds));
+        addResult(results, "shuffle", "mingraph", n, nsPerOp([&]() { mg.Shuffle(); }, 1, minSeconds));
+    }
+
+    // ----- rollouts from the empty board, as run by EvaluateMove --------------
+    {
+        const unsigned int nTrials = 16;
+        HexBoard board(n);
+        HexRolloutPolicy randomPolicy;
+        HexBridgePolicy bridgePolicy;
+        HexPatternPolicy patternPolicy;
+        HexBridgePolicy replyPolicy;
+        unsigned int nRun;
+
+        replyPolicy.SetReplies(true);
+
+        addResult(results, "rollout", "random", n, nsPerOp([&]() {
+            sink += EvaluateMove(board, HEXBLUE, n / 2, n / 2, nTrials, -1, randomPolicy, nRun);
+        }, nTrials, minSeconds));
+        addResult(results, "rollout", "bridge", n, nsPerOp([&]() {
+            sink += EvaluateMove(board, HEXBLUE, n / 2, n / 2, nTrials, -1, bridgePolicy, nRun);
+        }, nTrials, minSeconds));
+        addResult(results, "rollout", "bridge_replies", n, nsPerOp([&]() {
+            sink += EvaluateMove(board, HEXBLUE, n / 2, n / 2, nTrials, -1, replyPolicy, nRun);
+        }, nTrials, minSeconds));
+        addResult(results, "rollout", "pattern", n, nsPerOp([&]() {
+            sink += EvaluateMove(board, HEXBLUE, n / 2, n / 2, nTrials, -1, patternPolicy, nRun);
+        }, nTrials, minSeconds));
+
+        // the same random playout on the bit board
+        HexBitBoard bits(n);
+        HexCellSet hcs;
+        board.GetCells(hcs, HEXBLANK);
+
+        addResult(results, "rollout", "bitboard", n, nsPerOp([&]() {
+            HexShuffle(hcs);
+            for (unsigned int i = 0; i < hcs.size(); i++)
+                bits.SetColor(hcs[i].row, hcs[i].col, (((i % 2) == 0) ? HEXBLUE : HEXRED));
+            sink += bits.Winner();
+        }, 1, minSeconds));
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static void writeJson(std::vector<BenchResult> &results, std::vector<unsigned int> &mismatches,
+                         unsigned int minSize, unsigned int nBoards);
+
+   Writes results to stdout as JSON, one result object per line
+   ---------------------------------------------------------------------------- */
+static void writeJson(std::vector<BenchResult> &results, std::vector<unsigned int> &mismatches, unsigned int minSize, unsigned int nBoards)
+{
+    std::cout << "{\n\"benchmark\": \"hexbench\",\n\"perf_counters\": \""
+              << (perf.IsOpen() ? "available" : perf.Reason().c_str()) << "\",\n\"results\": [\n";
+
+    for (unsigned int i = 0; i < results.size(); i++)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+                  << "{\"name\": \"" << results[i].name << "\", \"impl\": \"" << results[i].impl
+                  << "\", \"size\": " << results[i].size
+                  << ", \"ns_per_op\": " << results[i].nsPerOp
+                  << ", \"ops_per_sec\": " << std::setprecision(0) << 1e9 / results[i].nsPerOp;
+
+        std::cout << std::setprecision(3);
+        for (unsigned int e = 0; e < HEXPERF_NEVENTS; e++)
+            if (results[i].hasPerOp[e])
+                std::cout << ", \"" << HexPerfCounters::Name((HexPerfEvent) e) << "_per_op\": " << results[i].perOp[e];
+
+        if (results[i].hasPerOp[HEXPERF_CYCLES] && results[i].hasPerOp[HEXPERF_INSTRUCTIONS] && (results[i].perOp[HEXPERF_CYCLES] > 0))
+            std::cout << ", \"ipc\": " << results[i].perOp[HEXPERF_INSTRUCTIONS] / results[i].perOp[HEXPERF_CYCLES];
+
+        std::cout << "}" << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+
+    std::cout << "],\n\"winner_check\": [\n";
+
+    for (unsigned int i = 0; i < mismatches.size(); i++)
+    {
+        std::cout << "{\"size\": " << (minSize + i) << ", \"boards\": " << nBoards
+                  << ", \"mismatches\": " << mismatches[i] << "}"
+                  << ((i + 1 < mismatches.size()) ? ",\n" : "\n");
+    }
+
+    std::cout << "]\n}\n";
+}
+
+/* ----------------------------------------------------------------------------
+   static bool jsonField(const std::string &line, const char *key, std::string &value);
+
+   Extracts the value of "key" from a single line JSON object written by
+   writeJson().  String values are returned without their quotes.
+   ---------------------------------------------------------------------------- */
+static bool jsonField(const std::string &line, const char *key, std::string &value)
+{
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t p = line.find(pattern);
+    if (p == std::string::npos)
+        return false;
+
+    p += pattern.size();
+    if (line[p] == '"')
+    {
+        size_t q = line.find('"', p + 1);
+        if (q == std::string::npos) return false;
+        value = line.substr(p + 1, q - p - 1);
+    }
+    else
+    {
+        size_t q = line.find_first_of(",}", p);
+        value = line.substr(p, q - p);
+    }
+
+    return true;
+}
+
+// key identifying a measurement across runs
+static std::string resultKey(const std::string &name, const std::string &impl, unsigned int size)
+{
+    std::ostringstream ss;
+    ss << name << "/" << impl << "/" << size;
+    return ss.str();
+}
+
+/* ----------------------------------------------------------------------------
+   static int compare(std::vector<BenchResult> &results, const char *filename, double threshold);
+
+   Compares results against a baseline saved by an earlier run.  Returns the
+   number of regressions (operations slower by more than threshold percent),
+   or -1 if the baseline cannot be read.
+   ---------------------------------------------------------------------------- */
+static int compare(std::vector<BenchResult> &results, const char *filename, double threshold)
+{
+    std::ifstream in(filename);
+    if (!in)
+        return -1;
+
+    std::map<std::string, double> baseline;
+    std::string line;
+
+    while (getline(in, line))
+    {
+        std::string name, impl, size, ns;
+        if (jsonField(line, "name", name) && jsonField(line, "impl", impl) &&
+            jsonField(line, "size", size) && jsonField(line, "ns_per_op", ns))
+            baseline[resultKey(name, impl, atoi(size.c_str()))] = atof(ns.c_str());
+    }
+
+    int nRegressions = 0;
+
+    std::cout << "operation                       baseline(ns)      now(ns)    change\n";
+
+    for (unsigned int i = 0; i < results.size(); i++)
+    {
+        std::string key = resultKey(results[i].name, results[i].impl, results[i].size);
+        std::map<std::string, double>::iterator it = baseline.find(key);
+
+        std::cout << std::left << std::setw(30) << key << std::right << std::fixed << std::setprecision(2);
+
+        if (it == baseline.end())
+        {
+            std::cout << std::setw(14) << "-" << std::setw(13) << results[i].nsPerOp << "       new\n";
+            continue;
+        }
+
+        double change = 100.0 * (results[i].nsPerOp - it->second) / it->second;
+        std::cout << std::setw(14) << it->second << std::setw(13) << results[i].nsPerOp
+                  << std::setw(9) << std::setprecision(1) << std::showpos << change << "%" << std::noshowpos;
+
+        if (change > threshold)
+        {
+            std::cout << "  REGRESSION";
+            nRegressions++;
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << nRegressions << " regression(s) above " << threshold << "%\n";
+    return nRegressions;
+}
+
+/* ----------------------------------------------------------------------------
+   static void randomPosition(HexBoard &board, unsigned int nStones, HexColor &turn);
+
+   Fills board with nStones stones of alternating colors (blue first) on random
+   cells, retrying until the position has no winner yet.  Returns the color to
+   move in turn.
+   ---------------------------------------------------------------------------- */
+static void randomPosition(HexBoard &board, unsigned int nStones, HexColor &turn)
+{
+    unsigned int n = board.Size();
+
+    while (true)
+    {
+        board = HexBoard(n);
+
+        HexMoveGenerator mg(board);
+        unsigned int id, row, col, i;
+        for (i = 0; (i < nStones) && mg.Next(id, row, col); i++)
+            board.SetColor(row, col, (((i % 2) == 0) ? HEXBLUE : HEXRED));
+
+        turn = (((i % 2) == 0) ? HEXBLUE : HEXRED);
+
+        if (board.Winner() == HEXBLANK)
+            return;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static void benchOrdering(unsigned int size, unsigned int nPositions);
+
+   Runs HexMCPlayer on the same positions with candidate ordering off and on,
+   and reports the average rollouts per move (the ordering pass included).
+   ---------------------------------------------------------------------------- */
+static void benchOrdering(unsigned int size, unsigned int nPositions)
+{
+    HexMCPlayer player;
+    HexPlayer *p = &player;
+    player.SetOption("cache", false);       // every position is searched twice
+
+    unsigned long rollouts[2] = {0, 0};
+    unsigned long prior = 0, cutoffs[2] = {0, 0}, candidates[2] = {0, 0};
+    double seconds[2] = {0, 0};
+
+    for (unsigned int iPos = 0; iPos < nPositions; iPos++)
+    {
+        HexBoard board(size);
+        HexColor turn;
+        randomPosition(board, size, turn);
+
+        for (unsigned int iMode = 0; iMode < 2; iMode++)
+        {
+            unsigned int row, col;
+            player.SetOption("ordering", (iMode == 1));
+
+            clock_t t0 = clock();
+            p->Move(board, turn, row, col);
+            seconds[iMode] += ((double) (clock() - t0)) / CLOCKS_PER_SEC;
+
+            HexMCStats stats = player.GetStats();
+            rollouts[iMode]   += stats.rollouts;
+            cutoffs[iMode]    += stats.cutoffs;
+            candidates[iMode] += stats.candidates;
+            if (iMode == 1) prior += stats.priorRollouts;
+        }
+    }
+
+    double perMove[2] = {((double) rollouts[0]) / nPositions, ((double) rollouts[1]) / nPositions};
+    double saved = perMove[0] - perMove[1];
+
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(4) << size
+              << std::setw(14) << perMove[0]
+              << std::setw(14) << perMove[1]
+              << std::setw(12) << ((double) prior) / nPositions
+              << std::setw(14) << saved
+              << std::setw(9) << ((perMove[0] > 0) ? (100.0 * saved / perMove[0]) : 0.0) << "%"
+              << std::setw(10) << ((candidates[0] > 0) ? (100.0 * cutoffs[0] / candidates[0]) : 0.0) << "%"
+              << std::setw(10) << ((candidates[1] > 0) ? (100.0 * cutoffs[1] / candidates[1]) : 0.0) << "%"
+              << std::setw(10) << std::setprecision(3) << seconds[0] / nPositions
+              << std::setw(10) << seconds[1] / nPositions
+              << "\n";
+}
+
+/* ----------------------------------------------------------------------------
+   static double scalingRun(unsigned int nThreads, bool pin, unsigned int size, unsigned int nBatches,
+                            std::vector<HexBoard> &positions, std::vector<HexColor> &turns,
+                            double &moveSeconds);
+
+   On a pool of nThreads workers, runs nBatches batches of rollouts on an
+   empty board, then one HexMCPlayer move on each position.  Returns the
+   seconds the rollouts took, and the seconds per move in moveSeconds.  Both
+   are started from a pool task, so that exactly nThreads threads work.
+   ---------------------------------------------------------------------------- */
+const unsigned int HEXBENCH_BATCH = 64;         // rollouts per ParallelFor index
+
+static double scalingRun(unsigned int nThreads, bool pin, unsigned int size, unsigned int nBatches,
+                         std::vector<HexBoard> &positions, std::vector<HexColor> &turns, double &moveSeconds)
+{
+    HexThreadPool pool(nThreads, pin);
+    std::vector<HexBridgePolicy> policies(pool.Slots());
+    std::atomic<unsigned long> wins(0);
+    double rolloutSeconds = 0;
+
+    HexMCPlayer player(200);
+    HexPlayer *p = &player;
+    player.SetOption("cache", false);
+    player.SetThreadPool(&pool);
+
+    pool.Submit([&]() {
+        HexBoard empty(size);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+        pool.ParallelFor(nBatches, [&](unsigned int, unsigned int slot) {
+            HexBoard board(empty);
+            board.SetTrialMode();
+            HexMoveGenerator mg(board);
+            policies[slot].Start(board);
+
+            for (unsigned int k = 0; k < HEXBENCH_BATCH; k++)
+            {
+                policies[slot].Playout(board, mg, HEXBLUE);
+                if (board.Winner() == HEXBLUE) wins++;
+            }
+        });
+
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        rolloutSeconds = std::chrono::duration<double>(t1 - t0).count();
+
+        for (unsigned int i = 0; i < positions.size(); i++)
+        {
+            HexBoard board(positions[i]);
+            unsigned int row, col;
+            p->Move(board, turns[i], row, col);
+        }
+
+        moveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count() / std::max<size_t>(1, positions.size());
+    });
+
+    pool.Wait();
+    sink += wins;
+    return rolloutSeconds;
+}
+
+/* ----------------------------------------------------------------------------
+   static void benchScaling(bool pin, unsigned int size, double seconds);
+
+   Prints rollout throughput and move time, with speedups, for 1 thread up
+   to one per core.
+   ---------------------------------------------------------------------------- */
+static void benchScaling(bool pin, unsigned int size, double seconds)
+{
+    unsigned int nCores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<HexBoard> positions;
+    std::vector<HexColor> turns;
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        HexBoard board(size);
+        HexColor turn;
+        randomPosition(board, size / 2, turn);
+        positions.push_back(board);
+        turns.push_back(turn);
+    }
+
+    // calibrate the rollout work to about the given seconds on one thread
+    std::vector<HexBoard> noPositions;
+    std::vector<HexColor> noTurns;
+    unsigned int nBatches = 16;
+    double moveSeconds, t;
+    while ((t = scalingRun(1, pin, size, nBatches, noPositions, noTurns, moveSeconds)) < seconds / 4)
+        nBatches *= 2;
+    nBatches = std::max(1.0, nBatches * seconds / t);
+
+    std::cout << "thread pool scaling on " << size << "x" << size << ", " << nBatches * HEXBENCH_BATCH
+              << " rollouts and " << positions.size() << " mc:200 moves per run" << (pin ? ", pinned" : "") << "\n"
+              << "threads    rollouts/s   speedup   efficiency   ms/move   speedup\n";
+
+    double base = 0, baseMove = 0;
+
+    for (unsigned int nThreads = 1; nThreads <= nCores; nThreads++)
+    {
+        double rollouts = scalingRun(nThreads, pin, size, nBatches, positions, turns, moveSeconds);
+
+        if (nThreads == 1)
+        {
+            base = rollouts;
+            baseMove = moveSeconds;
+        }
+
+        std::cout << std::fixed << std::setprecision(0)
+                  << std::setw(7) << nThreads
+                  << std::setw(14) << nBatches * HEXBENCH_BATCH / rollouts
+                  << std::setprecision(2)
+                  << std::setw(10) << base / rollouts
+                  << std::setw(12) << 100.0 * base / rollouts / nThreads << "%"
+                  << std::setw(10) << 1000.0 * moveSeconds
+                  << std::setw(10) << baseMove / moveSeconds
+                  << "\n" << std::flush;
+    }
+}
+
+static void usage(void)
+{
+    std::cout << "usage: hexbench [-sizes min-max] [-time seconds] [-compare baseline.json] [-threshold pct]\n"
+              << "       hexbench -ordering [size [positions]]\n"
+              << "       hexbench -scaling [-pin] [size [seconds]]\n";
+    exit(1);
+}
+
+// run the candidate ordering benchmark, arguments as in: hexbench -ordering [size [positions]]
+static int mainOrdering(int argc, char *argv[])
+{
+    unsigned int sizes[] = {5, 7, 9};
+    unsigned int nSizes = 3;
+    unsigned int nPositions = 5;
+
+    if (argc > 2)
+    {
+        std::istringstream ss(argv[2]);
+        ss >> sizes[0];
+        if (ss.fail() || (sizes[0] < HEXMINSIZE) || (sizes[0] > HEXMAXSIZE))
+            usage();
+        nSizes = 1;
+    }
+
+    if (argc > 3)
+    {
+        std::istringstream ss(argv[3]);
+        ss >> nPositions;
+        if (ss.fail() || (nPositions == 0))
+            usage();
+    }
+
+    srand(12345);
+
+    std::cout << "candidate ordering: rollouts per move (ordered includes prior pass)\n"
+              << "size     unordered       ordered       prior         saved     saved   cut(un)   cut(or)   sec(un)   sec(or)\n";
+
+    for (unsigned int i = 0; i < nSizes; i++)
+        benchOrdering(sizes[i], nPositions);
+
+    return 0;
+}
+
+// run the thread pool scaling benchmark, arguments as in: hexbench -scaling [-pin] [size [seconds]]
+static int mainScaling(int argc, char *argv[])
+{
+    unsigned int size = 11;
+    double seconds = 1.0;
+    int iArg = 2;
+    bool pin = ((argc > iArg) && !strcmp(argv[iArg], "-pin"));
+
+    if (pin)
+        iArg++;
+
+    if (argc > iArg)
+    {
+        std::istringstream ss(argv[iArg++]);
+        ss >> size;
+        if (ss.fail() || (size < HEXMINSIZE) || (size > HEXMAXSIZE))
+            usage();
+    }
+
+    if (argc > iArg)
+    {
+        std::istringstream ss(argv[iArg++]);
+        ss >> seconds;
+        if (ss.fail() || (seconds <= 0))
+            usage();
+    }
+
+    if (argc > iArg)
+        usage();
+
+    HexRandomSeed(12345);
+    benchScaling(pin, size, seconds);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int minSize = HEXMINSIZE, maxSize = HEXMAXSIZE;
+    double minSeconds = 0.02;
+    double threshold = 10.0;
+    const char *baseline = (const char *)0;
+
+    if ((argc > 1) && !strcmp(argv[1], "-ordering"))
+        return mainOrdering(argc, argv);
+
+    if ((argc > 1) && !strcmp(argv[1], "-scaling"))
+        return mainScaling(argc, argv);
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        if (iArg + 1 >= argc)
+            usage();
+
+        const char *opt = argv[iArg++];
+        std::istringstream ss(argv[iArg]);
+        char dash;
+
+        if (!strcmp(opt, "-sizes"))
+        {
+            ss >> minSize >> dash >> maxSize;
+            if (ss.fail() || (dash != '-') || (minSize < HEXMINSIZE) || (maxSize > HEXMAXSIZE) || (minSize > maxSize))
+                usage();
+        }
+        else if (!strcmp(opt, "-time"))
+        {
+            ss >> minSeconds;
+            if (ss.fail() || (minSeconds <= 0))
+                usage();
+        }
+        else if (!strcmp(opt, "-threshold"))
+        {
+            ss >> threshold;
+            if (ss.fail() || (threshold < 0))
+                usage();
+        }
+        else if (!strcmp(opt, "-compare"))
+            baseline = argv[iArg];
+        else
+            usage();
+    }
+
+    const unsigned int nBoards = 1000;
+    std::vector<BenchResult> results;
+    std::vector<unsigned int> mismatches;
+    bool disagree = false;
+
+    HexRandomSeed(12345);
+
+    // hardware counters are optional, without them only times are measured
+    if (!perf.Open())
+        std::cerr << "hardware counters unavailable (" << perf.Reason() << "), timing only\n";
+
+    for (unsigned int n = minSize; n <= maxSize; n++)
+    {
+        mismatches.push_back(checkWinners(n, nBoards));
+        if (mismatches.back() > 0)
+        {
+            std::cerr << "size " << n << ": board representations disagree on " << mismatches.back()
+                      << " of " << nBoards << " winners\n";
+            disagree = true;
+        }
+
+        unsigned int nAsymmetric = checkSymmetric(n, nBoards);
+        if (nAsymmetric > 0)
+        {
+            std::cerr << "size " << n << ": DropSymmetric lost or kept both cells of a pair on "
+                      << nAsymmetric << " of " << 2 * nBoards << " candidate sets\n";
+            disagree = true;
+        }
+
+        benchSize(n, minSeconds, results);
+    }
+
+    if (baseline == (const char *)0)
+    {
+        writeJson(results, mismatches, minSize, nBoards);
+        return (disagree ? 2 : 0);
+    }
+
+    int nRegressions = compare(results, baseline, threshold);
+    if (nRegressions < 0)
+    {
+        std::cout << "could not read baseline " << baseline << "\n";
+        return 1;
+    }
+
+    return (disagree ? 2 : ((nRegressions > 0) ? 1 : 0));
+}
@@ -0,0 +1,145 @@
+#include "hexbitboard.h"
+
+/* ============================================================================
+   HexBitBoard class
+
+   Blue stones are kept as one bit mask per row.  Red stones are kept
+   transposed, one bit mask per column, so that red's left to right
+   connection becomes a top to bottom connection on the transposed grid.  The
+   hex neighborhood is unchanged by transposition, so one connectivity routine
+   serves both colors.
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   HexBitBoard::HexBitBoard(unsigned int n);
+
+   constructor - creates an empty n x n board
+   ---------------------------------------------------------------------------- */
+HexBitBoard::HexBitBoard(unsigned int n)
+{
+    if ((n < HEXMINSIZE) || (n > HEXMAXSIZE))
+        throw HEXBOARD_ERR_INVALIDSIZE;
+
+    for (unsigned int i = 0; i < HEXMAXSIZE; i++)
+    {
+        blueBits[i] = 0;
+        redBits[i] = 0;
+    }
+
+    size = n;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBitBoard::SetColor(unsigned int row, unsigned int col, HexColor color);
+
+   Sets the given cell to the given color (HEXBLANK clears the cell).  Cells
+   may be overwritten.
+   ---------------------------------------------------------------------------- */
+void HexBitBoard::SetColor(unsigned int row, unsigned int col, HexColor color)
+{
+    if ((row >= size) || (col >= size))
+        throw HEXBOARD_ERR_INVALIDCELL;
+
+    blueBits[row] &= ~(1 << col);
+    redBits[col]  &= ~(1 << row);
+
+    if (color == HEXBLUE)
+        blueBits[row] |= (1 << col);
+    else if (color == HEXRED)
+        redBits[col] |= (1 << row);
+}
+
+/* ----------------------------------------------------------------------------
+   HexColor HexBitBoard::GetColor(unsigned int row, unsigned int col);
+
+   Return the color of the given cell (HEXBLANK, HEXBLUE, HEXRED)
+   ---------------------------------------------------------------------------- */
+HexColor HexBitBoard::GetColor(unsigned int row, unsigned int col)
+{
+    if ((row >= size) || (col >= size))
+        throw HEXBOARD_ERR_INVALIDCELL;
+
+    if (blueBits[row] & (1 << col)) return HEXBLUE;
+    if (redBits[col] & (1 << row)) return HEXRED;
+    return HEXBLANK;
+}
+
+/* ----------------------------------------------------------------------------
+   HexColor HexBitBoard::Winner(void);
+
+   Returns the color of the player who has won the game, or HEXBLANK if no
+   player has yet won the game.
+   ---------------------------------------------------------------------------- */
+HexColor HexBitBoard::Winner(void)
+{
+    if (connected(blueBits))
+        return HEXBLUE;
+    if (connected(redBits))
+        return HEXRED;
+    return HEXBLANK;
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexBitBoard::connected(const uint16_t *bits);
+
+   Determines whether the stones in bits connect the first row to the last.
+
+   reach[r] holds the stones of row r known to be connected to the first row.
+   Cell c of row r touches cells c and c+1 of the row above, and cells c-1
+   and c of the row below, so a whole row of reached cells can be propagated
+   with two shifts.  Rows are swept down and up until nothing changes, since
+   a chain may wind back up the board.
+   ---------------------------------------------------------------------------- */
+static inline uint16_t spread(uint16_t reached, uint16_t stones)
+{
+    // grow the reached cells along runs of stones in the same row
+    uint16_t next = reached & stones;
+    while (true)
+    {
+        uint16_t grown = (next | (next << 1) | (next >> 1)) & stones;
+        if (grown == next) return next;
+        next = grown;
+    }
+}
+
+bool HexBitBoard::connected(const uint16_t *bits)
+{
+    uint16_t reach[HEXMAXSIZE];
+    bool changed = true;
+
+    reach[0] = bits[0];
+    for (unsigned int r = 1; r < size; r++)
+        reach[r] = 0;
+
+    while (changed)
+    {
+        changed = false;
+
+        // downward sweep
+        for (unsigned int r = 1; r < size; r++)
+        {
+            uint16_t next = spread(reach[r] | reach[r - 1] | (reach[r - 1] >> 1), bits[r]);
+            if (next != reach[r])
+            {
+                reach[r] = next;
+                changed = true;
+            }
+        }
+
+        if (reach[size - 1] != 0)
+            return true;
+
+        // upward sweep
+        for (unsigned int r = size - 1; r-- > 0; )
+        {
+            uint16_t next = spread(reach[r] | reach[r + 1] | (reach[r + 1] << 1), bits[r]);
+            if (next != reach[r])
+            {
+                reach[r] = next;
+                changed = true;
+            }
+        }
+    }
+
+    return (reach[size - 1] != 0);
+}
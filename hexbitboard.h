@@ -0,0 +1,29 @@
+#ifndef _HEXBITBOARD_H_
+#define _HEXBITBOARD_H_
+
+#include <stdint.h>
+#include "hexboard.h"
+
+/* ============================================================================
+   HexBitBoard class
+
+   Compact board representation with one bit per cell and color.  Used as a
+   reference implementation to benchmark and cross-check HexBoard.
+   ============================================================================ */
+class HexBitBoard {
+    public:
+        HexBitBoard(unsigned int n);
+        void SetColor(unsigned int row, unsigned int col, HexColor color);
+        HexColor GetColor(unsigned int row, unsigned int col);
+        HexColor Winner(void);
+        inline unsigned int Size(void) { return size; }
+
+    private:
+        uint16_t blueBits[HEXMAXSIZE];      // bit c of blueBits[r] set if (r, c) is blue
+        uint16_t redBits[HEXMAXSIZE];       // red bits are transposed: bit r of redBits[c]
+        unsigned int size;
+
+        bool connected(const uint16_t *bits);
+};
+
+#endif
@@ -1,4 +1,34 @@
+#include <cstdlib>
 #include "hexboard.h"
+#include "hexstats.h"
+
+/* ----------------------------------------------------------------------------
+   void HexRandomSeed(uint64_t seed);
+   unsigned int HexRandom(unsigned int n);
+   
+   Per-thread xorshift64* generator.  HexRandom() returns a number in the
+   range [0, n).
+   ---------------------------------------------------------------------------- */
+static thread_local uint64_t rngState = 0;
+
+void HexRandomSeed(uint64_t seed)
+{   rngState = (seed ? seed : 0x9e3779b97f4a7c15ULL);  }
+
+unsigned int HexRandom(unsigned int n)
+{
+    if (rngState == 0)
+    {
+        // first use on this thread, mix in the state's address so that threads differ
+        HexRandomSeed(((uint64_t) rand() << 32) ^ ((uint64_t) rand()) ^ ((uint64_t) (size_t) &rngState));
+    }
+    
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    
+    uint64_t r = (rngState * 0x2545f4914f6cdd1dULL) >> 32;
+    return (unsigned int) ((r * n) >> 32);
+}
 
 /* ============================================================================
    class HexBoard
@@ -100,6 +130,8 @@ HexMoveResult HexBoard::SetColor(unsigned int row, unsigned int col, HexColor co
    ---------------------------------------------------------------------------- */
 HexColor HexBoard::Winner(void)
 {        
+    HEXSTATS_TIMER(HEXTIMER_WINNER);
+
     if (trialMode)
     {
         // if in trial mode, the value of the goal virtual cells is not reliable, as
@@ -189,6 +221,129 @@ void HexBoard::GetCells(HexCellSet &hcs, HexColor color)
     }
 }
 
+/* ----------------------------------------------------------------------------
+   bool HexBoard::IsSymmetric(void);
+   
+   Returns true if the board is unchanged by a 180 degree rotation, which maps
+   cell (row, col) to (size-1-row, size-1-col).  The rotation maps each edge to
+   the opposite edge of the same player, so on a self-symmetric board a move
+   and its rotated move are equally good.
+   ---------------------------------------------------------------------------- */
+bool HexBoard::IsSymmetric(void)
+{
+    unsigned int n2 = size * size;
+    
+    for (unsigned int iCell = 0; iCell < n2 / 2; iCell++)
+    {
+        if (G.GetVertexValue(iCell) != G.GetVertexValue(n2 - 1 - iCell))
+            return false;
+    }
+    
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBoard::Rotate(unsigned int &row, unsigned int &col);
+   
+   Replaces (row, col) by the cell it maps to under a 180 degree rotation
+   ---------------------------------------------------------------------------- */
+void HexBoard::Rotate(unsigned int &row, unsigned int &col)
+{
+    if ((row >= size) || (col >= size))
+        throw HEXBOARD_ERR_INVALIDCELL;
+        
+    row = size - 1 - row;
+    col = size - 1 - col;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBoard::DropSymmetric(HexCellSet &hcs);
+   
+   If the board is self-symmetric, removes from hcs every cell whose rotated
+   cell is also in hcs and comes first in row-major order, so that only one
+   cell of each equivalent pair is left;  a cell whose image is not in hcs
+   (e.g. pruned by a pattern) is kept.  Does nothing on a board that is not
+   symmetric.
+   ---------------------------------------------------------------------------- */
+void HexBoard::DropSymmetric(HexCellSet &hcs)
+{
+    if (!IsSymmetric())
+        return;
+        
+    unsigned int n2 = size * size;
+    unsigned int nKept = 0;
+    std::vector<bool> inSet(n2, false);
+    
+    for (unsigned int i = 0; i < hcs.size(); i++)
+        inSet[cellIndex(hcs[i].row, hcs[i].col)] = true;
+    
+    for (unsigned int i = 0; i < hcs.size(); i++)
+    {
+        unsigned int iCell = cellIndex(hcs[i].row, hcs[i].col);
+        unsigned int image = n2 - 1 - iCell;
+        
+        // keep the cell unless its image is kept in its place
+        if ((iCell <= image) || !inSet[image])
+            hcs[nKept++] = hcs[i];
+    }
+    
+    hcs.resize(nKept);
+}
+
+/* ----------------------------------------------------------------------------
+   uint64_t HexBoard::Hash(HexColor turn=HEXBLANK);
+   uint64_t HexBoard::CanonicalHash(HexColor turn, bool &rotated);
+   
+   Hash() returns a 64 bit Zobrist key for the position (board size, stones,
+   and the player to move if one is given).  Keys are the same from run to run
+   and may be stored in files.
+   
+   CanonicalHash() returns the same key for a position and its 180 degree
+   rotation:  the smaller of the two keys.  rotated is set to true if the key
+   is that of the rotated board, in which case cells looked up by this key must
+   be rotated back with Rotate().  Anything keyed by position should use
+   canonical keys.
+   ---------------------------------------------------------------------------- */
+uint64_t HexBoard::Hash(HexColor turn)
+{   return hash(turn, false);   }
+
+uint64_t HexBoard::CanonicalHash(HexColor turn, bool &rotated)
+{
+    uint64_t h = hash(turn, false);
+    uint64_t hr = hash(turn, true);
+    
+    rotated = (hr < h);
+    return (rotated ? hr : h);
+}
+
+// splitmix64 finalizer, used to derive a fixed random key for each (cell, color)
+static inline uint64_t zobristKey(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t HexBoard::hash(HexColor turn, bool rotated)
+{
+    unsigned int n2 = size * size;
+    uint64_t h = zobristKey(((uint64_t) size << 40) | ((uint64_t) turn << 32));
+    
+    for (unsigned int iCell = 0; iCell < n2; iCell++)
+    {
+        HexColor color = G.GetVertexValue(iCell);
+        
+        if (color == HEXBLANK)
+            continue;
+            
+        unsigned int iKey = (rotated ? (n2 - 1 - iCell) : iCell);
+        h ^= zobristKey(((uint64_t) size << 40) | (iKey << 2) | color);
+    }
+    
+    return h;
+}
+
 /* ----------------------------------------------------------------------------
    void HexBoard::SetTrialMode(void);
    
@@ -274,7 +429,22 @@ HexMoveGenerator::HexMoveGenerator(HexBoard &board)
     // retrieve all unoccupied cells on the board
     board.GetCells(hcs, HEXBLANK);
     // shuffle them to randomize them
-    std::random_shuffle(hcs.begin(), hcs.end());
+    HexShuffle(hcs);
+    // set cursor to beginning of sequence
+    cursor = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   HexMoveGenerator::HexMoveGenerator(HexCellSet &cells);
+   
+   constructor - uses the given set of cells as the valid moves, for clients
+   that have already narrowed down the unoccupied cells worth playing.
+   ---------------------------------------------------------------------------- */
+HexMoveGenerator::HexMoveGenerator(HexCellSet &cells)
+{
+    hcs = cells;
+    // shuffle them to randomize them
+    HexShuffle(hcs);
     // set cursor to beginning of sequence
     cursor = 0;
 }
@@ -330,6 +500,7 @@ unsigned int HexMoveGenerator::Count(void)
    ----------------------------------------------------------------------------- */
 void HexMoveGenerator::Shuffle(void)
 {
-    std::random_shuffle(hcs.begin(), hcs.end());
+    HEXSTATS_TIMER(HEXTIMER_SHUFFLE);
+    HexShuffle(hcs);
     cursor = 0;
 }
\ No newline at end of file
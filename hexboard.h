@@ -1,8 +1,12 @@
 #ifndef _HEXBOARD_H_
 #define _HEXBOARD_H_
 
+#include <stdint.h>
+#include <string>
 #include "mingraph.hpp"
 
+class HexStatsSnapshot;
+
 typedef enum enumHexColor {
     HEXNULL, HEXBLANK, HEXBLUE, HEXRED
 } HexColor;
@@ -42,6 +46,20 @@ typedef std::vector<HexCell> HexCellSet;
 // [0, n) 0 (inclusive) to n (exclusive)
 void GenerateRandomOrdering(unsigned int n, std::vector<unsigned int> &vOrdering);
 
+// per-thread random number generator, so that games and rollouts running on
+// several threads do not contend for the lock inside rand().  Unless seeded,
+// each thread seeds its generator from rand() on first use.
+void HexRandomSeed(uint64_t seed);
+unsigned int HexRandom(unsigned int n);        // uniform in [0, n)
+
+// randomly permutes the elements of v, using HexRandom()
+template <class T>
+void HexShuffle(std::vector<T> &v)
+{
+    for (unsigned int i = v.size(); i > 1; i--)
+        std::swap(v[i - 1], v[HexRandom(i)]);
+}
+
 
  
 
@@ -59,6 +77,12 @@ class HexBoard {
     HexColor Winner(void);
     void GetCells(HexCellSet &hcs, HexColor color=HEXBLANK);
     void SetTrialMode(void);
+    
+    bool IsSymmetric(void);
+    void Rotate(unsigned int &row, unsigned int &col);
+    void DropSymmetric(HexCellSet &hcs);
+    uint64_t Hash(HexColor turn=HEXBLANK);
+    uint64_t CanonicalHash(HexColor turn, bool &rotated);
 
     private:
     unsigned int size;    
@@ -72,6 +96,7 @@ class HexBoard {
     inline unsigned int rowFromIndex(unsigned int index) { return index / size; }
     inline unsigned int colFromIndex(unsigned int index) { return index % size; }    
     void Reset(unsigned int n);
+    uint64_t hash(HexColor turn, bool rotated);
     
     friend class HexGame;
 
@@ -89,14 +114,28 @@ class HexGameIO {
     void MoveFeedback(HexMoveResult result, HexColor turn, int row, int col);
     void AnnounceWinner(HexColor winner);
     void PrintBoard(HexBoard &board);
+    void MoveStats(unsigned int iMove, HexColor turn, int row, int col, HexStatsSnapshot &stats, bool json);
 };
 
 /* ============================================================================ *
  * HexPlayer class                                                              *
+ *                                                                              *
+ * LastMoveWork() reports the work of the player's last Move(), on all the     *
+ * threads it used, for game records;  players that do not keep such counts   *
+ * return false, and the caller measures the work itself.                      *
  * ============================================================================ */
+typedef struct structHexMoveWork {
+    uint64_t     rollouts;
+    unsigned int candidates;
+    unsigned int cutoffs;
+} HexMoveWork;
+
  class HexPlayer {
     public:
+    virtual ~HexPlayer(void) {}
+    virtual const char *Name(void) { return "human"; }
     virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+    virtual bool LastMoveWork(HexMoveWork &) { return false; }
 };
 
  
@@ -105,6 +144,10 @@ class HexGameIO {
  * ============================================================================ */
 typedef struct structHexGameOptions {
     bool mute;
+    bool stats;                 // print engine counters and timings after every move
+    bool statsJson;             // same, as one JSON object per line
+    std::string trace;          // if not empty, write a timeline of each game to this file
+    std::string record;         // if not empty, append a record of each game to this file
 } HexGameOptions;
 
 class HexGame {
@@ -115,6 +158,7 @@ class HexGame {
     HexColor Play(HexColor movesFirst);
     
     bool SetOption(const char *optname, bool optval);
+    bool SetOption(const char *optname, const char *optval);
     
     private:
     HexBoard  board;
@@ -136,6 +180,7 @@ class HexGame {
 class HexMoveGenerator {
     public:
     HexMoveGenerator(HexBoard &board);
+    HexMoveGenerator(HexCellSet &cells);
     bool Next(unsigned int &id, unsigned int &row, unsigned int &col);
     void Get(unsigned int id, unsigned int &row, unsigned int &col);
     void Shuffle(void);
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hexbook.h"
+
+/* ============================================================================
+   HexBook class
+
+   An opening book maps positions to the move a deep search chose for them.
+   Positions are identified by their canonical Zobrist key, so a position and
+   its 180 degree rotation share one entry; the stored move is for whichever
+   orientation produced the key, and is rotated back on lookup when needed.
+   ============================================================================ */
+
+static const char bookMagic[8] = {'H', 'E', 'X', 'B', 'O', 'O', 'K', '1'};
+
+static bool entryLess(const HexBookEntry &a, const HexBookEntry &b)
+{   return a.key < b.key;   }
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexBook(void)   -- creates an empty book
+    ~HexBook(void)  -- unmaps the book file, if any
+   ---------------------------------------------------------------------------- */
+HexBook::HexBook(void)
+{
+    mapping = (void *)0;
+    mappingSize = 0;
+    entries = (const HexBookEntry *)0;
+    count = 0;
+}
+
+HexBook::~HexBook(void)
+{   Close();    }
+
+/* ----------------------------------------------------------------------------
+   bool HexBook::Open(const char *filename);
+
+   Maps the given book file.  Returns false (and leaves the book empty) if the
+   file does not exist or is not a valid book.
+   ---------------------------------------------------------------------------- */
+bool HexBook::Open(const char *filename)
+{
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(HexBookHeader)))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                          // the mapping stays valid
+
+    if (p == MAP_FAILED)
+        return false;
+
+    const HexBookHeader *header = (const HexBookHeader *) p;
+    size_t expected = sizeof(HexBookHeader) + ((size_t) header->count) * sizeof(HexBookEntry);
+
+    if ((memcmp(header->magic, bookMagic, sizeof(bookMagic)) != 0) || (expected != (size_t) st.st_size))
+    {
+        munmap(p, st.st_size);
+        return false;
+    }
+
+    mapping = p;
+    mappingSize = st.st_size;
+    entries = (const HexBookEntry *) (header + 1);
+    count = header->count;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBook::Close(void);
+
+   Unmaps the book file, leaving an empty book.
+   ---------------------------------------------------------------------------- */
+void HexBook::Close(void)
+{
+    if (mapping != (void *)0)
+        munmap(mapping, mappingSize);
+
+    mapping = (void *)0;
+    mappingSize = 0;
+    entries = (const HexBookEntry *)0;
+    count = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexBook::Count(void);
+
+   Returns the number of positions in the book
+   ---------------------------------------------------------------------------- */
+unsigned int HexBook::Count(void)
+{   return count;   }
+
+/* ----------------------------------------------------------------------------
+   bool HexBook::Lookup(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+
+   Looks up the position on board with turn to move.  Returns true, and the
+   book move in (row, col), if the position is in the book.
+   ---------------------------------------------------------------------------- */
+bool HexBook::Lookup(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col)
+{
+    if (count == 0)
+        return false;
+
+    bool rotated;
+    HexBookEntry target;
+    target.key = board.CanonicalHash(turn, rotated);
+
+    const HexBookEntry *p = std::lower_bound(entries, entries + count, target, entryLess);
+
+    if ((p == entries + count) || (p->key != target.key) || (p->size != board.Size()))
+        return false;
+
+    unsigned int r = p->row, c = p->col;
+
+    // a stale or colliding entry must never produce an illegal move
+    if ((r >= board.Size()) || (c >= board.Size()))
+        return false;
+
+    if (rotated)
+        board.Rotate(r, c);
+
+    if (board.GetColor(r, c) != HEXBLANK)
+        return false;
+
+    row = r;
+    col = c;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   static void HexBook::Write(const char *filename, std::vector<HexBookEntry> &entries);
+
+   Sorts the given entries by key and writes them out as a book file.
+   Throws HEXBOOK_ERR_WRITE if the file cannot be written.
+   ---------------------------------------------------------------------------- */
+void HexBook::Write(const char *filename, std::vector<HexBookEntry> &entries)
+{
+    std::sort(entries.begin(), entries.end(), entryLess);
+
+    HexBookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, bookMagic, sizeof(bookMagic));
+    header.count = entries.size();
+
+    FILE *f = fopen(filename, "wb");
+    if (f == (FILE *)0)
+        throw HEXBOOK_ERR_WRITE;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+    if (ok && (entries.size() > 0))
+        ok = (fwrite(&entries[0], sizeof(HexBookEntry), entries.size(), f) == entries.size());
+
+    if ((fclose(f) != 0) || !ok)
+        throw HEXBOOK_ERR_WRITE;
+}
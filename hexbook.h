@@ -0,0 +1,56 @@
+#ifndef _HEXBOOK_H_
+#define _HEXBOOK_H_
+
+#include <stdint.h>
+#include <vector>
+#include "hexboard.h"
+
+typedef enum enumHexBookError {
+    HEXBOOK_ERR_WRITE = 0x400
+} HexBookError;
+
+// book files begin with this header, followed by entries sorted by key
+typedef struct structHexBookHeader {
+    char     magic[8];          // "HEXBOOK1"
+    uint32_t count;             // number of entries
+    uint32_t reserved;
+} HexBookHeader;
+
+typedef struct structHexBookEntry {
+    uint64_t key;               // HexBoard::CanonicalHash() of the position
+    uint8_t  size;              // board size, guards against key collisions
+    uint8_t  row;               // best move, for the canonical orientation
+    uint8_t  col;
+    uint8_t  reserved;
+    uint32_t score;             // wins per 10000 trials found by the search
+} HexBookEntry;
+
+/* ============================================================================
+   HexBook class
+
+   Read-only opening book.  The book file is memory mapped and searched in
+   place, so opening a book costs the same regardless of its size.
+   ============================================================================ */
+class HexBook {
+    public:
+    HexBook(void);
+    ~HexBook(void);
+    bool Open(const char *filename);
+    void Close(void);
+    unsigned int Count(void);
+    bool Lookup(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+
+    static void Write(const char *filename, std::vector<HexBookEntry> &entries);
+
+    private:
+    void *mapping;
+    size_t mappingSize;
+    const HexBookEntry *entries;
+    unsigned int count;
+
+    // no copies, the mapping is owned by a single object
+    HexBook(const HexBook &);
+    HexBook &operator=(const HexBook &);
+};
+
+#endif
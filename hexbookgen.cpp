@@ -0,0 +1,148 @@
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <cstdlib>
+#include "hexboard.h"
+#include "hexbook.h"
+#include "hexmcplayer.hpp"
+
+/* ============================================================================
+   hexbookgen
+
+   Builds an opening book by running deep HexMCPlayer searches on every early
+   position.
+
+   usage:  hexbookgen <bookfile> <plies> <trials> <size> [size ...]
+
+   For each board size, and for either player moving first, searches every
+   position reachable within the given number of plies from the empty board,
+   using the given number of trials per candidate.  Positions equivalent under
+   rotation are searched only once.
+   ============================================================================ */
+
+static void usage(void)
+{
+    std::cout << "usage: hexbookgen <bookfile> <plies> <trials> <size> [size ...]\n";
+    exit(1);
+}
+
+static unsigned int readArg(const char *arg, unsigned int minVal, unsigned int maxVal)
+{
+    std::istringstream ss(arg);
+    unsigned int t;
+
+    ss >> t;
+    if (ss.fail() || (t < minVal) || (t > maxVal))
+        usage();
+
+    return t;
+}
+
+/* ----------------------------------------------------------------------------
+   static void searchPosition(HexMCPlayer &player, HexBoard &board, HexColor turn,
+                              unsigned int nTrials, std::vector<HexBookEntry> &entries);
+
+   Searches the position on board and adds the result to entries, with the
+   move stored for the canonical orientation of the position.
+   ---------------------------------------------------------------------------- */
+static void searchPosition(HexMCPlayer &player, HexBoard &board, HexColor turn, unsigned int nTrials, std::vector<HexBookEntry> &entries)
+{
+    HexPlayer *p = &player;
+    unsigned int row, col;
+    bool rotated;
+
+    p->Move(board, turn, row, col);
+
+    HexBookEntry entry;
+    entry.key = board.CanonicalHash(turn, rotated);
+
+    if (rotated)
+        board.Rotate(row, col);
+
+    entry.size = board.Size();
+    entry.row = row;
+    entry.col = col;
+    entry.reserved = 0;
+    entry.score = (uint32_t) ((10000.0 * player.GetStats().score) / nTrials);
+
+    entries.push_back(entry);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+        usage();
+
+    const char *filename = argv[1];
+    unsigned int nPlies  = readArg(argv[2], 0, 4);
+    unsigned int nTrials = readArg(argv[3], 1, 1000000);
+
+    HexMCPlayer player(nTrials);
+    player.SetOption("cache", false);       // the search score of every position is needed
+    std::vector<HexBookEntry> entries;
+
+    srand(1);
+
+    for (int iArg = 4; iArg < argc; iArg++)
+    {
+        unsigned int size = readArg(argv[iArg], HEXMINSIZE, HEXMAXSIZE);
+
+        for (unsigned int iFirst = 0; iFirst < 2; iFirst++)
+        {
+            HexColor turns[2] = {((iFirst == 0) ? HEXBLUE : HEXRED), ((iFirst == 0) ? HEXRED : HEXBLUE)};
+
+            // expand one ply at a time, keeping one board per canonical position
+            std::vector<HexBoard> level(1, HexBoard(size));
+            std::set<uint64_t> seen;
+
+            for (unsigned int iPly = 0; iPly <= nPlies; iPly++)
+            {
+                HexColor turn = turns[iPly % 2];
+                std::vector<HexBoard> next;
+
+                for (unsigned int i = 0; i < level.size(); i++)
+                {
+                    searchPosition(player, level[i], turn, nTrials, entries);
+
+                    std::cout << "size " << size << " ply " << iPly << ": "
+                              << (i + 1) << "/" << level.size() << " positions\r" << std::flush;
+
+                    if (iPly == nPlies)
+                        continue;
+
+                    HexCellSet hcs;
+                    level[i].GetCells(hcs, HEXBLANK);
+
+                    for (unsigned int j = 0; j < hcs.size(); j++)
+                    {
+                        HexBoard child(level[i]);
+                        bool rotated;
+
+                        child.SetColor(hcs[j].row, hcs[j].col, turn);
+
+                        if ((child.Winner() == HEXBLANK) &&
+                            seen.insert(child.CanonicalHash(turns[(iPly + 1) % 2], rotated)).second)
+                            next.push_back(child);
+                    }
+                }
+
+                std::cout << "\n";
+                level.swap(next);
+            }
+        }
+    }
+
+    try
+    {
+        HexBook::Write(filename, entries);
+    }
+    catch (HexBookError e)
+    {
+        std::cout << "could not write " << filename << "\n";
+        return 1;
+    }
+    
+    std::cout << "wrote " << entries.size() << " positions to " << filename << "\n";
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#ifndef _HEXENGINES_HPP_
+#define _HEXENGINES_HPP_
+
+#include <cstring>
+#include <cstdlib>
+#include "hexboard.h"
+#include "hexbook.h"
+#include "hexmcplayer.hpp"
+#include "hexmc2player.hpp"
+#include "hexabplayer.hpp"
+
+/* ============================================================================
+   HexRandomPlayer class
+
+   Automatic player that plays a uniformly random open cell.  Useful as a
+   baseline opponent.
+   ============================================================================ */
+class HexRandomPlayer : public HexPlayer {
+    public:
+    virtual const char *Name(void) { return "random"; }
+
+    private:
+    virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+};
+
+void HexRandomPlayer::Move(HexBoard &board, HexColor, unsigned int &row, unsigned int &col)
+{
+    HexCellSet hcs;
+    board.GetCells(hcs, HEXBLANK);
+
+    if (hcs.size() == 0)
+        throw HEXBOARD_ERR_INVALIDCELL;
+
+    unsigned int i = HexRandom(hcs.size());
+    row = hcs[i].row;
+    col = hcs[i].col;
+}
+
+/* ----------------------------------------------------------------------------
+   HexPlayer *CreateEngine(const char *spec, HexBook *book=0, const HexNet *net=0,
+                           const HexPatternPolicy *patterns=0);
+
+   Creates an automatic player from a textual description:
+
+        mc[:trials]     HexMCPlayer, with the given trials per candidate
+        mcp[:trials]    same, with rollouts weighted by ring patterns
+        mcr[:trials]    same, with rollouts playing last good replies
+        mc2             HexMC2Player
+        ab[:seconds]    HexABPlayer, with the given time per move (default 1)
+        abr[:seconds]   same, scoring positions by circuit resistance
+        random          HexRandomPlayer
+
+   Engines that support an opening book are given book, those that use
+   move priors the policy network net, and mcp the pattern weights patterns
+   (uniform weights if null).  Returns a null pointer if spec does not
+   describe a known engine.  The caller owns the returned player.
+   ---------------------------------------------------------------------------- */
+HexPlayer *CreateEngine(const char *spec, HexBook *book=(HexBook *)0, const HexNet *net=(const HexNet *)0,
+                        const HexPatternPolicy *patterns=(const HexPatternPolicy *)0)
+{
+    const char *arg = strchr(spec, ':');
+    size_t nameLength = ((arg == (const char *)0) ? strlen(spec) : (size_t) (arg - spec));
+
+    if (((nameLength == 2) && !strncmp(spec, "mc", 2)) ||
+        ((nameLength == 3) && (!strncmp(spec, "mcp", 3) || !strncmp(spec, "mcr", 3))))
+    {
+        unsigned int trials = 1000;
+
+        if (arg != (const char *)0)
+        {
+            char *end;
+            unsigned long t = strtoul(arg + 1, &end, 10);
+            if ((*end != '\0') || (t == 0))
+                return (HexPlayer *)0;
+            trials = t;
+        }
+
+        HexMCPlayer *p = new HexMCPlayer(trials);
+        p->SetBook(book);
+        p->SetNetwork(net);
+        if (!strncmp(spec, "mcr", 3))
+            p->SetOption("replies", true);
+        if (!strncmp(spec, "mcp", 3))
+            p->SetPatterns((patterns != (const HexPatternPolicy *)0) ? *patterns : HexPatternPolicy());
+        return p;
+    }
+
+    if (((nameLength == 2) && !strncmp(spec, "ab", 2)) || ((nameLength == 3) && !strncmp(spec, "abr", 3)))
+    {
+        double seconds = 1.0;
+
+        if (arg != (const char *)0)
+        {
+            char *end;
+            seconds = strtod(arg + 1, &end);
+            if ((*end != '\0') || !(seconds > 0))
+                return (HexPlayer *)0;
+        }
+
+        HexABPlayer *p = new HexABPlayer(seconds);
+        p->SetOption("resistance", (nameLength == 3));
+        return p;
+    }
+
+    if (arg != (const char *)0)
+        return (HexPlayer *)0;
+
+    if (!strcmp(spec, "mc2"))
+        return new HexMC2Player;
+
+    if (!strcmp(spec, "random"))
+        return new HexRandomPlayer;
+
+    return (HexPlayer *)0;
+}
+
+#endif
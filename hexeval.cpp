@@ -0,0 +1,693 @@
+#include <algorithm>
+#include <cmath>
+#include "hexeval.h"
+
+static const int nbrRow[6] = {-1, -1, 0, 1,  1,  0};
+static const int nbrCol[6] = { 0,  1, 1, 0, -1, -1};
+
+// group of a cell that holds no stone of the color in hand
+static const unsigned int NOGROUP = ~0u;
+
+// two-distance of a cell that cannot reach the edge
+static const unsigned int TWODIST_FAR = 1 << 12;
+
+/* ----------------------------------------------------------------------------
+   void GetCellColors(HexBoard &board, HexCellColors &cells);
+
+   Copies the colors of the cells of board into cells, row-major.
+   ---------------------------------------------------------------------------- */
+void GetCellColors(HexBoard &board, HexCellColors &cells)
+{
+    unsigned int n = board.Size();
+    cells.resize(n * n);
+
+    for (unsigned int row = 0, iCell = 0; row < n; row++)
+        for (unsigned int col = 0; col < n; col++, iCell++)
+            cells[iCell] = board.GetColor(row, col);
+}
+
+/* ============================================================================
+   HexEvaluator class
+   ============================================================================ */
+
+// evaluate the position on board for color
+int HexEvaluator::EvaluateBoard(HexBoard &board, HexColor color, std::vector<int> *priority)
+{
+    GetCellColors(board, boardCells);
+    return Evaluate(boardCells, board.Size(), color, priority);
+}
+
+/* ============================================================================
+   HexTwoDistance class
+
+   Each color is handled in two steps.  connect() labels the color's groups,
+   with the blank cells around each group and the edges it touches, and then
+   lists the effective neighbors of every blank cell:  its blank neighbors
+   plus the blank cells around the groups it touches, and the edges it
+   touches directly or through those groups.  twoDistance() then runs a
+   level-synchronous search from one edge over these neighbors, in which a
+   cell is reached at level k + 1 when the second of its neighbors is
+   reached at level k.
+   ============================================================================ */
+
+// bit of color's edge that the off-board cell (row, col) lies beyond, 0 if none
+static inline unsigned int edgeBit(int row, int col, int n, HexColor color)
+{
+    if (color == HEXBLUE)
+        return ((row < 0) ? 1 : ((row >= n) ? 2 : 0));
+
+    return ((col < 0) ? 1 : ((col >= n) ? 2 : 0));
+}
+
+/* ----------------------------------------------------------------------------
+   HexTwoDistance::HexTwoDistance(void);
+
+   constructor - scratch space is sized on the first call to Evaluate()
+   ---------------------------------------------------------------------------- */
+HexTwoDistance::HexTwoDistance(void)
+{
+    size = 0;
+    stamp = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   int HexTwoDistance::Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority=0);
+
+   Scores the n x n position cells for color:  HEXTWODIST_WEIGHT times the
+   opponent's potential minus color's, plus color's mobility minus the
+   opponent's.  With priority, a blank cell's priority is minus the sum of
+   its potentials for both colors.
+   ---------------------------------------------------------------------------- */
+int HexTwoDistance::Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority)
+{
+    if (n != size)
+        reset(n);
+
+    HexColor opponent = ((color == HEXBLUE) ? HEXRED : HEXBLUE);
+
+    if (connect(cells, color))
+        return HEXEVAL_WIN;
+    twoDistance(1, dist[0]);
+    twoDistance(2, dist[1]);
+
+    if (connect(cells, opponent))
+        return -HEXEVAL_WIN;
+    twoDistance(1, dist[2]);
+    twoDistance(2, dist[3]);
+
+    unsigned int mobility, opponentMobility;
+    unsigned int p = potential(dist[0], dist[1], cells, mobility);
+    unsigned int opponentP = potential(dist[2], dist[3], cells, opponentMobility);
+
+    if (priority != (std::vector<int> *)0)
+    {
+        unsigned int n2 = n * n;
+        priority->resize(n2);
+
+        for (unsigned int i = 0; i < n2; i++)
+        {
+            unsigned int own = std::min(dist[0][i] + dist[1][i], TWODIST_FAR);
+            unsigned int other = std::min(dist[2][i] + dist[3][i], TWODIST_FAR);
+            (*priority)[i] = -((int) (own + other));
+        }
+    }
+
+    return HEXTWODIST_WEIGHT * ((int) opponentP - (int) p) + ((int) mobility - (int) opponentMobility);
+}
+
+// size the scratch space for a board of n x n cells
+void HexTwoDistance::reset(unsigned int n)
+{
+    unsigned int n2 = n * n;
+
+    size = n;
+    group.resize(n2);
+    nbrStart.resize(n2 + 1);
+    cellEdges.resize(n2);
+    count.resize(n2);
+    mark.assign(n2, 0);
+    groupMark.assign(n2, 0);
+    stamp = 0;
+
+    for (unsigned int i = 0; i < 4; i++)
+        dist[i].resize(n2);
+}
+
+// a stamp not yet in mark or groupMark
+unsigned int HexTwoDistance::nextStamp(void)
+{
+    if (++stamp == 0)
+    {
+        std::fill(mark.begin(), mark.end(), 0);
+        std::fill(groupMark.begin(), groupMark.end(), 0);
+        stamp = 1;
+    }
+
+    return stamp;
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexTwoDistance::connect(const HexCellColors &cells, HexColor color);
+
+   Labels color's groups and lists the effective neighbors and edges of
+   every blank cell, for twoDistance().  Returns true if a group touches
+   both of color's edges, i.e. color has won.
+   ---------------------------------------------------------------------------- */
+bool HexTwoDistance::connect(const HexCellColors &cells, HexColor color)
+{
+    int n = size;
+    unsigned int n2 = size * size;
+    bool won = false;
+
+    std::fill(group.begin(), group.end(), NOGROUP);
+    stones.clear();
+    groupStart.clear();
+    libs.clear();
+    libStart.clear();
+    groupEdges.clear();
+
+    // flood fill each group, using its part of stones as the queue
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if ((cells[i] != color) || (group[i] != NOGROUP))
+            continue;
+
+        unsigned int g = groupStart.size();
+        unsigned int s = nextStamp();
+
+        groupStart.push_back(stones.size());
+        libStart.push_back(libs.size());
+        groupEdges.push_back(0);
+
+        group[i] = g;
+        stones.push_back(i);
+
+        for (unsigned int k = groupStart[g]; k < stones.size(); k++)
+        {
+            int row = stones[k] / size, col = stones[k] % size;
+
+            for (unsigned int d = 0; d < 6; d++)
+            {
+                int r = row + nbrRow[d], c = col + nbrCol[d];
+
+                if ((r < 0) || (r >= n) || (c < 0) || (c >= n))
+                {
+                    groupEdges[g] |= edgeBit(r, c, n, color);
+                    continue;
+                }
+
+                unsigned int j = r * size + c;
+                if ((cells[j] == color) && (group[j] == NOGROUP))
+                {
+                    group[j] = g;
+                    stones.push_back(j);
+                }
+                else if ((cells[j] == HEXBLANK) && (mark[j] != s))
+                {
+                    mark[j] = s;
+                    libs.push_back(j);
+                }
+            }
+        }
+
+        if (groupEdges[g] == 3)
+            won = true;
+    }
+
+    libStart.push_back(libs.size());
+
+    if (won)
+        return true;
+
+    // effective neighbors of the blank cells
+    nbrs.clear();
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        nbrStart[i] = nbrs.size();
+        cellEdges[i] = 0;
+
+        if (cells[i] != HEXBLANK)
+            continue;
+
+        unsigned int s = nextStamp();
+        int row = i / size, col = i % size;
+        mark[i] = s;
+
+        for (unsigned int d = 0; d < 6; d++)
+        {
+            int r = row + nbrRow[d], c = col + nbrCol[d];
+
+            if ((r < 0) || (r >= n) || (c < 0) || (c >= n))
+            {
+                cellEdges[i] |= edgeBit(r, c, n, color);
+                continue;
+            }
+
+            unsigned int j = r * size + c;
+            if (cells[j] == HEXBLANK)
+            {
+                if (mark[j] != s)
+                {
+                    mark[j] = s;
+                    nbrs.push_back(j);
+                }
+            }
+            else if ((cells[j] == color) && (groupMark[group[j]] != s))
+            {
+                unsigned int g = group[j];
+                groupMark[g] = s;
+                cellEdges[i] |= groupEdges[g];
+
+                for (unsigned int k = libStart[g]; k < libStart[g + 1]; k++)
+                {
+                    if (mark[libs[k]] != s)
+                    {
+                        mark[libs[k]] = s;
+                        nbrs.push_back(libs[k]);
+                    }
+                }
+            }
+        }
+    }
+    nbrStart[n2] = nbrs.size();
+
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexTwoDistance::twoDistance(unsigned int edge, std::vector<unsigned int> &d);
+
+   Computes the two-distance of every blank cell from the edge with the given
+   bit, over the neighbors listed by the last connect().  Cells that cannot
+   reach the edge, and occupied cells, get TWODIST_FAR.
+   ---------------------------------------------------------------------------- */
+void HexTwoDistance::twoDistance(unsigned int edge, std::vector<unsigned int> &d)
+{
+    unsigned int n2 = size * size;
+
+    std::fill(d.begin(), d.end(), TWODIST_FAR);
+    std::fill(count.begin(), count.end(), 0);
+    level.clear();
+
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if (cellEdges[i] & edge)
+        {
+            d[i] = 1;
+            level.push_back(i);
+        }
+    }
+
+    for (unsigned int k = 1; !level.empty(); k++)
+    {
+        nextLevel.clear();
+
+        for (unsigned int i = 0; i < level.size(); i++)
+        {
+            unsigned int p = level[i];
+
+            for (unsigned int j = nbrStart[p]; j < nbrStart[p + 1]; j++)
+            {
+                unsigned int q = nbrs[j];
+                if ((d[q] == TWODIST_FAR) && (++count[q] == 2))
+                {
+                    d[q] = k + 1;
+                    nextLevel.push_back(q);
+                }
+            }
+        }
+
+        level.swap(nextLevel);
+    }
+}
+
+// least sum of the two distances over the blank cells, and the number of cells reaching it
+unsigned int HexTwoDistance::potential(const std::vector<unsigned int> &d0, const std::vector<unsigned int> &d1, const HexCellColors &cells, unsigned int &mobility)
+{
+    unsigned int best = 2 * TWODIST_FAR;
+    mobility = 0;
+
+    for (unsigned int i = 0; i < d0.size(); i++)
+    {
+        if (cells[i] != HEXBLANK)
+            continue;
+
+        unsigned int sum = d0[i] + d1[i];
+        if (sum < best)
+        {
+            best = sum;
+            mobility = 1;
+        }
+        else if (sum == best)
+            mobility++;
+    }
+
+    return best;
+}
+
+/* ============================================================================
+   HexResistance class
+
+   network() merges the color's groups, and the groups touching an edge with
+   that edge, into single nodes (union-find, the root naming the node), and
+   lists the resistors between distinct nodes.  Regions walled off from both
+   edges by the opponent carry no current and would make the system
+   singular, so they are dropped.  solve() then finds the potentials of the
+   remaining nodes, with edge 0 at 1 and edge 1 at 0, and returns the total
+   conductance between the edges.
+   ============================================================================ */
+
+// forward half of the neighbor offsets, to visit each pair of adjacent cells once
+static const int halfRow[3] = {0, 1,  1};
+static const int halfCol[3] = {1, 0, -1};
+
+/* ----------------------------------------------------------------------------
+   HexResistance::HexResistance(void);
+
+   constructor - scratch space is sized on the first call to Evaluate()
+   ---------------------------------------------------------------------------- */
+HexResistance::HexResistance(void)
+{
+    size = 0;
+    warmStart = true;
+    iterations = 0;
+}
+
+// start each solve from the previous potentials (default), or from scratch
+void HexResistance::SetWarmStart(bool on)
+{   warmStart = on; }
+
+unsigned int HexResistance::Iterations(void)
+{   return iterations;  }
+
+/* ----------------------------------------------------------------------------
+   int HexResistance::Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority=0);
+
+   Scores the n x n position cells for color:  HEXRES_SCALE times the log of
+   color's conductance over the opponent's.  With priority, a blank cell's
+   priority is the fraction of color's current through it plus the fraction
+   of the opponent's, in units of 1 / HEXRES_PRIORITYSCALE.
+   ---------------------------------------------------------------------------- */
+int HexResistance::Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority)
+{
+    if (n != size)
+        reset(n);
+
+    HexColor opponent = ((color == HEXBLUE) ? HEXRED : HEXBLUE);
+    iterations = 0;
+
+    if (network(cells, color))
+        return HEXEVAL_WIN;
+    double own = solve(((color == HEXBLUE) ? 0 : 1), flow[0]);
+
+    if (network(cells, opponent))
+        return -HEXEVAL_WIN;
+    double other = solve(((opponent == HEXBLUE) ? 0 : 1), flow[1]);
+
+    // no current means walled off, which the group check has already caught
+    if (own <= 0)
+        return -HEXEVAL_WIN;
+    if (other <= 0)
+        return HEXEVAL_WIN;
+
+    if (priority != (std::vector<int> *)0)
+    {
+        unsigned int n2 = n * n;
+        priority->resize(n2);
+
+        for (unsigned int i = 0; i < n2; i++)
+            (*priority)[i] = (int) (HEXRES_PRIORITYSCALE * (flow[0][i] / own + flow[1][i] / other));
+    }
+
+    double score = HEXRES_SCALE * log(own / other);
+    double limit = HEXEVAL_WIN / 2;
+    return (int) std::max(-limit, std::min(limit, score));
+}
+
+// size the scratch space for a board of n x n cells, and forget earlier solutions
+void HexResistance::reset(unsigned int n)
+{
+    unsigned int nNodes = n * n + 2;
+
+    size = n;
+    node.resize(nNodes);
+    x.resize(nNodes);
+    r.resize(nNodes);
+    z.resize(nNodes);
+    p.resize(nNodes);
+    q.resize(nNodes);
+    diag.resize(nNodes);
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        potentials[i].assign(nNodes, 0);
+        flow[i].resize(n * n);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexResistance::network(const HexCellColors &cells, HexColor color);
+
+   Builds color's network for solve().  Returns true if color's stones
+   already connect its edges.
+   ---------------------------------------------------------------------------- */
+bool HexResistance::network(const HexCellColors &cells, HexColor color)
+{
+    int n = size;
+    unsigned int n2 = size * size;
+    unsigned int edge[2] = {n2, n2 + 1};
+
+    // merge the color's groups, and the groups touching an edge into it
+    groups.Reset(n2 + 2);
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if (cells[i] != color)
+            continue;
+
+        int row = i / size, col = i % size;
+        for (unsigned int d = 0; d < 6; d++)
+        {
+            int nr = row + nbrRow[d], nc = col + nbrCol[d];
+
+            if ((nr < 0) || (nr >= n) || (nc < 0) || (nc >= n))
+            {
+                unsigned int bit = edgeBit(nr, nc, n, color);
+                if (bit != 0)
+                    groups.Join(i, edge[bit - 1]);
+            }
+            else if (cells[nr * size + nc] == color)
+                groups.Join(i, nr * size + nc);
+        }
+    }
+
+    if (groups.Connected(edge[0], edge[1]))
+        return true;
+
+    for (unsigned int i = 0; i < n2 + 2; i++)
+        node[i] = groups.Find(i);
+
+    // resistors between adjacent cells, and between edge cells and their edges;
+    // a blank cell counts 1, a stone or an edge 0, so none joins two stones
+    resistors.clear();
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if ((cells[i] != HEXBLANK) && (cells[i] != color))
+            continue;
+
+        int row = i / size, col = i % size;
+        double ri = ((cells[i] == HEXBLANK) ? 1 : 0);
+
+        for (unsigned int d = 0; d < 3; d++)
+        {
+            int nr = row + halfRow[d], nc = col + halfCol[d];
+            if ((nr < 0) || (nr >= n) || (nc < 0) || (nc >= n))
+                continue;
+
+            unsigned int j = nr * size + nc;
+            if (((cells[j] != HEXBLANK) && (cells[j] != color)) || (node[i] == node[j]))
+                continue;
+
+            HexResistor res = {node[i], node[j], 1 / (ri + ((cells[j] == HEXBLANK) ? 1 : 0))};
+            resistors.push_back(res);
+        }
+
+        // a blank cell on an edge touches it once, however many sides face it
+        unsigned int bits = 0;
+        for (unsigned int d = 0; d < 6; d++)
+        {
+            int nr = row + nbrRow[d], nc = col + nbrCol[d];
+            if ((nr < 0) || (nr >= n) || (nc < 0) || (nc >= n))
+                bits |= edgeBit(nr, nc, n, color);
+        }
+
+        for (unsigned int e = 0; e < 2; e++)
+        {
+            if ((bits & (1 << e)) && (node[i] != node[edge[e]]))
+            {
+                HexResistor res = {node[i], node[edge[e]], 1};
+                resistors.push_back(res);
+            }
+        }
+    }
+
+    // keep the nodes (and resistors) connected to an edge
+    groups.Checkpoint();
+    for (unsigned int k = 0; k < resistors.size(); k++)
+        groups.Join(resistors[k].a, resistors[k].b);
+
+    unsigned int live[2] = {groups.Find(edge[0]), groups.Find(edge[1])};
+    unsigned int nKept = 0;
+    for (unsigned int k = 0; k < resistors.size(); k++)
+    {
+        unsigned int root = groups.Find(resistors[k].a);
+        if ((root == live[0]) || (root == live[1]))
+            resistors[nKept++] = resistors[k];
+    }
+    resistors.resize(nKept);
+
+    unknowns.clear();
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if (((cells[i] != HEXBLANK) && (cells[i] != color)) || (node[i] != i) ||
+            (node[i] == node[edge[0]]) || (node[i] == node[edge[1]]))
+            continue;
+
+        unsigned int root = groups.Find(i);
+        if ((root == live[0]) || (root == live[1]))
+            unknowns.push_back(i);
+    }
+    groups.Rollback();
+
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   double HexResistance::solve(unsigned int net, std::vector<double> &cellFlow);
+
+   Solves the network built by network() for its node potentials, by
+   conjugate gradients started from the last solution of the same network
+   (net 0 blue, 1 red), which it then replaces.  Fills cellFlow with the
+   current through each blank cell, and returns the conductance between the
+   edges.
+   ---------------------------------------------------------------------------- */
+double HexResistance::solve(unsigned int net, std::vector<double> &cellFlow)
+{
+    unsigned int n2 = size * size;
+    unsigned int source = node[n2], sink = node[n2 + 1];
+    std::vector<double> &last = potentials[net];
+
+    for (unsigned int k = 0; k < unknowns.size(); k++)
+    {
+        unsigned int u = unknowns[k];
+        x[u] = (warmStart ? last[u] : 0);
+        r[u] = 0;
+        z[u] = 0;
+        diag[u] = 0;
+    }
+    x[source] = 1;
+    x[sink] = 0;
+
+    // residual b - A x, as the current flowing into each node, and the right
+    // hand side b (in z), as the current the source alone would drive into it
+    double bNorm = 0;
+    for (unsigned int k = 0; k < resistors.size(); k++)
+    {
+        const HexResistor &res = resistors[k];
+        double current = res.conductance * (x[res.b] - x[res.a]);
+
+        r[res.a] += current;
+        r[res.b] -= current;
+        diag[res.a] += res.conductance;
+        diag[res.b] += res.conductance;
+
+        if (res.a == source) z[res.b] += res.conductance;
+        if (res.b == source) z[res.a] += res.conductance;
+    }
+    r[source] = r[sink] = 0;
+    p[source] = p[sink] = 0;
+
+    double rz = 0;
+    for (unsigned int k = 0; k < unknowns.size(); k++)
+    {
+        unsigned int u = unknowns[k];
+        bNorm += z[u] * z[u];
+        z[u] = r[u] / diag[u];
+        p[u] = z[u];
+        rz += r[u] * z[u];
+    }
+    bNorm = sqrt(bNorm);
+
+    unsigned int maxIterations = 2 * unknowns.size() + 10;
+    for (unsigned int it = 0; it < maxIterations; it++)
+    {
+        double rr = 0;
+        for (unsigned int k = 0; k < unknowns.size(); k++)
+            rr += r[unknowns[k]] * r[unknowns[k]];
+        if (sqrt(rr) <= HEXRES_TOLERANCE * bNorm)
+            break;
+
+        iterations++;
+
+        // q = A p, with the edges held at 0
+        for (unsigned int k = 0; k < unknowns.size(); k++)
+            q[unknowns[k]] = 0;
+        for (unsigned int k = 0; k < resistors.size(); k++)
+        {
+            const HexResistor &res = resistors[k];
+            double d = res.conductance * (p[res.a] - p[res.b]);
+            q[res.a] += d;
+            q[res.b] -= d;
+        }
+
+        double pq = 0;
+        for (unsigned int k = 0; k < unknowns.size(); k++)
+            pq += p[unknowns[k]] * q[unknowns[k]];
+        if (pq <= 0)
+            break;
+
+        double alpha = rz / pq;
+        double rzNext = 0;
+        for (unsigned int k = 0; k < unknowns.size(); k++)
+        {
+            unsigned int u = unknowns[k];
+            x[u] += alpha * p[u];
+            r[u] -= alpha * q[u];
+            z[u] = r[u] / diag[u];
+            rzNext += r[u] * z[u];
+        }
+
+        double beta = rzNext / rz;
+        rz = rzNext;
+        for (unsigned int k = 0; k < unknowns.size(); k++)
+            p[unknowns[k]] = z[unknowns[k]] + beta * p[unknowns[k]];
+    }
+
+    // conductance as the power dissipated at unit voltage:  the potentials
+    // minimize it, so its error is only quadratic in theirs;  and the current
+    // through each node
+    double conductance = 0;
+    std::fill(q.begin(), q.end(), 0);
+    for (unsigned int k = 0; k < resistors.size(); k++)
+    {
+        const HexResistor &res = resistors[k];
+        double current = res.conductance * (x[res.a] - x[res.b]);
+
+        conductance += current * (x[res.a] - x[res.b]);
+
+        q[res.a] += fabs(current);
+        q[res.b] += fabs(current);
+    }
+
+    // every current enters and leaves a cell, so it is counted twice
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        unsigned int u = node[i];
+        bool open = ((u == i) && (u != source) && (u != sink));
+        cellFlow[i] = (open ? q[u] / 2 : 0);
+
+        // remember the potentials by cell, for the next solve to start from
+        last[i] = x[u];
+    }
+
+    return conductance;
+}
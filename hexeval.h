@@ -0,0 +1,144 @@
+#ifndef _HEXEVAL_H_
+#define _HEXEVAL_H_
+
+#include <vector>
+#include "hexboard.h"
+#include "rollbackunionfind.hpp"
+
+// colors of the cells of an n x n board, row-major:  a position that searches
+// can set and clear cells of in place, which HexBoard does not allow
+typedef std::vector<HexColor> HexCellColors;
+
+void GetCellColors(HexBoard &board, HexCellColors &cells);
+
+// score of a position that a side has already won
+const int HEXEVAL_WIN = 1 << 24;
+
+/* ============================================================================
+   HexEvaluator class
+
+   Deterministic static evaluation of a position, as an alternative to
+   random playouts.  Evaluate() scores the position for color:  positive
+   when color is ahead, HEXEVAL_WIN (or -HEXEVAL_WIN) when color (or its
+   opponent) has already connected its edges.  With priority, it also rates
+   every blank cell as a move for either side (higher is more urgent), for
+   move ordering;  the entries of occupied cells are unspecified.
+
+   Evaluators keep scratch space between calls, so each thread needs its
+   own.
+   ============================================================================ */
+class HexEvaluator {
+    public:
+    virtual ~HexEvaluator(void) {}
+    virtual const char *Name(void) = 0;
+    virtual int Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority=(std::vector<int> *)0) = 0;
+    int EvaluateBoard(HexBoard &board, HexColor color, std::vector<int> *priority=(std::vector<int> *)0);
+
+    private:
+    HexCellColors boardCells;
+};
+
+/* ============================================================================
+   HexTwoDistance class
+
+   Two-distance evaluator (as in Queenbee).  For each color and each of its
+   edges, the two-distance of a blank cell is 1 if it touches the edge, and
+   otherwise one more than the second smallest two-distance among its
+   neighbors:  the opponent can always block the best neighbor, so only the
+   second best counts.  The color's own stones are transparent (a cell's
+   neighbors include the blank cells around the groups it touches), the
+   opponent's stones are walls.
+
+   The potential of a color is the least sum of its two distances over the
+   blank cells, i.e. roughly the moves it still needs against resistance;
+   its mobility is the number of cells reaching that minimum.  A position
+   scores HEXTWODIST_WEIGHT per unit of potential difference, with the
+   mobility difference breaking ties.  A cell's priority is how close it is
+   to the least-potential paths of both colors.
+   ============================================================================ */
+const int HEXTWODIST_WEIGHT = 1000;
+
+class HexTwoDistance : public HexEvaluator {
+    public:
+    HexTwoDistance(void);
+    virtual const char *Name(void) { return "twodistance"; }
+    virtual int Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority=(std::vector<int> *)0);
+
+    private:
+    unsigned int size;
+    std::vector<unsigned int> group;        // group of each stone of the color in hand
+    std::vector<unsigned int> stones;       // stones of each group, in group order
+    std::vector<unsigned int> groupStart;   // first entry of each group in stones
+    std::vector<unsigned int> libs;         // blank cells adjacent to each group
+    std::vector<unsigned int> libStart;     // first entry of each group in libs
+    std::vector<unsigned char> groupEdges;  // edges each group touches (bit 0, bit 1)
+    std::vector<unsigned int> nbrs;         // effective neighbors of each blank cell
+    std::vector<unsigned int> nbrStart;     // first entry of each cell in nbrs
+    std::vector<unsigned char> cellEdges;   // edges each blank cell touches, directly or through a group
+    std::vector<unsigned int> mark;         // stamps, to list each neighbor once
+    std::vector<unsigned int> groupMark;    // same, to visit each group once
+    unsigned int stamp;
+    std::vector<unsigned int> count;        // neighbors already reached, per cell
+    std::vector<unsigned int> level, nextLevel;
+    std::vector<unsigned int> dist[4];      // two-distances:  color's edge 0, edge 1, opponent's edge 0, edge 1
+
+    void reset(unsigned int n);
+    bool connect(const HexCellColors &cells, HexColor color);
+    void twoDistance(unsigned int edge, std::vector<unsigned int> &d);
+    unsigned int potential(const std::vector<unsigned int> &d0, const std::vector<unsigned int> &d1, const HexCellColors &cells, unsigned int &mobility);
+    unsigned int nextStamp(void);
+};
+
+/* ============================================================================
+   HexResistance class
+
+   Circuit evaluator (Shannon, Anshelevich).  Each color's board is a
+   resistor network between its two edges:  a blank cell is a unit
+   resistor, the color's own stones conduct perfectly (each group is one
+   node, and groups touching an edge are part of that edge), the opponent's
+   stones are open circuits, and adjacent cells are joined through both of
+   their resistances.  A position scores HEXRES_SCALE times the log of the
+   opponent's resistance over color's.  A cell's priority is the share of
+   each network's current flowing through it, summed over both networks.
+
+   With a unit voltage across the edges, the node potentials are found by
+   Jacobi-preconditioned conjugate gradients, started from the potentials
+   of the previous evaluation:  within a search that is the parent's or a
+   sibling's position, a few stones away, so a child needs only a few
+   iterations.
+   ============================================================================ */
+const int HEXRES_SCALE = 1000;
+const double HEXRES_TOLERANCE = 1e-3;       // residual, relative to the right hand side
+const int HEXRES_PRIORITYSCALE = 1 << 16;   // priority of a cell carrying all current
+
+typedef struct structHexResistor {
+    unsigned int a, b;                      // nodes
+    double conductance;
+} HexResistor;
+
+class HexResistance : public HexEvaluator {
+    public:
+    HexResistance(void);
+    virtual const char *Name(void) { return "resistance"; }
+    virtual int Evaluate(const HexCellColors &cells, unsigned int n, HexColor color, std::vector<int> *priority=(std::vector<int> *)0);
+    void SetWarmStart(bool on);
+    unsigned int Iterations(void);          // solver iterations of the last Evaluate(), both networks
+
+    private:
+    unsigned int size;
+    bool warmStart;
+    unsigned int iterations;
+    RollbackUnionFind<unsigned short> groups;   // cells and edges conducting perfectly
+    std::vector<unsigned int> node;         // node of each cell and edge, the root of its group
+    std::vector<HexResistor> resistors;
+    std::vector<unsigned int> unknowns;     // nodes of unknown potential
+    std::vector<double> potentials[2];      // last solution of the blue and red networks, per cell
+    std::vector<double> x, r, z, p, q, diag;    // solver vectors, per node
+    std::vector<double> flow[2];            // current through each blank cell, color's and opponent's
+
+    void reset(unsigned int n);
+    bool network(const HexCellColors &cells, HexColor color);
+    double solve(unsigned int net, std::vector<double> &cellFlow);
+};
+
+#endif
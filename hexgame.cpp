@@ -2,7 +2,11 @@
 #include <cstring>
 #include <sstream>
 #include <cstdlib>
+#include <chrono>
 #include "hexboard.h"
+#include "hexstats.h"
+#include "hextrace.h"
+#include "hexrecord.h"
 
 /* ============================================================================
    HexGame class
@@ -42,14 +46,14 @@ HexColor HexGame::RegisterPlayer(HexPlayer *p, HexColor color)
     {
         // register as blue player
         pBluePlayer = p;
-        std::cout << "Assigned BLUE\n";
+        if (!options.mute) std::cout << "Assigned BLUE\n";
         return HEXBLUE;
     }
     else if (((color == HEXRED) || (color == HEXBLANK)) && (pRedPlayer == (HexPlayer *)0))
     {
         // register as red player
         pRedPlayer = p;
-        std::cout << "Assigned RED\n";
+        if (!options.mute) std::cout << "Assigned RED\n";
         return HEXRED;
     }
     
@@ -110,6 +114,15 @@ HexColor HexGame::Play(HexColor movesFirst)
         players[0] = pRedPlayer;
         players[1] = pBluePlayer;
     }
+    
+    // with the trace option, record this game's timeline
+    if (!options.trace.empty())
+        HexTrace::Start();
+    HexTrace::Begin("game");
+    
+    // with the record option, keep the moves to append them to the record file
+    HexRecordWriter record;
+    record.Start(board.Size(), movesFirst, pBluePlayer->Name(), pRedPlayer->Name());
         
     // start play, alternate turns until there is a winner
     for (unsigned int iTurn = 0; winner == HEXBLANK; iTurn++)
@@ -129,8 +142,19 @@ HexColor HexGame::Play(HexColor movesFirst)
         {
             if (!options.mute) gameIO.Prompt(thisTurn);
             
-            // prompt player for move
-            thisPlayer->Move(boardCopy, thisTurn, row, col);
+            // prompt player for move, timing it;  the counters are process wide,
+            // so that work the player hands to a thread pool is included
+            HexStatsSnapshot before;
+            if (options.stats || options.statsJson || !options.record.empty())
+                HexStats::Snapshot(before);
+            
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            {
+                HEXTRACE_SCOPE(((thisTurn == HEXBLUE) ? "blue move" : "red move"), iTurn);
+                thisPlayer->Move(boardCopy, thisTurn, row, col);
+            }
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            HexStats::Record(HEXTIMER_MOVE, ns);
             
             // pass player's move to board manager
             result = board.SetColor(row, col, thisTurn);
@@ -141,6 +165,36 @@ HexColor HexGame::Play(HexColor movesFirst)
             // if move is not accepted, prompt again
             if (result != HEXMOVE_OK) continue;
             
+            if (!options.record.empty())
+            {
+                HexRecordMoveStats moveStats;
+                HexMoveWork work;
+                
+                if (!thisPlayer->LastMoveWork(work))
+                {
+                    HexStatsSnapshot after;
+                    HexStats::Snapshot(after);
+                    HexStatsSnapshot delta = after - before;
+                    work.rollouts = delta.Count(HEXSTAT_ROLLOUTS);
+                    work.candidates = delta.Count(HEXSTAT_CANDIDATES);
+                    work.cutoffs = delta.Count(HEXSTAT_CUTOFFS);
+                }
+                
+                moveStats.micros = ns / 1000;
+                moveStats.rollouts = work.rollouts;
+                moveStats.candidates = work.candidates;
+                moveStats.cutoffs = work.cutoffs;
+                record.Move(row, col, moveStats);
+            }
+            
+            if (options.stats || options.statsJson)
+            {
+                HexStatsSnapshot after;
+                HexStats::Snapshot(after);
+                HexStatsSnapshot delta = after - before;
+                gameIO.MoveStats(iTurn, thisTurn, row, col, delta, options.statsJson);
+            }
+            
             // check for a winner
             winner = board.Winner();
             
@@ -155,19 +209,75 @@ HexColor HexGame::Play(HexColor movesFirst)
         }
     }
     
+    HexTrace::End("game");
+    
+    if (!options.record.empty() && !record.Finish(winner, options.record.c_str()) && !options.mute)
+        std::cout << "Could not write game record " << options.record << "\n";
+    
+    if (!options.trace.empty())
+    {
+        HexTrace::Stop();
+        if (!HexTrace::Flush(options.trace.c_str()) && !options.mute)
+            std::cout << "Could not write trace file " << options.trace << "\n";
+    }
+    
     return winner;
 }   
 
 /* ----------------------------------------------------------------------------
    bool HexGame::SetOption(const char *optname, bool optval)
    Sets the value of a boolean option, returns true if successful
+   
+   Options:
+    mute:       no output at all (set it before registering players)
+    stats:      after every move, print engine counters and timings to stderr
+    statsjson:  same as stats, as one JSON object per line
    ---------------------------------------------------------------------------- */
 bool HexGame::SetOption(const char *optname, bool optval)
 {
     if (!strcmp(optname, "mute"))
     {
         options.mute = optval;
-        std::cout << "Setting game options: mute=" << (optval ? "T" : "F") << "\n";
+        if (!options.mute) std::cout << "Setting game options: mute=F\n";
+        return true;
+    }
+    
+    if (!strcmp(optname, "stats"))
+    {
+        options.stats = optval;
+        return true;
+    }
+    
+    if (!strcmp(optname, "statsjson"))
+    {
+        options.statsJson = optval;
+        return true;
+    }
+    
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexGame::SetOption(const char *optname, const char *optval)
+   Sets the value of a string option, returns true if successful
+   
+   Options:
+    trace:      write a Chrome trace (chrome://tracing, ui.perfetto.dev) of
+                each game to the named file, replacing it;  "" turns it off
+    record:     append a binary record of each game (hexrecord.h) to the
+                named file;  "" turns it off
+   ---------------------------------------------------------------------------- */
+bool HexGame::SetOption(const char *optname, const char *optval)
+{
+    if (!strcmp(optname, "trace"))
+    {
+        options.trace = optval;
+        return true;
+    }
+    
+    if (!strcmp(optname, "record"))
+    {
+        options.record = optval;
         return true;
     }
     
@@ -192,4 +302,8 @@ void HexGame::Reset(unsigned int n)
     pRedPlayer  = (HexPlayer *)0;
     
     options.mute = false;
+    options.stats = false;
+    options.statsJson = false;
+    options.trace.clear();
+    options.record.clear();
 }
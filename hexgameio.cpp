@@ -1,5 +1,6 @@
 #include <iostream>
 #include "hexboard.h"
+#include "hexstats.h"
    
 /* ---- char chip(HexColor c); ------------------------------------------------
         Returns the ASCII representation for the given cell color
@@ -189,4 +190,53 @@ void HexGameIO::PrintBoard(HexBoard &board)
         std::cout << " ";
         
     std::cout << name(HEXBLUE) << " HOME (" << chip(HEXBLUE) <<")\n\n";
+}
+
+/* ---- void HexGameIO::MoveStats(unsigned int iMove, HexColor turn, int row, int col, HexStatsSnapshot &stats, bool json)
+        Prints the engine counters and timings collected during one move, to
+        stderr so that they do not mix with the game dialog.  Timers that
+        recorded nothing (compiled out, or not used by this player) are left
+        out.  With json, prints one object per line.
+   ---------------------------------------------------------------------------- */
+void HexGameIO::MoveStats(unsigned int iMove, HexColor turn, int row, int col, HexStatsSnapshot &stats, bool json)
+{
+    if (json)
+    {
+        std::cerr << "{\"ply\":" << iMove << ",\"color\":\"" << name(turn) << "\""
+                  << ",\"row\":" << row << ",\"col\":" << col;
+        
+        for (unsigned int c = 0; c < HEXSTAT_NCOUNTERS; c++)
+            std::cerr << ",\"" << HexStats::Name((HexCounter) c) << "\":" << stats.Count((HexCounter) c);
+        
+        for (unsigned int t = 0; t < HEXTIMER_NTIMERS; t++)
+        {
+            HexTimer timer = (HexTimer) t;
+            if (stats.Calls(timer) == 0) continue;
+            
+            std::cerr << ",\"" << HexStats::Name(timer) << "\":{\"calls\":" << stats.Calls(timer)
+                      << ",\"seconds\":" << stats.Seconds(timer)
+                      << ",\"p50\":" << stats.Percentile(timer, 50)
+                      << ",\"p90\":" << stats.Percentile(timer, 90)
+                      << ",\"p99\":" << stats.Percentile(timer, 99) << "}";
+        }
+        
+        std::cerr << "}\n";
+        return;
+    }
+    
+    std::cerr << "move " << iMove << " " << name(turn) << " (" << row << ", " << col << ")";
+    for (unsigned int c = 0; c < HEXSTAT_NCOUNTERS; c++)
+        std::cerr << "  " << HexStats::Name((HexCounter) c) << " " << stats.Count((HexCounter) c);
+    std::cerr << "\n";
+    
+    for (unsigned int t = 0; t < HEXTIMER_NTIMERS; t++)
+    {
+        HexTimer timer = (HexTimer) t;
+        if (stats.Calls(timer) == 0) continue;
+        
+        std::cerr << "    " << HexStats::Name(timer) << ": " << stats.Calls(timer) << " calls, "
+                  << stats.Seconds(timer) << "s total, p50 " << stats.Percentile(timer, 50) * 1e6
+                  << "us, p90 " << stats.Percentile(timer, 90) * 1e6
+                  << "us, p99 " << stats.Percentile(timer, 99) * 1e6 << "us\n";
+    }
 }
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <time.h>
+#include "hexboard.h"
+#include "hexbook.h"
+#include "hexmcplayer.hpp"
+
+/* ============================================================================
+   hexhtp
+
+   Text protocol engine server (HTP, the Hex variant of GTP) on stdin/stdout,
+   so that the engine can be driven by GUIs such as HexGui and by match
+   scripts.
+
+   usage:  hexhtp [-trials n] [-time seconds] [-book file]
+
+   Each command is one line, optionally preceded by a numeric id; replies are
+   "= result" or "? error", echoing the id, followed by a blank line.
+
+   commands:
+    name, version, protocol_version, list_commands, known_command <cmd>, quit
+    boardsize <n>               new empty n x n board
+    clear_board                 empty the board
+    play <color> <cell>         put a stone for color on cell
+    genmove <color> [seconds]   search, play and return a move for color
+    undo                        take back the last move
+    showboard                   print the board
+    analyze <color> [trials]    win rate (percent) of every blank cell for color
+
+   Colors are b/black/blue (connects top to bottom, B in SGF) and
+   w/white/red.  Cells are a column letter and a 1-based row, e.g. c3 is
+   row 2, column 2.
+
+   The board, the move history and the engine (with its pattern tables and
+   position cache) live for the whole session, so a command costs only its
+   own work.  genmove and analyze run on all cores.
+   ============================================================================ */
+
+typedef struct structHtpMove {
+    unsigned int row, col;
+    HexColor color;
+} HtpMove;
+
+/* ----------------------------------------------------------------------------
+   HtpServer class
+
+   Session state and command handlers
+   ---------------------------------------------------------------------------- */
+class HtpServer {
+    public:
+    HtpServer(unsigned int trials, double seconds, HexBook *book);
+    void Run(void);
+
+    private:
+    HexBoard board;
+    HexGameIO gameIO;
+    HexMCPlayer engine;
+    std::vector<HtpMove> history;
+    double defaultSeconds;
+    bool quit;
+
+    bool execute(const std::string &command, std::istringstream &args, std::string &reply);
+    void newBoard(unsigned int n);
+    bool readColor(std::istringstream &args, HexColor &color);
+    bool readCell(std::istringstream &args, unsigned int &row, unsigned int &col);
+    std::string cellName(unsigned int row, unsigned int col);
+};
+
+static const char *commands[] = {
+    "name", "version", "protocol_version", "list_commands", "known_command", "quit",
+    "boardsize", "clear_board", "play", "genmove", "undo", "showboard", "analyze"
+};
+static const unsigned int nCommands = sizeof(commands) / sizeof(commands[0]);
+
+HtpServer::HtpServer(unsigned int trials, double seconds, HexBook *book) : board(11), engine(trials)
+{
+    engine.SetBook(book);
+    engine.SetThreadPool(&HexThreadPool::Shared());
+    defaultSeconds = seconds;
+    quit = false;
+}
+
+/* ----------------------------------------------------------------------------
+   void HtpServer::Run(void);
+
+   Reads and answers commands until quit or the end of the input
+   ---------------------------------------------------------------------------- */
+void HtpServer::Run(void)
+{
+    std::string line;
+
+    while (!quit && getline(std::cin, line))
+    {
+        // drop comments and control characters
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        for (unsigned int i = 0; i < line.size(); i++)
+            if (iscntrl((unsigned char) line[i])) line[i] = ' ';
+
+        std::istringstream args(line);
+        std::string id, command;
+
+        args >> command;
+        if (command.empty())
+            continue;
+
+        if (isdigit((unsigned char) command[0]))
+        {
+            id = command;
+            command.clear();
+            args >> command;
+        }
+
+        std::string reply;
+        bool ok = execute(command, args, reply);
+
+        std::cout << (ok ? "=" : "?") << id;
+        if (!reply.empty())
+            std::cout << ((reply[0] == '\n') ? "" : " ") << reply;
+        std::cout << "\n\n" << std::flush;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   bool HtpServer::execute(const std::string &command, std::istringstream &args, std::string &reply);
+
+   Runs one command.  Returns true if it succeeded;  reply holds the result
+   or the error message.
+   ---------------------------------------------------------------------------- */
+bool HtpServer::execute(const std::string &command, std::istringstream &args, std::string &reply)
+{
+    std::ostringstream out;
+
+    if (command == "name")              { reply = "cpphw5";  return true; }
+    if (command == "version")           { reply = "1.0";     return true; }
+    if (command == "protocol_version")  { reply = "2";       return true; }
+    if (command == "quit")              { quit = true;       return true; }
+
+    if (command == "list_commands")
+    {
+        for (unsigned int i = 0; i < nCommands; i++)
+            reply += std::string((i > 0) ? "\n" : "") + commands[i];
+        return true;
+    }
+
+    if (command == "known_command")
+    {
+        std::string name;
+        args >> name;
+        reply = "false";
+        for (unsigned int i = 0; i < nCommands; i++)
+            if (name == commands[i]) reply = "true";
+        return true;
+    }
+
+    if (command == "boardsize")
+    {
+        unsigned int n;
+        args >> n;
+        if (args.fail() || (n < HEXMINSIZE) || (n > HEXMAXSIZE))
+        {
+            reply = "unacceptable size";
+            return false;
+        }
+        newBoard(n);
+        return true;
+    }
+
+    if (command == "clear_board")
+    {
+        newBoard(board.Size());
+        return true;
+    }
+
+    if (command == "play")
+    {
+        HexColor color;
+        unsigned int row, col;
+
+        if (!readColor(args, color) || !readCell(args, row, col))
+        {
+            reply = "syntax error";
+            return false;
+        }
+
+        if (board.Winner() != HEXBLANK)
+        {
+            reply = "game is over";
+            return false;
+        }
+
+        if (board.SetColor(row, col, color) != HEXMOVE_OK)
+        {
+            reply = "illegal move";
+            return false;
+        }
+
+        HtpMove m = {row, col, color};
+        history.push_back(m);
+        return true;
+    }
+
+    if (command == "genmove")
+    {
+        HexColor color;
+        double seconds = defaultSeconds;
+
+        if (!readColor(args, color))
+        {
+            reply = "syntax error";
+            return false;
+        }
+
+        args >> seconds;
+        if (args.fail()) seconds = defaultSeconds;
+
+        if (board.Winner() != HEXBLANK)
+        {
+            reply = "game is over";
+            return false;
+        }
+
+        unsigned int row, col;
+        HexBoard copy(board);
+        HexPlayer *player = &engine;
+
+        engine.SetTimeLimit(seconds);
+        player->Move(copy, color, row, col);
+
+        board.SetColor(row, col, color);
+        HtpMove m = {row, col, color};
+        history.push_back(m);
+
+        reply = cellName(row, col);
+        return true;
+    }
+
+    if (command == "undo")
+    {
+        if (history.empty())
+        {
+            reply = "cannot undo";
+            return false;
+        }
+
+        // boards have no way to clear a cell, so replay the remaining moves
+        history.pop_back();
+        board = HexBoard(board.Size());
+        for (unsigned int i = 0; i < history.size(); i++)
+            board.SetColor(history[i].row, history[i].col, history[i].color);
+        return true;
+    }
+
+    if (command == "showboard")
+    {
+        // HexGameIO prints to stdout, capture it into the reply
+        std::streambuf *stdoutBuffer = std::cout.rdbuf(out.rdbuf());
+        gameIO.PrintBoard(board);
+        std::cout.rdbuf(stdoutBuffer);
+
+        reply = "\n" + out.str();
+        reply.erase(reply.find_last_not_of("\n") + 1);
+        return true;
+    }
+
+    if (command == "analyze")
+    {
+        HexColor color;
+        unsigned int trials = 1000;
+
+        if (!readColor(args, color))
+        {
+            reply = "syntax error";
+            return false;
+        }
+
+        args >> trials;
+        if (args.fail() || (trials == 0)) trials = 1000;
+
+        HexThreadPool &pool = HexThreadPool::Shared();
+        std::vector<HexBridgePolicy> policies(pool.Slots());
+        unsigned int n = board.Size();
+        std::vector<unsigned int> winRate(n * n, 0);
+        HexCellSet blanks;
+
+        // spread the blank cells over the pool, each slot rolling out with its own policy
+        board.GetCells(blanks, HEXBLANK);
+        pool.ParallelFor(blanks.size(), [&](unsigned int i, unsigned int slot) {
+            unsigned int nRun;
+            int score = EvaluateMove(board, color, blanks[i].row, blanks[i].col, trials, -1, policies[slot], nRun);
+            winRate[blanks[i].row * n + blanks[i].col] = (100 * score) / trials;
+        });
+
+        out << "\n";
+        for (unsigned int row = 0; row < n; row++)
+        {
+            for (unsigned int col = 0; col < n; col++)
+            {
+                if (board.GetColor(row, col) != HEXBLANK)
+                    out << std::setw(4) << gameIO.chip(board.GetColor(row, col));
+                else
+                    out << std::setw(4) << winRate[row * n + col];
+            }
+            if (row + 1 < n) out << "\n";
+        }
+
+        reply = out.str();
+        return true;
+    }
+
+    reply = "unknown command";
+    return false;
+}
+
+// start a new game on an empty n x n board;  the engine keeps its cache
+void HtpServer::newBoard(unsigned int n)
+{
+    board = HexBoard(n);
+    history.clear();
+}
+
+// read a color argument
+bool HtpServer::readColor(std::istringstream &args, HexColor &color)
+{
+    std::string s;
+    args >> s;
+    for (unsigned int i = 0; i < s.size(); i++)
+        s[i] = tolower((unsigned char) s[i]);
+
+    if ((s == "b") || (s == "black") || (s == "blue"))
+        color = HEXBLUE;
+    else if ((s == "w") || (s == "white") || (s == "red"))
+        color = HEXRED;
+    else
+        return false;
+
+    return true;
+}
+
+// read a cell argument (column letter, 1-based row) on the current board
+bool HtpServer::readCell(std::istringstream &args, unsigned int &row, unsigned int &col)
+{
+    std::string s;
+    args >> s;
+    if ((s.size() < 2) || !isalpha((unsigned char) s[0]))
+        return false;
+
+    col = tolower((unsigned char) s[0]) - 'a';
+
+    char *end;
+    long r = strtol(s.c_str() + 1, &end, 10);
+    if ((*end != '\0') || (r < 1))
+        return false;
+    row = r - 1;
+
+    return ((row < board.Size()) && (col < board.Size()));
+}
+
+std::string HtpServer::cellName(unsigned int row, unsigned int col)
+{
+    std::ostringstream ss;
+    ss << (char) ('a' + col) << (row + 1);
+    return ss.str();
+}
+
+static void usage(void)
+{
+    std::cout << "usage: hexhtp [-trials n] [-time seconds] [-book file]\n";
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int trials = 1000;
+    double seconds = 0;
+    const char *bookFile = (const char *)0;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        if (iArg + 1 >= argc)
+            usage();
+
+        const char *opt = argv[iArg++];
+        std::istringstream ss(argv[iArg]);
+
+        if (!strcmp(opt, "-trials"))
+        {
+            ss >> trials;
+            if (ss.fail() || (trials == 0)) usage();
+        }
+        else if (!strcmp(opt, "-time"))
+        {
+            ss >> seconds;
+            if (ss.fail() || (seconds < 0)) usage();
+        }
+        else if (!strcmp(opt, "-book"))
+            bookFile = argv[iArg];
+        else
+            usage();
+    }
+
+    HexBook book;
+    if ((bookFile != (const char *)0) && !book.Open(bookFile))
+    {
+        std::cerr << "could not open book " << bookFile << "\n";
+        return 1;
+    }
+
+    srand(time(0));
+
+    HtpServer server(trials, seconds, &book);
+    server.Run();
+    return 0;
+}
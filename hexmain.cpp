@@ -1,6 +1,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <cstring>
 #include <time.h>
 #include "hexboard.h"
 #include "hexmcplayer.hpp"
@@ -107,8 +108,13 @@ void readParameters(unsigned int &size, unsigned int &p1, unsigned int &p2)
 //    3. Computer (automatic play)
 //
 // Inputs are assumed to be nonconflicting (checked at the time user entered input)
+//
+// Automatic players answer opening positions from the given book, order their
+// candidates by the given policy network, play rollouts by the given pattern
+// weights (if not null), and search on all cores (the shared thread pool).
 // ----------------------------------------------------------------------------
-void registerPlayers(HexGame &game, unsigned int p1, unsigned int p2)
+void registerPlayers(HexGame &game, unsigned int p1, unsigned int p2, HexBook *book, const HexNet *net,
+                     const HexPatternPolicy *patterns)
 {
 
     // First register human (non-automatic play) players, to give each the
@@ -137,6 +143,11 @@ void registerPlayers(HexGame &game, unsigned int p1, unsigned int p2)
     if (p1 == 3)
     {
         HexMCPlayer *p = new HexMCPlayer;
+        p->SetBook(book);
+        p->SetNetwork(net);
+        if (patterns != (const HexPatternPolicy *)0)
+            p->SetPatterns(*patterns);
+        p->SetThreadPool(&HexThreadPool::Shared());
         std::cout << "Registering player 1: requesting first available.\n";
         game.RegisterPlayer(p, HEXBLANK);
     }
@@ -145,6 +156,11 @@ void registerPlayers(HexGame &game, unsigned int p1, unsigned int p2)
     if (p2 == 3)
     {
         HexMCPlayer *p = new HexMCPlayer;
+        p->SetBook(book);
+        p->SetNetwork(net);
+        if (patterns != (const HexPatternPolicy *)0)
+            p->SetPatterns(*patterns);
+        p->SetThreadPool(&HexThreadPool::Shared());
         std::cout << "Registering player 2: requesting first available.\n";
         game.RegisterPlayer(p, HEXBLANK);
     }
@@ -154,14 +170,40 @@ int main(int argc, char *argv[])
 {
     unsigned int size, p1, p2;
     
+    // map the opening book, if there is one (hexbookgen builds it)
+    HexBook book;
+    book.Open("hexbook.bin");
+    
+    // and the policy network, if there is one (used if it fits the board size)
+    HexNet net;
+    net.Load("hexnet.bin");
+    
+    // and rollout pattern weights, if there are any (hexrecords -patterns)
+    HexPatternPolicy patterns;
+    bool hasPatterns = patterns.Load("hexpatterns.bin");
+    
     // obtain user inputs
     readParameters(size, p1, p2);
 
     // create board of selected size
     HexGame game(size);
     
+    // -stats or -statsjson print engine counters and timings after every move,
+    // -trace file writes a timeline of the game, -record file appends the game to a record file
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-stats"))
+            game.SetOption("stats", true);
+        else if (!strcmp(argv[i], "-statsjson"))
+            game.SetOption("statsjson", true);
+        else if (!strcmp(argv[i], "-trace") && (i + 1 < argc))
+            game.SetOption("trace", argv[++i]);
+        else if (!strcmp(argv[i], "-record") && (i + 1 < argc))
+            game.SetOption("record", argv[++i]);
+    }
+    
     // register players
-    registerPlayers(game, p1, p2);
+    registerPlayers(game, p1, p2, &book, &net, (hasPatterns ? &patterns : (const HexPatternPolicy *)0));
     
     // seed random generator and start play
     srand(time(0));
@@ -1,3 +1,6 @@
+#ifndef _HEXMC2PLAYER_HPP_
+#define _HEXMC2PLAYER_HPP_
+
 #include <iostream>
 #include <cstdlib>
 #include <time.h>
@@ -21,7 +24,7 @@ MoveGenerator::MoveGenerator(HexBoard &board)
     // retrieve all unoccupied cells on the board
     board.GetCells(hcs, HEXBLANK);
     // shuffle them to randomize them
-    std::random_shuffle(hcs.begin(), hcs.end());
+    HexShuffle(hcs);
     // set cursor to beginning of sequence
     cursor = 0;
 }
@@ -70,7 +73,7 @@ static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned i
         HexBoard boardCopy(board);
         
         // randomize blank cells to play them in different random order each trial
-        std::random_shuffle(hcs.begin(), hcs.end());
+        HexShuffle(hcs);
         
         for (unsigned int i = 0; i < hcs.size(); i++)
             boardCopy.SetColor(hcs[i].row, hcs[i].col, turns[i % 2]);
@@ -92,6 +95,10 @@ static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned i
    At each move, it picks the cell with larger win count.
    ============================================================================ */
 class HexMC2Player : public HexPlayer {
+    public:
+    virtual const char *Name(void) { return "mc2"; }
+
+    private:
     virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
 };
 
@@ -100,9 +107,22 @@ void HexMC2Player::Move(HexBoard &board, HexColor turn, unsigned int &row, unsig
     unsigned int idPlay, bestPlay, trow, tcol;
     int score, bestScore = -1;
     
+    // on a self-symmetric board, a cell and its rotation are equivalent moves
+    bool symmetric = board.IsSymmetric();
+    unsigned int n = board.Size();
+    
     MoveGenerator mg(board);
     while (mg.Next(idPlay, trow, tcol))
     {
+        if (symmetric)
+        {
+            // evaluate only the first cell (in row-major order) of each pair
+            unsigned int rrow = trow, rcol = tcol;
+            board.Rotate(rrow, rcol);
+            if ((rrow * n + rcol) < (trow * n + tcol))
+                continue;
+        }
+        
         score = EvaluateMove(board, turn, trow, tcol);
         if (score > bestScore)
         {
@@ -112,3 +132,5 @@ void HexMC2Player::Move(HexBoard &board, HexColor turn, unsigned int &row, unsig
     }
     mg.Get(bestPlay, row, col);
 }
+
+#endif
@@ -1,13 +1,30 @@
+#ifndef _HEXMCPLAYER_HPP_
+#define _HEXMCPLAYER_HPP_
+
 #include <iostream>
 #include <cstdlib>
 #include <time.h>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <unordered_map>
+#include <mutex>
 #include "hexboard.h"
+#include "hexpattern.h"
+#include "hexrollout.h"
+#include "hexbook.h"
+#include "hexstats.h"
+#include "hextrace.h"
+#include "hexthreadpool.h"
+#include "hexnet.h"
 
 
-// evaluate a proposed move and return its score
-static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned int col, unsigned int nTrials, int curMax)
+// evaluate a proposed move and return its score, along with the number of trials actually run
+static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned int col, unsigned int nTrials, int curMax, HexRolloutPolicy &policy, unsigned int &nRun)
 {
+    HEXSTATS_TIMER(HEXTIMER_EVALUATE);
+
     // make a local working copy of the board
     HexBoard board(b);
     
@@ -17,26 +34,29 @@ static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned i
     // play the proposed move
     board.SetColor(row, col, turn);
 
-    // order of turns, beginning with opponent (we already placed our first move)
-    HexColor turns[2] = {((turn == HEXBLUE) ? HEXRED : HEXBLUE), turn};
+    // opponent moves first in the playouts (we already placed our first move)
+    HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
 
     // obtain remaining unoccupied cells
     HexMoveGenerator mg(board);
+    
+    policy.Start(board);
             
     int score = nTrials;
-    for (unsigned int iTrial = 0; iTrial < nTrials; iTrial++)
+    for (nRun = 0; nRun < nTrials; )
     {   
-        unsigned int idMove, moveRow, moveCol;    
+        nRun++;
         
-        // reshuffle sequence
-        mg.Shuffle();
-        
-        // play all moves sequentially until board full
-        for (unsigned int i = 0; mg.Next(idMove, moveRow, moveCol); i++)
-            board.SetColor(moveRow, moveCol, turns[i % 2]);
+        // play all remaining cells until board full
+        {
+            HEXSTATS_TIMER(HEXTIMER_PLAYOUT);
+            policy.Playout(board, mg, opponent);
+        }
                         
-        // if we lost, decrease counter
-        if (board.Winner() != turn)
+        // let the policy learn from the outcome, and if we lost, decrease counter
+        HexColor winner = board.Winner();
+        policy.Result(winner);
+        if (winner != turn)
             score--;
             
         // if score is already suboptimal, stop evaluation
@@ -44,6 +64,7 @@ static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned i
             break;
     }
     
+    HEXSTATS_COUNT(HEXSTAT_ROLLOUTS, nRun);
     return score;
 }
 
@@ -54,40 +75,490 @@ static int EvaluateMove(HexBoard &b, HexColor turn, unsigned int row, unsigned i
    determine next move.
    
    At each move, it picks the cell with larger win count.
+   
+   Before simulating, dead and captured cells are filled in and dominated cells
+   are dropped from the candidates, which shortens every rollout and removes
+   candidates that cannot be better than the ones kept.
+   
+   Rollouts are played by a pluggable HexRolloutPolicy, by default one that
+   answers bridge intrusions, or by learned ring pattern weights
+   (SetPatterns).  With the replies option, rollouts also answer each move
+   by the last good reply to it (HexReplyTable):  each thread learns in its
+   own policy clone, and the tables are merged after every parallel pass.
+   
+   On a board that is symmetric under 180 degree rotation, only one cell of
+   each symmetric pair is evaluated.
+   
+   Positions found in the opening book, if one is set, are answered from the
+   book without searching.
+   
+   Candidates are visited best-first according to a cheap prior (a few rollouts
+   each, plus adjacency and centrality bonuses), so that a strong score is
+   found early and later candidates are cut off after as few trials as possible.
+   With a policy network for the board size, the prior is the network's move
+   probabilities instead, and the least likely candidates are not evaluated
+   at all.
+   
+   With a time limit, the search stops after the candidate during which the
+   limit is reached, and plays the best move found so far.  Moves from
+   searches that ran to completion are cached by canonical position, so a
+   position seen again (e.g. after an undo) is answered at once;  changing
+   the network, the rollout policy or an option that shapes the search
+   empties the cache, so no move from a differently configured search is
+   replayed.
+   
+   With a thread pool, candidates (and the ordering pass) are evaluated in
+   parallel, each thread with its own clone of the rollout policy.  Every
+   candidate is cut off against the best score known when it starts, so the
+   search runs somewhat more rollouts than a serial one;  among equal scores
+   the candidate earliest in the visiting order is played, as serially.
    ============================================================================ */
+typedef struct structHexMCStats {
+    unsigned long rollouts;         // trials run, including the ordering pass
+    unsigned long priorRollouts;    // trials run by the ordering pass alone
+    unsigned int  candidates;       // candidates evaluated
+    unsigned int  cutoffs;          // candidates abandoned before running all trials
+    unsigned int  pruned;           // candidates dropped by the policy network
+    int           score;            // trials won by the move played
+    bool          book;             // move was taken from the opening book
+    bool          cached;           // move was taken from the position cache
+    bool          timeout;          // search was cut short by the time limit
+} HexMCStats;
+
+typedef struct structHexMCOptions {
+    bool ordering;
+    bool cache;
+    bool replies;
+} HexMCOptions;
+
+// entries kept in the position cache before it is cleared and refilled
+const unsigned int HEXMC_CACHESIZE = 1 << 20;
+
+// with a policy network, the most likely candidates holding this share of the
+// candidates' probability are evaluated, and at least HEXMC_NETMINIMUM of them
+const double HEXMC_NETMASS = 0.95;
+const unsigned int HEXMC_NETMINIMUM = 8;
+
 class HexMCPlayer : public HexPlayer {
+    public:
+    HexMCPlayer(unsigned int trials=1000);
+    ~HexMCPlayer(void);
+    void SetRolloutPolicy(HexRolloutPolicy *p);
+    void SetThreadPool(HexThreadPool *p);
+    void SetBook(HexBook *b);
+    void SetNetwork(const HexNet *n);
+    void SetPatterns(const HexPatternPolicy &p);
+    bool SetOption(const char *optname, bool optval);
+    void SetTimeLimit(double seconds);
+    void ClearCache(void);
+    HexMCStats GetStats(void);
+    virtual bool LastMoveWork(HexMoveWork &work);
+    virtual const char *Name(void) { return "mc"; }
+    
+    private:
     virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+    void orderCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates);
+    void networkCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates);
+    void forEachCandidate(unsigned int n, HexForBody body, HexCancelToken *cancel=(HexCancelToken *)0);
+    HexRolloutPolicy &slotPolicy(unsigned int slot);
+    void clearClones(void);
+    
+    HexPatternEngine patterns;
+    HexBridgePolicy  bridgePolicy;
+    HexPatternPolicy patternPolicy;
+    HexRolloutPolicy *policy;
+    HexThreadPool    *pool;             // candidates are evaluated serially if null
+    std::vector<HexRolloutPolicy *> clones;     // policy copies for pool slots 1 and up
+    HexBook          *book;
+    const HexNet     *net;              // move priors, if not null
+    unsigned int     nTrials;
+    double           timeLimit;         // seconds per move, 0 if none
+    HexMCOptions     options;
+    HexMCStats       stats;
+    std::unordered_map<uint64_t, HexCell> cache;    // canonical position -> move, canonical orientation
+    
+    // no copies, the policy clones are owned
+    HexMCPlayer(const HexMCPlayer &);
+    HexMCPlayer &operator=(const HexMCPlayer &);
 };
 
+HexMCPlayer::HexMCPlayer(unsigned int trials)
+{
+    policy = &bridgePolicy;
+    pool = (HexThreadPool *)0;
+    book = (HexBook *)0;
+    net = (const HexNet *)0;
+    nTrials = trials;
+    timeLimit = 0;
+    options.ordering = true;
+    options.cache = true;
+    options.replies = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+HexMCPlayer::~HexMCPlayer(void)
+{   clearClones();  }
+
+/* ----------------------------------------------------------------------------
+   bool HexMCPlayer::SetOption(const char *optname, bool optval)
+   Sets the value of a boolean option, returns true if successful
+   
+   Options:
+    ordering:   visit candidates best-first (default on)
+    cache:      remember the moves of completed searches (default on)
+    replies:    rollouts answer moves by their last good replies (default off)
+   ---------------------------------------------------------------------------- */
+bool HexMCPlayer::SetOption(const char *optname, bool optval)
+{
+    if (!strcmp(optname, "ordering"))
+    {
+        if (optval != options.ordering) cache.clear();
+        options.ordering = optval;
+        return true;
+    }
+    
+    if (!strcmp(optname, "cache"))
+    {
+        options.cache = optval;
+        if (!optval) cache.clear();
+        return true;
+    }
+    
+    if (!strcmp(optname, "replies"))
+    {
+        if (optval != options.replies) cache.clear();
+        options.replies = optval;
+        bridgePolicy.SetReplies(optval);
+        patternPolicy.SetReplies(optval);
+        clearClones();
+        return true;
+    }
+    
+    return false;
+}
+
+// answer positions found in the given opening book from the book (caller retains ownership)
+void HexMCPlayer::SetBook(HexBook *b)
+{   book = b;   }
+
+// order and prune candidates by the given policy network, when it fits the board (caller retains ownership)
+void HexMCPlayer::SetNetwork(const HexNet *n)
+{
+    net = n;
+    cache.clear();
+}
+
+// play rollouts by a copy of the given pattern weights instead of the default policy
+void HexMCPlayer::SetPatterns(const HexPatternPolicy &p)
+{
+    patternPolicy = p;
+    patternPolicy.SetReplies(options.replies);
+    SetRolloutPolicy(&patternPolicy);
+}
+
+// limit the search of each move to about the given number of seconds (0: no limit)
+void HexMCPlayer::SetTimeLimit(double seconds)
+{   timeLimit = seconds;    }
+
+// forget the moves of earlier searches
+void HexMCPlayer::ClearCache(void)
+{   cache.clear();  }
+
+// return counters describing the most recent move
+HexMCStats HexMCPlayer::GetStats(void)
+{   return stats;   }
+
+// the work of the most recent move, across every pool slot it ran on
+bool HexMCPlayer::LastMoveWork(HexMoveWork &work)
+{
+    work.rollouts = stats.rollouts;
+    work.candidates = stats.candidates;
+    work.cutoffs = stats.cutoffs;
+    return true;
+}
+
+// use the given rollout policy instead of the default one (caller retains ownership)
+void HexMCPlayer::SetRolloutPolicy(HexRolloutPolicy *p)
+{
+    policy = ((p == (HexRolloutPolicy *)0) ? &bridgePolicy : p);
+    clearClones();
+    cache.clear();
+}
+
+// evaluate candidates in parallel on the given pool, or serially if null (caller retains ownership)
+void HexMCPlayer::SetThreadPool(HexThreadPool *p)
+{   pool = p;   }
+
 void HexMCPlayer::Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col)
 {        
-    unsigned int nTrials = 1000;
-    unsigned int idPlay, bestPlay, trow, tcol;
-    int score, bestScore = -1;
+    unsigned int idPlay, bestPlay = 0;
+    int bestScore = -1;
     
-    // obtain the sequence of available moves, so that we can evaluate them one at a time
-    HexMoveGenerator mg(board);
+    HEXTRACE_SCOPE("mc.move");
+    memset(&stats, 0, sizeof(stats));
+    
+    // opening positions are answered straight from the book
+    if ((book != (HexBook *)0) && book->Lookup(board, turn, row, col))
+    {
+        stats.book = true;
+        HEXSTATS_COUNT(HEXSTAT_BOOKMOVES, 1);
+        return;
+    }
+    
+    // positions searched before are answered from the cache
+    bool rotated = false;
+    uint64_t key = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     
-    // iterate over all possible moves
-    while (mg.Next(idPlay, trow, tcol))
+    if (options.cache)
     {
-        // evaluate this move
-        score = EvaluateMove(board, turn, trow, tcol, nTrials, bestScore);
+        key = board.CanonicalHash(turn, rotated);
+        std::unordered_map<uint64_t, HexCell>::iterator it = cache.find(key);
         
-        // keep track of best score so far
-        if (score > bestScore)
+        if (it != cache.end())
         {
-            bestScore = score;
-            bestPlay = idPlay;
+            row = it->second.row;
+            col = it->second.col;
+            if (rotated) board.Rotate(row, col);
             
-            if (score == nTrials)
+            // a collision could name an occupied cell, search normally then
+            if (board.GetColor(row, col) == HEXBLANK)
             {
-                // sure play, won every trial, just play it.  No need to evaluate further
-                break;
+                stats.cached = true;
+                return;
             }
         }
     }
     
+    // fill in dead and captured cells, so that rollouts only play live cells
+    HexBoard pruned(board);
+    patterns.FillIn(pruned);
+    
+    // obtain the set of candidate moves, so that we can evaluate them one at a time
+    HexCellSet candidates;
+    patterns.Candidates(pruned, turn, candidates);
+    
+    // on a self-symmetric board, a cell and its rotation are equivalent moves
+    pruned.DropSymmetric(candidates);
+    
+    // if fill-in already decided the game, any open cell will do
+    if (candidates.size() == 0)
+    {
+        HexMoveGenerator open(board);
+        open.Next(idPlay, row, col);
+        return;
+    }
+    
+    // visit promising candidates first, or else in random order
+    if (options.ordering && (net != (const HexNet *)0) && (net->Size() == pruned.Size()))
+        networkCandidates(pruned, turn, candidates);
+    else if (options.ordering)
+        orderCandidates(pruned, turn, candidates);
+    else
+        HexShuffle(candidates);
+    
+    // evaluate candidates, cutting each off against the best score so far
+    std::mutex bestLock;
+    std::atomic<int> cutoff(-1);        // bestScore, for candidates about to start
+    HexCancelToken done;                // a sure play was found, or time ran out
+    bool outOfTime = false;
+    
+    forEachCandidate(candidates.size(), [&](unsigned int i, unsigned int slot) {
+        // evaluate this move (traced with the index of its cell)
+        HEXTRACE_SCOPE("mc.candidate", candidates[i].row * board.Size() + candidates[i].col);
+        unsigned int nRun;
+        int score = EvaluateMove(pruned, turn, candidates[i].row, candidates[i].col, nTrials, cutoff.load(), slotPolicy(slot), nRun);
+        
+        std::lock_guard<std::mutex> guard(bestLock);
+        
+        stats.rollouts += nRun;
+        stats.candidates++;
+        HEXSTATS_COUNT(HEXSTAT_CANDIDATES, 1);
+        if (nRun < nTrials)
+        {
+            stats.cutoffs++;
+            HEXSTATS_COUNT(HEXSTAT_CUTOFFS, 1);
+        }
+        
+        // keep track of best score so far, preferring earlier candidates on ties
+        if ((score > bestScore) || ((score == bestScore) && (i < bestPlay)))
+        {
+            bestScore = score;
+            bestPlay = i;
+            cutoff.store(score);
+            
+            // sure play, won every trial, just play it.  No need to evaluate further
+            if (score == nTrials)
+                done.Cancel();
+        }
+        
+        // out of time, settle for the best so far
+        if ((timeLimit > 0) &&
+            (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= timeLimit))
+        {
+            outOfTime = true;
+            done.Cancel();
+        }
+    }, &done);
+    
+    stats.timeout = (outOfTime && (stats.candidates < candidates.size()));
+    
     // retrieve best play
-    mg.Get(bestPlay, row, col);
+    stats.score = bestScore;
+    row = candidates[bestPlay].row;
+    col = candidates[bestPlay].col;
+    
+    // remember complete searches, in the canonical orientation
+    if (options.cache && !stats.timeout)
+    {
+        if (cache.size() >= HEXMC_CACHESIZE)
+            cache.clear();
+        
+        HexCell move = {row, col, HEXBLANK};
+        if (rotated) board.Rotate(move.row, move.col);
+        cache[key] = move;
+    }
 }
+
+/* ----------------------------------------------------------------------------
+   void HexMCPlayer::orderCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates);
+   
+   Sorts candidates best-first by a cheap prior:  the win rate over a handful
+   of rollouts, with small bonuses for touching our own stones and for being
+   close to the center of the board to break ties.
+   ---------------------------------------------------------------------------- */
+static bool priorGreater(const std::pair<double, HexCell> &a, const std::pair<double, HexCell> &b)
+{   return a.first > b.first;   }
+
+void HexMCPlayer::orderCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates)
+{
+    HEXTRACE_SCOPE("mc.order");
+    
+    const unsigned int nPriorTrials = 16;
+    const int dr[6] = {-1, -1, 0, 1,  1,  0};
+    const int dc[6] = { 0,  1, 1, 0, -1, -1};
+    
+    int n = board.Size();
+    double center = (n - 1) / 2.0;
+    std::vector<std::pair<double, HexCell> > ranked(candidates.size());
+    std::atomic<unsigned long> nPrior(0);
+    
+    forEachCandidate(candidates.size(), [&](unsigned int i, unsigned int slot) {
+        int r = candidates[i].row;
+        int c = candidates[i].col;
+        unsigned int nRun;
+        
+        // a short rollout sample, never cut off
+        int score = EvaluateMove(board, turn, r, c, nPriorTrials, -1, slotPolicy(slot), nRun);
+        nPrior += nRun;
+        
+        double prior = ((double) score) / nPriorTrials;
+        
+        // own stones adjacent to the cell
+        for (unsigned int k = 0; k < 6; k++)
+        {
+            int nr = r + dr[k], nc = c + dc[k];
+            if ((nr >= 0) && (nr < n) && (nc >= 0) && (nc < n) && (board.GetColor(nr, nc) == turn))
+                prior += 0.01;
+        }
+        
+        // hex distance to the center
+        double dRow = r - center, dCol = c - center;
+        prior -= 0.001 * (fabs(dRow) + fabs(dCol) + fabs(dRow + dCol)) / 2;
+        
+        ranked[i] = std::make_pair(prior, candidates[i]);
+    });
+    
+    stats.rollouts += nPrior;
+    stats.priorRollouts += nPrior;
+    
+    std::stable_sort(ranked.begin(), ranked.end(), priorGreater);
+    
+    for (unsigned int i = 0; i < ranked.size(); i++)
+        candidates[i] = ranked[i].second;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexMCPlayer::networkCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates);
+
+   Sorts candidates by the policy network's move probabilities, most likely
+   first, and keeps only as many as HEXMC_NETMASS and HEXMC_NETMINIMUM ask
+   for.  Costs one network evaluation instead of the ordering rollouts.
+   ---------------------------------------------------------------------------- */
+void HexMCPlayer::networkCandidates(HexBoard &board, HexColor turn, HexCellSet &candidates)
+{
+    HEXTRACE_SCOPE("mc.network");
+
+    HexCellColors cells;
+    std::vector<float> prob;
+    GetCellColors(board, cells);
+    net->Policy(cells, turn, prob);
+
+    unsigned int n = board.Size();
+    double total = 0;
+    std::vector<std::pair<double, HexCell> > ranked(candidates.size());
+
+    for (unsigned int i = 0; i < candidates.size(); i++)
+    {
+        ranked[i] = std::make_pair((double) prob[candidates[i].row * n + candidates[i].col], candidates[i]);
+        total += ranked[i].first;
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), priorGreater);
+
+    unsigned int nKept = 0;
+    double kept = 0;
+    while ((nKept < ranked.size()) && ((nKept < HEXMC_NETMINIMUM) || (kept < HEXMC_NETMASS * total)))
+        kept += ranked[nKept++].first;
+
+    stats.pruned = ranked.size() - nKept;
+    candidates.resize(nKept);
+    for (unsigned int i = 0; i < nKept; i++)
+        candidates[i] = ranked[i].second;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexMCPlayer::forEachCandidate(unsigned int n, HexForBody body, HexCancelToken *cancel=0);
+   
+   Calls body(i, slot) for i in [0, n):  on the thread pool if there is one,
+   else in order on the calling thread (slot 0), stopping once cancel is
+   cancelled.  After a parallel pass the slots' reply tables, if the policy
+   keeps them, are merged.
+   ---------------------------------------------------------------------------- */
+void HexMCPlayer::forEachCandidate(unsigned int n, HexForBody body, HexCancelToken *cancel)
+{
+    if (pool != (HexThreadPool *)0)
+    {
+        // clone the policy for every slot that may run at once
+        while (clones.size() + 1 < pool->Slots())
+            clones.push_back(policy->Clone());
+        
+        pool->ParallelFor(n, body, cancel);
+        
+        // pool the replies the slots learned, so each starts the next pass from all of them
+        if (policy->Replies() != (HexReplyTable *)0)
+        {
+            std::vector<HexReplyTable *> tables(1, policy->Replies());
+            for (unsigned int i = 0; i < clones.size(); i++)
+                tables.push_back(clones[i]->Replies());
+            HexReplyTable::Merge(tables);
+        }
+        return;
+    }
+    
+    for (unsigned int i = 0; (i < n) && ((cancel == (HexCancelToken *)0) || !cancel->Cancelled()); i++)
+        body(i, 0);
+}
+
+// the rollout policy for a pool slot:  the policy itself for slot 0, a clone for the others
+HexRolloutPolicy &HexMCPlayer::slotPolicy(unsigned int slot)
+{   return ((slot == 0) ? *policy : *clones[slot - 1]); }
+
+void HexMCPlayer::clearClones(void)
+{
+    for (unsigned int i = 0; i < clones.size(); i++)
+        delete clones[i];
+    clones.clear();
+}
+
+#endif
@@ -0,0 +1,479 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "hexnet.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEXNET_AVX2
+#include <immintrin.h>
+#endif
+
+/* ============================================================================
+   HexNet class
+
+   A layer computes out = bias + W in for a batch of inputs, both batch-major
+   (input b at in + b * nIn).  With int8 weights, each row of W is stored as
+   bytes and a scale, and the scale is applied to the finished dot product.
+   ============================================================================ */
+
+static const char netMagic[8] = {'H', 'E', 'X', 'N', 'E', 'T', '0', '1'};
+const char HexNetTensorMagic[8] = {'H', 'E', 'X', 'T', 'N', 'S', '0', '1'};
+
+// largest layer accepted from a file, in outputs
+static const unsigned int HEXNET_MAXWIDTH = 1 << 16;
+static const unsigned int HEXNET_MAXLAYERS = 16;
+
+// dot products of one row of weights against up to this many inputs at once
+static const unsigned int HEXNET_BLOCK = 4;
+
+// portable kernel:  the reference the vectorized one must agree with, up to rounding
+template <class W>
+static void denseScalar(const W *w, const float *scale, const float *bias, const float *in,
+                        unsigned int nIn, unsigned int nOut, unsigned int batch, float *out)
+{
+    for (unsigned int o = 0; o < nOut; o++)
+    {
+        const W *row = w + (size_t) o * nIn;
+
+        for (unsigned int b = 0; b < batch; b++)
+        {
+            const float *x = in + (size_t) b * nIn;
+            float sum = 0;
+
+            for (unsigned int i = 0; i < nIn; i++)
+                sum += row[i] * x[i];
+
+            out[(size_t) b * nOut + o] = bias[o] + ((scale != (const float *)0) ? scale[o] * sum : sum);
+        }
+    }
+}
+
+#ifdef HEXNET_AVX2
+
+// true if the CPU runs the AVX2 kernel (AVX2 and FMA)
+static bool cpuHasAVX2(void)
+{
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+}
+
+__attribute__((target("avx2,fma")))
+static inline float horizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// 8 weights as floats
+__attribute__((target("avx2,fma")))
+static inline __m256 loadWeights(const float *w)
+{   return _mm256_loadu_ps(w);  }
+
+__attribute__((target("avx2,fma")))
+static inline __m256 loadWeights(const int8_t *w)
+{   return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) w)));    }
+
+// AVX2 kernel:  each 8 weights loaded are multiplied into HEXNET_BLOCK inputs
+template <class W>
+__attribute__((target("avx2,fma")))
+static void denseAVX2(const W *w, const float *scale, const float *bias, const float *in,
+                      unsigned int nIn, unsigned int nOut, unsigned int batch, float *out)
+{
+    unsigned int nVector = nIn & ~7u;
+
+    for (unsigned int o = 0; o < nOut; o++)
+    {
+        const W *row = w + (size_t) o * nIn;
+
+        for (unsigned int b = 0; b < batch; b += HEXNET_BLOCK)
+        {
+            unsigned int nBlock = std::min(HEXNET_BLOCK, batch - b);
+
+            // a short block repeats its last input, and ignores the extra sums
+            const float *x[HEXNET_BLOCK];
+            for (unsigned int k = 0; k < HEXNET_BLOCK; k++)
+                x[k] = in + (size_t) (b + std::min(k, nBlock - 1)) * nIn;
+
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+
+            for (unsigned int i = 0; i < nVector; i += 8)
+            {
+                __m256 wv = loadWeights(row + i);
+                acc0 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x[0] + i), acc0);
+                acc1 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x[1] + i), acc1);
+                acc2 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x[2] + i), acc2);
+                acc3 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x[3] + i), acc3);
+            }
+
+            float sums[HEXNET_BLOCK] = {horizontalSum(acc0), horizontalSum(acc1), horizontalSum(acc2), horizontalSum(acc3)};
+
+            for (unsigned int k = 0; k < nBlock; k++)
+            {
+                float sum = sums[k];
+                for (unsigned int i = nVector; i < nIn; i++)
+                    sum += row[i] * x[k][i];
+
+                out[(size_t) (b + k) * nOut + o] = bias[o] + ((scale != (const float *)0) ? scale[o] * sum : sum);
+            }
+        }
+    }
+}
+
+#else
+
+static bool cpuHasAVX2(void)
+{   return false;   }
+
+#endif
+
+/* ----------------------------------------------------------------------------
+   HexNet::HexNet(void);
+
+   constructor - no network until Load() or Reset();  the AVX2 kernels are
+   used if the CPU supports them
+   ---------------------------------------------------------------------------- */
+HexNet::HexNet(void)
+{
+    size = 0;
+    type = HEXNET_FP32;
+    simd = cpuHasAVX2();
+}
+
+// board size the network was built for, 0 if none is loaded
+unsigned int HexNet::Size(void) const
+{   return size;    }
+
+// use the AVX2 kernels if the CPU supports them (default), or the portable ones
+void HexNet::SetSIMD(bool on)
+{   simd = (on && cpuHasAVX2());   }
+
+bool HexNet::SIMD(void) const
+{   return simd;    }
+
+/* ----------------------------------------------------------------------------
+   bool HexNet::Load(const char *filename);
+
+   Reads a network file.  Returns false (and keeps the current network) if
+   the file does not exist or is not a valid network.
+   ---------------------------------------------------------------------------- */
+bool HexNet::Load(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == (FILE *)0)
+        return false;
+
+    HexNetFileHeader header;
+    bool ok = ((fread(&header, sizeof(header), 1, f) == 1) &&
+               !memcmp(header.magic, netMagic, sizeof(netMagic)) &&
+               (header.size >= (unsigned int) HEXMINSIZE) && (header.size <= (unsigned int) HEXMAXSIZE) &&
+               (header.nLayers >= 1) && (header.nLayers <= HEXNET_MAXLAYERS) &&
+               ((header.weights == HEXNET_FP32) || (header.weights == HEXNET_INT8)));
+
+    std::vector<HexNetLayer> loaded(ok ? header.nLayers : 0);
+    unsigned int n2 = header.size * header.size;
+    unsigned int nIn = HEXNET_PLANES * n2;
+
+    for (unsigned int l = 0; ok && (l < loaded.size()); l++)
+    {
+        HexNetLayer &layer = loaded[l];
+        HexNetLayerHeader lh;
+
+        ok = ((fread(&lh, sizeof(lh), 1, f) == 1) && (lh.nIn == nIn) &&
+              (lh.nOut >= 1) && (lh.nOut <= HEXNET_MAXWIDTH) &&
+              ((l + 1 < loaded.size()) || (lh.nOut == n2 + 1)));
+        if (!ok)
+            break;
+
+        layer.nIn = lh.nIn;
+        layer.nOut = lh.nOut;
+        nIn = lh.nOut;
+
+        size_t nWeights = (size_t) layer.nIn * layer.nOut;
+        layer.bias.resize(layer.nOut);
+        ok = (fread(&layer.bias[0], sizeof(float), layer.nOut, f) == layer.nOut);
+
+        if (ok && (header.weights == HEXNET_FP32))
+        {
+            layer.weights.resize(nWeights);
+            ok = (fread(&layer.weights[0], sizeof(float), nWeights, f) == nWeights);
+        }
+        else if (ok)
+        {
+            layer.scale.resize(layer.nOut);
+            layer.qweights.resize(nWeights);
+            char pad[4];
+            size_t nPad = (4 - nWeights % 4) % 4;
+
+            ok = ((fread(&layer.scale[0], sizeof(float), layer.nOut, f) == layer.nOut) &&
+                  (fread(&layer.qweights[0], 1, nWeights, f) == nWeights) &&
+                  (fread(pad, 1, nPad, f) == nPad));
+        }
+    }
+
+    fclose(f);
+    if (!ok)
+        return false;
+
+    size = header.size;
+    type = (HexNetWeights) header.weights;
+    layers.swap(loaded);
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexNet::Save(const char *filename);
+
+   Writes the network out as a network file.  Throws HEXNET_ERR_INVALIDSIZE
+   if there is no network, HEXNET_ERR_WRITE if the file cannot be written.
+   ---------------------------------------------------------------------------- */
+void HexNet::Save(const char *filename)
+{
+    if (size == 0)
+        throw HEXNET_ERR_INVALIDSIZE;
+
+    HexNetFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, netMagic, sizeof(netMagic));
+    header.size = size;
+    header.nLayers = layers.size();
+    header.weights = type;
+
+    FILE *f = fopen(filename, "wb");
+    if (f == (FILE *)0)
+        throw HEXNET_ERR_WRITE;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+
+    for (unsigned int l = 0; ok && (l < layers.size()); l++)
+    {
+        const HexNetLayer &layer = layers[l];
+        HexNetLayerHeader lh = {layer.nIn, layer.nOut};
+        size_t nWeights = (size_t) layer.nIn * layer.nOut;
+
+        ok = ((fwrite(&lh, sizeof(lh), 1, f) == 1) &&
+              (fwrite(&layer.bias[0], sizeof(float), layer.nOut, f) == layer.nOut));
+
+        if (ok && (type == HEXNET_FP32))
+            ok = (fwrite(&layer.weights[0], sizeof(float), nWeights, f) == nWeights);
+        else if (ok)
+        {
+            const char pad[4] = {0, 0, 0, 0};
+            size_t nPad = (4 - nWeights % 4) % 4;
+
+            ok = ((fwrite(&layer.scale[0], sizeof(float), layer.nOut, f) == layer.nOut) &&
+                  (fwrite(&layer.qweights[0], 1, nWeights, f) == nWeights) &&
+                  (fwrite(pad, 1, nPad, f) == nPad));
+        }
+    }
+
+    if ((fclose(f) != 0) || !ok)
+        throw HEXNET_ERR_WRITE;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexNet::Reset(unsigned int n, const std::vector<unsigned int> &hidden, HexNetWeights w, uint64_t seed=1);
+
+   Replaces the network by an untrained one for n x n boards, with hidden
+   layers of the given widths:  weights uniform in +-sqrt(6 / inputs) (He
+   initialization, for ReLU), drawn from seed, and zero biases.  For
+   benchmarks, and as a starting point for training.  Throws
+   HEXNET_ERR_INVALIDSIZE if n or a width is out of range.
+   ---------------------------------------------------------------------------- */
+void HexNet::Reset(unsigned int n, const std::vector<unsigned int> &hidden, HexNetWeights w, uint64_t seed)
+{
+    if ((n < (unsigned int) HEXMINSIZE) || (n > (unsigned int) HEXMAXSIZE) || (hidden.size() + 1 > HEXNET_MAXLAYERS))
+        throw HEXNET_ERR_INVALIDSIZE;
+
+    std::vector<HexNetLayer> created(hidden.size() + 1);
+    unsigned int nIn = HEXNET_PLANES * n * n;
+    uint64_t x = seed;
+
+    for (unsigned int l = 0; l < created.size(); l++)
+    {
+        HexNetLayer &layer = created[l];
+        layer.nIn = nIn;
+        layer.nOut = ((l < hidden.size()) ? hidden[l] : n * n + 1);
+        nIn = layer.nOut;
+
+        if ((layer.nOut == 0) || (layer.nOut > HEXNET_MAXWIDTH))
+            throw HEXNET_ERR_INVALIDSIZE;
+
+        layer.bias.assign(layer.nOut, 0);
+        layer.weights.resize((size_t) layer.nIn * layer.nOut);
+
+        float limit = sqrt(6.0 / layer.nIn);
+        for (size_t i = 0; i < layer.weights.size(); i++)
+        {
+            // splitmix64, to a uniform in [-limit, limit)
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= (z >> 31);
+            layer.weights[i] = limit * (2.0f * (float) (z >> 40) / (float) (1 << 24) - 1.0f);
+        }
+
+        if (w == HEXNET_INT8)
+        {
+            // per row, the largest weight maps to 127
+            layer.scale.resize(layer.nOut);
+            layer.qweights.resize(layer.weights.size());
+
+            for (unsigned int o = 0; o < layer.nOut; o++)
+            {
+                const float *row = &layer.weights[(size_t) o * layer.nIn];
+                float largest = 0;
+                for (unsigned int i = 0; i < layer.nIn; i++)
+                    largest = std::max(largest, (float) fabs(row[i]));
+
+                layer.scale[o] = ((largest > 0) ? largest / 127 : 1);
+                for (unsigned int i = 0; i < layer.nIn; i++)
+                    layer.qweights[(size_t) o * layer.nIn + i] = (int8_t) lrintf(row[i] / layer.scale[o]);
+            }
+
+            layer.weights.clear();
+        }
+    }
+
+    size = n;
+    type = w;
+    layers.swap(created);
+}
+
+/* ----------------------------------------------------------------------------
+   void HexNet::Evaluate(const float *planes, unsigned int batch, float *logits, float *values) const;
+
+   Runs batch positions through the network:  planes holds the input planes
+   of each position (see Encode), one after the other;  logits receives
+   size * size move logits per position, in the network's orientation, and
+   values one value per position.  Throws HEXNET_ERR_INVALIDSIZE if there
+   is no network.
+   ---------------------------------------------------------------------------- */
+void HexNet::Evaluate(const float *planes, unsigned int batch, float *logits, float *values) const
+{
+    if (size == 0)
+        throw HEXNET_ERR_INVALIDSIZE;
+
+    // activations, reused by every call on the same thread
+    static thread_local std::vector<float> buffers[2];
+
+    const float *in = planes;
+    for (unsigned int l = 0; l < layers.size(); l++)
+    {
+        std::vector<float> &out = buffers[l % 2];
+        out.resize((size_t) batch * layers[l].nOut);
+
+        dense(layers[l], in, batch, &out[0], (l + 1 < layers.size()));
+        in = &out[0];
+    }
+
+    unsigned int n2 = size * size;
+    for (unsigned int b = 0; b < batch; b++)
+    {
+        const float *out = in + (size_t) b * (n2 + 1);
+        memcpy(logits + (size_t) b * n2, out, n2 * sizeof(float));
+        values[b] = tanh(out[n2]);
+    }
+}
+
+// one layer for a batch, on the kernels in use, followed by a ReLU if relu
+void HexNet::dense(const HexNetLayer &layer, const float *in, unsigned int batch, float *out, bool relu) const
+{
+    const float *scale = ((type == HEXNET_INT8) ? &layer.scale[0] : (const float *)0);
+
+#ifdef HEXNET_AVX2
+    if (simd && (type == HEXNET_INT8))
+        denseAVX2(&layer.qweights[0], scale, &layer.bias[0], in, layer.nIn, layer.nOut, batch, out);
+    else if (simd)
+        denseAVX2(&layer.weights[0], scale, &layer.bias[0], in, layer.nIn, layer.nOut, batch, out);
+    else
+#endif
+    if (type == HEXNET_INT8)
+        denseScalar(&layer.qweights[0], scale, &layer.bias[0], in, layer.nIn, layer.nOut, batch, out);
+    else
+        denseScalar(&layer.weights[0], scale, &layer.bias[0], in, layer.nIn, layer.nOut, batch, out);
+
+    if (relu)
+        for (size_t i = 0; i < (size_t) batch * layer.nOut; i++)
+            out[i] = std::max(out[i], 0.0f);
+}
+
+/* ----------------------------------------------------------------------------
+   float HexNet::Policy(const HexCellColors &cells, HexColor turn, std::vector<float> &prob) const;
+
+   Evaluates a single position of the network's size with turn to move:
+   fills prob with the probability of each cell (row-major, in the board's
+   orientation;  0 for occupied cells), a softmax over the blank cells, and
+   returns the value for turn.
+   ---------------------------------------------------------------------------- */
+float HexNet::Policy(const HexCellColors &cells, HexColor turn, std::vector<float> &prob) const
+{
+    unsigned int n2 = size * size;
+    if ((size == 0) || (cells.size() != n2))
+        throw HEXNET_ERR_INVALIDSIZE;
+
+    static thread_local std::vector<float> planes, logits;
+    planes.resize(HEXNET_PLANES * n2);
+    logits.resize(n2);
+
+    float value;
+    Encode(cells, size, turn, &planes[0]);
+    Evaluate(&planes[0], 1, &logits[0], &value);
+
+    float largest = -HUGE_VALF;
+    for (unsigned int i = 0; i < n2; i++)
+        if (cells[i] == HEXBLANK)
+            largest = std::max(largest, logits[Orient(i, size, turn)]);
+
+    float total = 0;
+    prob.assign(n2, 0);
+    for (unsigned int i = 0; i < n2; i++)
+    {
+        if (cells[i] == HEXBLANK)
+        {
+            prob[i] = exp(logits[Orient(i, size, turn)] - largest);
+            total += prob[i];
+        }
+    }
+
+    if (total > 0)
+        for (unsigned int i = 0; i < n2; i++)
+            prob[i] /= total;
+
+    return value;
+}
+
+/* ----------------------------------------------------------------------------
+   static void HexNet::Encode(const HexCellColors &cells, unsigned int n, HexColor turn, float *planes);
+
+   Fills the HEXNET_PLANES * n * n input planes of the n x n position cells,
+   with turn to move.
+   ---------------------------------------------------------------------------- */
+void HexNet::Encode(const HexCellColors &cells, unsigned int n, HexColor turn, float *planes)
+{
+    unsigned int n2 = n * n;
+    HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+
+    for (unsigned int j = 0; j < n2; j++)
+    {
+        HexColor color = cells[Orient(j, n, turn)];
+        unsigned int row = j / n;
+
+        planes[j] = (color == turn);
+        planes[n2 + j] = (color == opponent);
+        planes[2 * n2 + j] = (color == HEXBLANK);
+        planes[3 * n2 + j] = 1.0f / (1 + std::min(row, n - 1 - row));
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static unsigned int HexNet::Orient(unsigned int iCell, unsigned int n, HexColor turn);
+
+   Maps a cell between the board's orientation and the network's, for turn
+   to move (the mapping is its own inverse).
+   ---------------------------------------------------------------------------- */
+unsigned int HexNet::Orient(unsigned int iCell, unsigned int n, HexColor turn)
+{   return ((turn == HEXRED) ? (iCell % n) * n + iCell / n : iCell);   }
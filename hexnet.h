@@ -0,0 +1,120 @@
+#ifndef _HEXNET_H_
+#define _HEXNET_H_
+
+#include <stdint.h>
+#include <vector>
+#include "hexboard.h"
+#include "hexeval.h"
+
+typedef enum enumHexNetError {
+    HEXNET_ERR_WRITE = 0x500,
+    HEXNET_ERR_INVALIDSIZE
+} HexNetError;
+
+typedef enum enumHexNetWeights {
+    HEXNET_FP32,
+    HEXNET_INT8
+} HexNetWeights;
+
+/* ----------------------------------------------------------------------------
+   The network sees a position from the side to move, which always connects
+   top to bottom:  for red, rows and columns are swapped (a symmetry of the
+   board that swaps the roles of the colors).  Its input is HEXNET_PLANES
+   planes of size * size floats, in that orientation:
+
+        0   stones of the side to move          1 or 0
+        1   stones of the opponent              1 or 0
+        2   blank cells                         1 or 0
+        3   closeness to the mover's edges      1 / (1 + rows to the nearer edge)
+
+   Network files (HexNet::Load, HexNet::Save) are
+
+        HexNetFileHeader
+        per layer:  HexNetLayerHeader
+                    float bias[nOut]
+                    float scale[nOut]               HEXNET_INT8 only
+                    weights[nOut][nIn]              float, or int8_t scaled by
+                                                    scale[row], padded with
+                                                    zeros to a multiple of 4 bytes
+
+   The first layer takes the planes, every layer but the last is followed by
+   a ReLU, and the last one has size * size + 1 outputs:  the move logits, in
+   the network's orientation, then the value (through tanh, the expected
+   result for the side to move, -1 to 1).
+
+   Training tensor files (hexrecords -tensors) are a HexNetTensorHeader, then
+   per position the input planes, the cell played (in the network's
+   orientation, as a uint32_t) and the final result for the side to move
+   (float, 1 won, -1 lost, 0 unfinished).
+
+   All values are in the byte order of the machine that wrote them.
+   ---------------------------------------------------------------------------- */
+const unsigned int HEXNET_PLANES = 4;
+
+typedef struct structHexNetFileHeader {
+    char     magic[8];          // "HEXNET01"
+    uint32_t size;              // board size
+    uint32_t nLayers;
+    uint32_t weights;           // HexNetWeights
+    uint32_t reserved;
+} HexNetFileHeader;
+
+typedef struct structHexNetLayerHeader {
+    uint32_t nIn;
+    uint32_t nOut;
+} HexNetLayerHeader;
+
+typedef struct structHexNetTensorHeader {
+    char     magic[8];          // "HEXTNS01"
+    uint32_t size;              // board size
+    uint32_t planes;            // HEXNET_PLANES
+    uint64_t count;             // positions
+} HexNetTensorHeader;
+
+extern const char HexNetTensorMagic[8];
+
+/* ============================================================================
+   HexNet class
+
+   Inference for a small fully connected policy/value network on the CPU.
+   Evaluate() runs a batch of positions through the layers one at a time,
+   so each row of weights is loaded once for several positions;  with AVX2
+   and FMA (detected at run time) the dot products are vectorized 8 floats
+   wide, and int8 weights are widened in registers, otherwise plain loops
+   compute the same results.
+
+   Evaluation does not change the network, so threads may share one.
+   ============================================================================ */
+class HexNet {
+    public:
+    HexNet(void);
+    bool Load(const char *filename);
+    void Save(const char *filename);
+    void Reset(unsigned int n, const std::vector<unsigned int> &hidden, HexNetWeights w, uint64_t seed=1);
+    unsigned int Size(void) const;
+    void SetSIMD(bool on);
+    bool SIMD(void) const;
+    void Evaluate(const float *planes, unsigned int batch, float *logits, float *values) const;
+    float Policy(const HexCellColors &cells, HexColor turn, std::vector<float> &prob) const;
+
+    static void Encode(const HexCellColors &cells, unsigned int n, HexColor turn, float *planes);
+    static unsigned int Orient(unsigned int iCell, unsigned int n, HexColor turn);
+
+    private:
+    typedef struct structHexNetLayer {
+        unsigned int nIn, nOut;
+        std::vector<float> bias;
+        std::vector<float> scale;           // per row, int8 weights only
+        std::vector<float> weights;         // fp32 weights, row-major
+        std::vector<int8_t> qweights;       // int8 weights, row-major
+    } HexNetLayer;
+
+    unsigned int size;                      // 0 if no network is loaded
+    HexNetWeights type;
+    bool simd;                              // AVX2 kernels in use
+    std::vector<HexNetLayer> layers;
+
+    void dense(const HexNetLayer &layer, const float *in, unsigned int batch, float *out, bool relu) const;
+};
+
+#endif
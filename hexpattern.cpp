@@ -0,0 +1,342 @@
+#include "hexpattern.h"
+
+/* ============================================================================
+   HexPatternEngine class
+
+   Every cell is summarized by the contents of its 6 neighbors, walked in ring
+   order (each neighbor is adjacent to the next one):
+
+        slot 0: (r-1, c)     slot 1: (r-1, c+1)    slot 2: (r, c+1)
+        slot 3: (r+1, c)     slot 4: (r+1, c-1)    slot 5: (r, c-1)
+
+   Each slot takes 2 bits (0 blank, 1 blue, 2 red), giving a 12 bit ring code.
+   Neighbors beyond the top/bottom rows count as blue stones, neighbors beyond
+   the left/right columns count as red stones, since that is how the edges
+   behave for connectivity purposes.
+
+   A cell is useless to a color X when any X chain running through it could be
+   rerouted around it:  every pair of ring slots that X might use is either
+   adjacent or joined by an arc of X stones.  A cell useless to both colors is
+   dead, and may be filled with either color without changing the outcome.
+   Because the answer only depends on the ring, it is precomputed once for all
+   4096 codes.
+
+   Patterns reaching to distance 2 are found by combining two ring lookups:
+   a pair of adjacent blank cells is captured by X if an X stone on either
+   cell kills the other, since X can always answer an intrusion on one of them
+   by playing the other.
+   ============================================================================ */
+
+static const int slotRow[6] = {-1, -1, 0, 1,  1,  0};
+static const int slotCol[6] = { 0,  1, 1, 0, -1, -1};
+
+// 2 bit encoding of a color within a ring code
+static inline unsigned int slotBits(HexColor color)
+{
+    if (color == HEXBLUE) return 1;
+    if (color == HEXRED) return 2;
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+   HexPatternEngine::HexPatternEngine(void);
+
+   constructor - precomputes the usefulness of every ring code for each color
+   ---------------------------------------------------------------------------- */
+HexPatternEngine::HexPatternEngine(void)
+{
+    for (unsigned int code = 0; code < HEXRING_CODES; code++)
+    {
+        unsigned int s[6];
+        for (unsigned int i = 0; i < 6; i++)
+            s[i] = (code >> (2 * i)) & 0x03;
+
+        uselessTable[code] = 0;
+
+        for (unsigned int x = 1; x <= 2; x++)
+        {
+            unsigned int opp = 3 - x;
+            bool useless = true;
+
+            // every pair of slots X could enter and leave through must have a detour
+            for (unsigned int a = 0; (a < 6) && useless; a++)
+            {
+                if ((s[a] == opp) || (s[a] == 3)) continue;
+
+                for (unsigned int b = a + 1; (b < 6) && useless; b++)
+                {
+                    if ((s[b] == opp) || (s[b] == 3)) continue;
+
+                    // adjacent slots connect directly
+                    if ((b == a + 1) || ((a == 0) && (b == 5))) continue;
+
+                    // otherwise one of the two arcs between them must be all X
+                    bool arc1 = true, arc2 = true;
+                    for (unsigned int k = a + 1; k < b; k++)
+                        if (s[k] != x) arc1 = false;
+                    for (unsigned int k = b + 1; k < a + 6; k++)
+                        if (s[k % 6] != x) arc2 = false;
+
+                    useless = arc1 || arc2;
+                }
+            }
+
+            if (useless)
+                uselessTable[code] |= x;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexPatternEngine::RingCode(HexBoard &board, unsigned int row, unsigned int col);
+
+   Returns the 12 bit code describing the 6 neighbors of cell (row, col)
+   ---------------------------------------------------------------------------- */
+unsigned int HexPatternEngine::RingCode(HexBoard &board, unsigned int row, unsigned int col)
+{
+    int n = board.Size();
+    unsigned int code = 0;
+
+    for (unsigned int k = 0; k < 6; k++)
+    {
+        int r = row + slotRow[k];
+        int c = col + slotCol[k];
+        unsigned int bits;
+
+        if ((r < 0) || (r >= n))
+            bits = slotBits(HEXBLUE);           // beyond blue's edges
+        else if ((c < 0) || (c >= n))
+            bits = slotBits(HEXRED);            // beyond red's edges
+        else
+            bits = slotBits(board.GetColor(r, c));
+
+        code |= (bits << (2 * k));
+    }
+
+    return code;
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexPatternEngine::IsDead(unsigned int code);
+   bool HexPatternEngine::IsUseless(unsigned int code, HexColor color);
+
+   Table lookups:  IsUseless() returns true if a stone of the given color on a
+   cell with the given ring can never help that color;  IsDead() returns true
+   if that holds for both colors.
+   ---------------------------------------------------------------------------- */
+bool HexPatternEngine::IsDead(unsigned int code)
+{   return (uselessTable[code & (HEXRING_CODES - 1)] == 0x03);   }
+
+bool HexPatternEngine::IsUseless(unsigned int code, HexColor color)
+{   return ((uselessTable[code & (HEXRING_CODES - 1)] & slotBits(color)) != 0);   }
+
+/* ----------------------------------------------------------------------------
+   HexCellClass HexPatternEngine::Classify(HexBoard &board, unsigned int row, unsigned int col);
+
+   Classifies a blank cell as dead, captured by one of the players, or live.
+   Occupied cells are reported as live.
+   ---------------------------------------------------------------------------- */
+HexCellClass HexPatternEngine::Classify(HexBoard &board, unsigned int row, unsigned int col)
+{
+    if (board.GetColor(row, col) != HEXBLANK)
+        return HEXCELL_LIVE;
+
+    if (IsDead(RingCode(board, row, col)))
+        return HEXCELL_DEAD;
+
+    unsigned int slot;
+    if (capturedPair(board, row, col, HEXBLUE, slot))
+        return HEXCELL_BLUECAPTURED;
+    if (capturedPair(board, row, col, HEXRED, slot))
+        return HEXCELL_REDCAPTURED;
+
+    return HEXCELL_LIVE;
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexPatternEngine::FillIn(HexBoard &board);
+
+   Fills dead cells (with either color) and captured cells (with the color of
+   the capturing player) until no more patterns apply.  The filled board has
+   the same winner under perfect play as the original one.
+
+   Returns the number of cells filled.
+   ---------------------------------------------------------------------------- */
+unsigned int HexPatternEngine::FillIn(HexBoard &board)
+{
+    unsigned int n = board.Size();
+    unsigned int nFilled = 0;
+    bool changed = true;
+
+    // filling a cell may complete a pattern elsewhere, repeat until stable
+    while (changed)
+    {
+        changed = false;
+
+        for (unsigned int row = 0; row < n; row++)
+        {
+            for (unsigned int col = 0; col < n; col++)
+            {
+                if (board.GetColor(row, col) != HEXBLANK)
+                    continue;
+
+                unsigned int code = RingCode(board, row, col);
+
+                if (IsDead(code))
+                {
+                    // color is irrelevant, go with the more common neighbor color
+                    unsigned int nBlue = 0, nRed = 0;
+                    for (unsigned int k = 0; k < 6; k++)
+                    {
+                        unsigned int bits = (code >> (2 * k)) & 0x03;
+                        if (bits == slotBits(HEXBLUE)) nBlue++;
+                        if (bits == slotBits(HEXRED)) nRed++;
+                    }
+
+                    board.SetColor(row, col, ((nBlue >= nRed) ? HEXBLUE : HEXRED));
+                    nFilled++;
+                    changed = true;
+                    continue;
+                }
+
+                for (unsigned int iColor = 0; iColor < 2; iColor++)
+                {
+                    HexColor color = ((iColor == 0) ? HEXBLUE : HEXRED);
+                    unsigned int slot, prow, pcol;
+
+                    if (capturedPair(board, row, col, color, slot) &&
+                        neighbor(board, row, col, slot, prow, pcol))
+                    {
+                        board.SetColor(row, col, color);
+                        board.SetColor(prow, pcol, color);
+                        nFilled += 2;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return nFilled;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternEngine::Candidates(HexBoard &board, HexColor turn, HexCellSet &hcs);
+
+   Returns the blank cells worth considering for player turn.  Intended to be
+   called on a board that has already gone through FillIn(), so that dead and
+   captured cells are no longer blank.
+
+   A cell is dropped when it is vulnerable: an opponent stone on some blank
+   neighbor would kill it.  Playing the killing neighbor instead is at least as
+   good, so the cell is dominated.  A cell is only ever dropped in favor of a
+   cell that is kept, so at least one candidate survives whenever the board
+   has a blank cell.
+   ---------------------------------------------------------------------------- */
+void HexPatternEngine::Candidates(HexBoard &board, HexColor turn, HexCellSet &hcs)
+{
+    unsigned int n = board.Size();
+    HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+    std::vector<bool> dominated(n * n, false);
+
+    hcs.clear();
+    hcs.reserve(n * n);
+
+    for (unsigned int row = 0; row < n; row++)
+    {
+        for (unsigned int col = 0; col < n; col++)
+        {
+            if (board.GetColor(row, col) != HEXBLANK)
+                continue;
+
+            for (unsigned int k = 0; k < 6; k++)
+            {
+                unsigned int nrow, ncol;
+
+                if (!neighbor(board, row, col, k, nrow, ncol)) continue;
+                if (board.GetColor(nrow, ncol) != HEXBLANK) continue;
+                if (dominated[nrow * n + ncol]) continue;
+
+                if (deadWith(board, row, col, k, opponent))
+                {
+                    dominated[row * n + col] = true;
+                    break;
+                }
+            }
+
+            if (!dominated[row * n + col])
+            {
+                HexCell cell;
+                cell.row = row;
+                cell.col = col;
+                cell.color = HEXBLANK;
+                hcs.push_back(cell);
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexPatternEngine::deadWith(HexBoard &board, unsigned int row, unsigned int col,
+                                   unsigned int slot, HexColor color);
+
+   Returns true if cell (row, col) would be dead if its neighbor in the given
+   ring slot were occupied by color.
+   ---------------------------------------------------------------------------- */
+bool HexPatternEngine::deadWith(HexBoard &board, unsigned int row, unsigned int col, unsigned int slot, HexColor color)
+{
+    unsigned int code = RingCode(board, row, col);
+    code &= ~(0x03 << (2 * slot));
+    code |= (slotBits(color) << (2 * slot));
+    return IsDead(code);
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexPatternEngine::capturedPair(HexBoard &board, unsigned int row, unsigned int col,
+                                       HexColor color, unsigned int &slot);
+
+   Determines whether blank cell (row, col) forms a captured pair for color
+   with one of its blank neighbors.  If so, returns true and the ring slot of
+   that neighbor.
+   ---------------------------------------------------------------------------- */
+bool HexPatternEngine::capturedPair(HexBoard &board, unsigned int row, unsigned int col, HexColor color, unsigned int &slot)
+{
+    for (unsigned int k = 0; k < 6; k++)
+    {
+        unsigned int nrow, ncol;
+
+        if (!neighbor(board, row, col, k, nrow, ncol)) continue;
+        if (board.GetColor(nrow, ncol) != HEXBLANK) continue;
+
+        // each cell must die once color takes the other one
+        if (deadWith(board, row, col, k, color) && deadWith(board, nrow, ncol, (k + 3) % 6, color))
+        {
+            slot = k;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexPatternEngine::neighbor(HexBoard &board, unsigned int row, unsigned int col,
+                                   unsigned int slot, unsigned int &nrow, unsigned int &ncol);
+
+   Retrieves the neighbor of (row, col) in the given ring slot.  Returns false
+   if that neighbor lies off the board.
+   ---------------------------------------------------------------------------- */
+bool HexPatternEngine::neighbor(HexBoard &board, unsigned int row, unsigned int col, unsigned int slot, unsigned int &nrow, unsigned int &ncol)
+{
+    int n = board.Size();
+    int r = row + slotRow[slot];
+    int c = col + slotCol[slot];
+
+    if ((r < 0) || (r >= n) || (c < 0) || (c >= n))
+        return false;
+
+    nrow = r;
+    ncol = c;
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef _HEXPATTERN_H_
+#define _HEXPATTERN_H_
+
+#include "hexboard.h"
+
+typedef enum enumHexCellClass {
+    HEXCELL_LIVE,           // no pattern applies, cell is a genuine candidate
+    HEXCELL_DEAD,           // color of cell can never affect who wins
+    HEXCELL_BLUECAPTURED,   // blue can claim cell without spending a move
+    HEXCELL_REDCAPTURED,    // red can claim cell without spending a move
+    HEXCELL_DOMINATED       // a neighboring move is at least as good for the mover
+} HexCellClass;
+
+// number of distinct codes for the 6-neighbor ring (2 bits per neighbor)
+const unsigned int HEXRING_CODES = 4096;
+
+/* ============================================================================
+   HexPatternEngine class
+
+   Recognizes dead, captured and dominated cells from the stones surrounding
+   them, using tables precomputed over every possible 6-neighbor ring.
+   ============================================================================ */
+class HexPatternEngine {
+    public:
+    HexPatternEngine(void);
+    unsigned int RingCode(HexBoard &board, unsigned int row, unsigned int col);
+    bool IsDead(unsigned int code);
+    bool IsUseless(unsigned int code, HexColor color);
+    HexCellClass Classify(HexBoard &board, unsigned int row, unsigned int col);
+    unsigned int FillIn(HexBoard &board);
+    void Candidates(HexBoard &board, HexColor turn, HexCellSet &hcs);
+
+    private:
+    // bit 0 set if ring is useless to blue, bit 1 set if useless to red
+    unsigned char uselessTable[HEXRING_CODES];
+
+    bool deadWith(HexBoard &board, unsigned int row, unsigned int col, unsigned int slot, HexColor color);
+    bool capturedPair(HexBoard &board, unsigned int row, unsigned int col, HexColor color, unsigned int &slot);
+    bool neighbor(HexBoard &board, unsigned int row, unsigned int col, unsigned int slot, unsigned int &nrow, unsigned int &ncol);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include <cstring>
+#include <cerrno>
+#include "hexperf.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* ============================================================================
+   HexPerfCounters class
+
+   Each event is opened as its own counter (not as a group), so that a
+   machine lacking one event, typically cache misses in a VM, still reports
+   the others.
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexPerfCounters(void)   -- creates a closed set of counters
+    ~HexPerfCounters(void)  -- closes the counters
+   ---------------------------------------------------------------------------- */
+HexPerfCounters::HexPerfCounters(void)
+{
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+        fd[i] = -1;
+    reason = "not opened";
+}
+
+HexPerfCounters::~HexPerfCounters(void)
+{   Close();    }
+
+/* ----------------------------------------------------------------------------
+   bool HexPerfCounters::Open(void);
+
+   Opens the counters for the calling thread, user space only.  Returns true
+   if at least one event could be opened;  otherwise Reason() describes the
+   failure.
+   ---------------------------------------------------------------------------- */
+bool HexPerfCounters::Open(void)
+{
+    Close();
+
+#ifdef __linux__
+    static const uint64_t config[HEXPERF_NEVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    int firstError = 0;
+    bool any = false;
+
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd[i] >= 0)
+            any = true;
+        else if (firstError == 0)
+            firstError = errno;
+    }
+
+    if (any)
+    {
+        reason.clear();
+        return true;
+    }
+
+    reason = std::string("perf_event_open: ") + strerror(firstError);
+#else
+    reason = "hardware counters are only supported on Linux";
+#endif
+
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPerfCounters::Close(void);
+   bool HexPerfCounters::IsOpen(void);
+   ---------------------------------------------------------------------------- */
+void HexPerfCounters::Close(void)
+{
+#ifdef __linux__
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        if (fd[i] >= 0)
+            close(fd[i]);
+        fd[i] = -1;
+    }
+#endif
+}
+
+bool HexPerfCounters::IsOpen(void)
+{
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+        if (fd[i] >= 0) return true;
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPerfCounters::Start(void);
+   void HexPerfCounters::Stop(HexPerfSample &sample);
+
+   Start() zeroes and enables the counters;  Stop() disables them and returns
+   the counts since Start().  Events that are not open come back not valid.
+   ---------------------------------------------------------------------------- */
+void HexPerfCounters::Start(void)
+{
+#ifdef __linux__
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        if (fd[i] < 0) continue;
+        ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void HexPerfCounters::Stop(HexPerfSample &sample)
+{
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        sample.count[i] = 0;
+        sample.valid[i] = false;
+    }
+
+#ifdef __linux__
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+        if (fd[i] >= 0) ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (unsigned int i = 0; i < HEXPERF_NEVENTS; i++)
+    {
+        uint64_t values[3];         // value, time enabled, time running
+        if ((fd[i] < 0) || (read(fd[i], values, sizeof(values)) != sizeof(values)) || (values[2] == 0))
+            continue;
+
+        // scale up if the counter only ran part of the time
+        sample.count[i] = ((values[2] < values[1]) ? (uint64_t) ((double) values[0] * values[1] / values[2]) : values[0]);
+        sample.valid[i] = true;
+    }
+#endif
+}
+
+// why Open() failed, empty if it succeeded
+const std::string &HexPerfCounters::Reason(void)
+{   return reason;  }
+
+/* ----------------------------------------------------------------------------
+   const char *HexPerfCounters::Name(HexPerfEvent e);
+
+   Short lower case name of an event, used as a JSON key
+   ---------------------------------------------------------------------------- */
+const char *HexPerfCounters::Name(HexPerfEvent e)
+{
+    static const char *names[HEXPERF_NEVENTS] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+    return names[e];
+}
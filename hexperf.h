@@ -0,0 +1,56 @@
+#ifndef _HEXPERF_H_
+#define _HEXPERF_H_
+
+#include <stdint.h>
+#include <string>
+
+typedef enum enumHexPerfEvent {
+    HEXPERF_CYCLES,
+    HEXPERF_INSTRUCTIONS,
+    HEXPERF_CACHEMISSES,
+    HEXPERF_BRANCHMISSES,
+    HEXPERF_NEVENTS
+} HexPerfEvent;
+
+typedef struct structHexPerfSample {
+    uint64_t count[HEXPERF_NEVENTS];
+    bool     valid[HEXPERF_NEVENTS];        // false if the event could not be opened or never ran
+} HexPerfSample;
+
+/* ============================================================================
+   HexPerfCounters class
+
+   Hardware counters of the calling thread (Linux perf_event_open), read
+   around a region of code:
+
+        HexPerfCounters perf;
+        if (perf.Open()) { perf.Start(); ...region...; perf.Stop(sample); }
+
+   Open() fails when the kernel or container does not allow counters (e.g.
+   perf_event_paranoid, seccomp, or no PMU in a VM);  Reason() then tells why
+   and callers should fall back to timing only.  On other systems Open()
+   always fails.  Counts are scaled up when the kernel had to multiplex the
+   counters.
+   ============================================================================ */
+class HexPerfCounters {
+    public:
+    HexPerfCounters(void);
+    ~HexPerfCounters(void);
+    bool Open(void);
+    void Close(void);
+    bool IsOpen(void);
+    void Start(void);
+    void Stop(HexPerfSample &sample);
+    const std::string &Reason(void);
+    static const char *Name(HexPerfEvent e);
+
+    private:
+    int fd[HEXPERF_NEVENTS];
+    std::string reason;
+
+    // no copies, the object owns its file descriptors
+    HexPerfCounters(const HexPerfCounters &);
+    HexPerfCounters &operator=(const HexPerfCounters &);
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hexrecord.h"
+
+/* ============================================================================
+   Game records
+
+   A record stores one byte per move, so a full 15 x 15 game with engine
+   stats takes well under 3KB, and millions of games can be scanned straight
+   from the page cache.
+   ============================================================================ */
+
+static const char recordMagic[4] = {'H', 'X', 'G', '1'};
+
+// bytes taken by the moves of a record, padded so that the stats stay aligned
+static size_t paddedMoves(unsigned int nMoves)
+{   return (nMoves + 3) & ~((size_t) 3);    }
+
+/* ============================================================================
+   HexRecordWriter class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   void HexRecordWriter::Start(unsigned int size, HexColor first, const char *bluePlayer,
+                               const char *redPlayer);
+
+   Begins a new game record, discarding any moves collected so far.  Player
+   names longer than HEXRECORD_NAMELENGTH are truncated.
+   ---------------------------------------------------------------------------- */
+void HexRecordWriter::Start(unsigned int size, HexColor first, const char *bluePlayer, const char *redPlayer)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, recordMagic, sizeof(recordMagic));
+    header.size = size;
+    header.first = first;
+    header.winner = HEXBLANK;
+    header.flags = HEXRECORD_STATS;
+    memcpy(header.players[0], bluePlayer, strnlen(bluePlayer, HEXRECORD_NAMELENGTH));
+    memcpy(header.players[1], redPlayer, strnlen(redPlayer, HEXRECORD_NAMELENGTH));
+
+    moves.clear();
+    stats.clear();
+}
+
+/* ----------------------------------------------------------------------------
+   void HexRecordWriter::Move(unsigned int row, unsigned int col, const HexRecordMoveStats &moveStats);
+
+   Adds the next (accepted) move of the game
+   ---------------------------------------------------------------------------- */
+void HexRecordWriter::Move(unsigned int row, unsigned int col, const HexRecordMoveStats &moveStats)
+{
+    if ((row >= header.size) || (col >= header.size))
+        throw HEXBOARD_ERR_INVALIDCELL;
+
+    moves.push_back(row * header.size + col);
+    stats.push_back(moveStats);
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexRecordWriter::Finish(HexColor winner, const char *filename);
+
+   Appends the game to filename (created if needed) with a single write, so
+   that games finishing at the same time do not interleave.  Returns true if
+   successful.
+   ---------------------------------------------------------------------------- */
+bool HexRecordWriter::Finish(HexColor winner, const char *filename)
+{
+    size_t movesLength = paddedMoves(moves.size());
+
+    header.nMoves = moves.size();
+    header.winner = winner;
+    header.length = sizeof(header) + movesLength + stats.size() * sizeof(HexRecordMoveStats);
+
+    std::vector<uint8_t> buffer(header.length, 0);
+    memcpy(&buffer[0], &header, sizeof(header));
+    if (moves.size() > 0)
+    {
+        memcpy(&buffer[sizeof(header)], &moves[0], moves.size());
+        memcpy(&buffer[sizeof(header) + movesLength], &stats[0], stats.size() * sizeof(HexRecordMoveStats));
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+        return false;
+
+    bool ok = (write(fd, &buffer[0], buffer.size()) == (ssize_t) buffer.size());
+    return ((close(fd) == 0) && ok);
+}
+
+/* ============================================================================
+   HexRecordReader class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexRecordReader(void)   -- creates a reader with no file
+    ~HexRecordReader(void)  -- unmaps the file, if any
+   ---------------------------------------------------------------------------- */
+HexRecordReader::HexRecordReader(void)
+{
+    mapping = (void *)0;
+    mappingSize = 0;
+    offset = 0;
+}
+
+HexRecordReader::~HexRecordReader(void)
+{   Close();    }
+
+/* ----------------------------------------------------------------------------
+   bool HexRecordReader::Open(const char *filename);
+
+   Maps the given record file and positions the reader on its first game.
+   Returns false if the file cannot be mapped.  An empty file is valid.
+   ---------------------------------------------------------------------------- */
+bool HexRecordReader::Open(const char *filename)
+{
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                          // the mapping stays valid
+
+    if (p == MAP_FAILED)
+        return false;
+
+    // games are read front to back, once
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    mapping = p;
+    mappingSize = st.st_size;
+    offset = 0;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexRecordReader::Close(void);
+   void HexRecordReader::Rewind(void);
+
+   Close() unmaps the file;  Rewind() goes back to the first game.
+   ---------------------------------------------------------------------------- */
+void HexRecordReader::Close(void)
+{
+    if (mapping != (void *)0)
+        munmap(mapping, mappingSize);
+
+    mapping = (void *)0;
+    mappingSize = 0;
+    offset = 0;
+}
+
+void HexRecordReader::Rewind(void)
+{   offset = 0; }
+
+/* ----------------------------------------------------------------------------
+   bool HexRecordReader::Next(HexGameRecord &game);
+
+   Points game at the next game in the file.  Returns false at the end of the
+   file, or at the first record that is truncated or not valid:  besides the
+   header's fields and lengths, every move must be a cell of the board played
+   at most once, so that callers can use the moves without checking them.
+   ---------------------------------------------------------------------------- */
+bool HexRecordReader::Next(HexGameRecord &game)
+{
+    if (offset + sizeof(HexRecordHeader) > mappingSize)
+        return false;
+
+    const uint8_t *base = ((const uint8_t *) mapping) + offset;
+    const HexRecordHeader *header = (const HexRecordHeader *) base;
+
+    size_t movesLength = paddedMoves(header->nMoves);
+    size_t statsLength = ((header->flags & HEXRECORD_STATS) ? header->nMoves * sizeof(HexRecordMoveStats) : 0);
+
+    if ((memcmp(header->magic, recordMagic, sizeof(recordMagic)) != 0) ||
+        (header->size < HEXMINSIZE) || (header->size > HEXMAXSIZE) ||
+        (header->length != sizeof(HexRecordHeader) + movesLength + statsLength) ||
+        (offset + header->length > mappingSize))
+        return false;
+
+    if (((header->first != HEXBLUE) && (header->first != HEXRED)) ||
+        ((header->winner != HEXBLUE) && (header->winner != HEXRED) && (header->winner != HEXBLANK)))
+        return false;
+
+    const uint8_t *moves = base + sizeof(HexRecordHeader);
+    unsigned int n2 = header->size * header->size;
+    bool played[HEXMAXSIZE * HEXMAXSIZE] = {false};
+
+    if (header->nMoves > n2)
+        return false;
+
+    for (unsigned int i = 0; i < header->nMoves; i++)
+    {
+        if ((moves[i] >= n2) || played[moves[i]])
+            return false;
+        played[moves[i]] = true;
+    }
+
+    game.header = header;
+    game.moves = moves;
+    game.stats = ((statsLength > 0) ? (const HexRecordMoveStats *) (game.moves + movesLength) : (const HexRecordMoveStats *)0);
+
+    offset += header->length;
+    return true;
+}
+
+/* ============================================================================
+   HexGameRecord class
+   ============================================================================ */
+
+unsigned int HexGameRecord::Size(void)
+{   return header->size;    }
+
+unsigned int HexGameRecord::Moves(void)
+{   return header->nMoves;  }
+
+HexColor HexGameRecord::Winner(void)
+{   return (HexColor) header->winner;  }
+
+HexColor HexGameRecord::First(void)
+{   return (HexColor) header->first;   }
+
+bool HexGameRecord::HasStats(void)
+{   return (stats != (const HexRecordMoveStats *)0);    }
+
+/* ----------------------------------------------------------------------------
+   std::string HexGameRecord::Player(HexColor color);
+
+   Returns the name of the player who played color
+   ---------------------------------------------------------------------------- */
+std::string HexGameRecord::Player(HexColor color)
+{
+    if ((color != HEXBLUE) && (color != HEXRED))
+        throw HEXGAME_ERR_INVALIDCOLOR;
+
+    const char *name = header->players[(color == HEXBLUE) ? 0 : 1];
+    return std::string(name, strnlen(name, HEXRECORD_NAMELENGTH));
+}
+
+/* ----------------------------------------------------------------------------
+   HexColor HexGameRecord::Color(unsigned int iMove);
+   void HexGameRecord::Move(unsigned int iMove, unsigned int &row, unsigned int &col);
+   const HexRecordMoveStats &HexGameRecord::Stats(unsigned int iMove);
+
+   The color, cell and engine stats of move iMove (0 is the first move).
+   Stats() is only valid if HasStats().
+   ---------------------------------------------------------------------------- */
+HexColor HexGameRecord::Color(unsigned int iMove)
+{
+    HexColor second = ((First() == HEXBLUE) ? HEXRED : HEXBLUE);
+    return (((iMove % 2) == 0) ? First() : second);
+}
+
+void HexGameRecord::Move(unsigned int iMove, unsigned int &row, unsigned int &col)
+{
+    if (iMove >= header->nMoves)
+        throw HEXBOARD_ERR_INVALIDCELL;
+
+    row = moves[iMove] / header->size;
+    col = moves[iMove] % header->size;
+}
+
+const HexRecordMoveStats &HexGameRecord::Stats(unsigned int iMove)
+{   return stats[iMove];    }
+
+/* ----------------------------------------------------------------------------
+   void HexGameRecord::Sgf(std::ostream &out);
+
+   Writes the game as SGF (GM[11], as read by HexGui and most Hex tools).  SGF
+   Hex has black connect top to bottom and move first, so blue is written as
+   B and red as W.  Cells are written as a column letter and a 1-based row.
+   ---------------------------------------------------------------------------- */
+static std::string sgfText(const std::string &s)
+{
+    std::string t;
+    for (unsigned int i = 0; i < s.size(); i++)
+    {
+        if ((s[i] == ']') || (s[i] == '\\')) t += '\\';
+        t += s[i];
+    }
+    return t;
+}
+
+void HexGameRecord::Sgf(std::ostream &out)
+{
+    out << "(;FF[4]GM[11]AP[cpphw5]SZ[" << Size() << "]"
+        << "PB[" << sgfText(Player(HEXBLUE)) << "]PW[" << sgfText(Player(HEXRED)) << "]";
+
+    if (Winner() != HEXBLANK)
+        out << "RE[" << ((Winner() == HEXBLUE) ? 'B' : 'W') << "+]";
+
+    for (unsigned int i = 0; i < Moves(); i++)
+    {
+        unsigned int row, col;
+        Move(i, row, col);
+        out << ";" << ((Color(i) == HEXBLUE) ? 'B' : 'W') << "[" << (char) ('a' + col) << (row + 1) << "]";
+    }
+
+    out << ")\n";
+}
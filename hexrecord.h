@@ -0,0 +1,112 @@
+#ifndef _HEXRECORD_H_
+#define _HEXRECORD_H_
+
+#include <stdint.h>
+#include <vector>
+#include <ostream>
+#include "hexboard.h"
+
+/* ----------------------------------------------------------------------------
+   Game record files are a plain concatenation of game records, so they can be
+   appended to by concurrent games and joined with cat.  Each record is
+
+        HexRecordHeader
+        nMoves bytes            cell of each move, row * size + col, padded
+                                with zeros to a multiple of 4 bytes
+        HexRecordMoveStats      one per move, if HEXRECORD_STATS is set
+
+   All values are in the byte order of the machine that wrote them.
+   ---------------------------------------------------------------------------- */
+const unsigned int HEXRECORD_NAMELENGTH = 24;
+const uint8_t HEXRECORD_STATS = 0x01;              // flags: per-move engine stats follow the moves
+
+typedef struct structHexRecordHeader {
+    char     magic[4];          // "HXG1"
+    uint32_t length;            // bytes in this record, header included
+    uint16_t nMoves;
+    uint8_t  size;              // board size
+    uint8_t  first;             // HexColor of the player who moved first
+    uint8_t  winner;            // HexColor of the winner, HEXBLANK if unfinished
+    uint8_t  flags;
+    uint16_t reserved;
+    char     players[2][HEXRECORD_NAMELENGTH];     // blue, red;  NUL padded, may fill the field
+} HexRecordHeader;
+
+typedef struct structHexRecordMoveStats {
+    uint32_t micros;            // time the player took for the move
+    uint32_t rollouts;          // engine counters during the move (HexStats)
+    uint16_t candidates;
+    uint16_t cutoffs;
+} HexRecordMoveStats;
+
+/* ============================================================================
+   HexGameRecord class
+
+   One game of a record file, pointing straight into the file mapping (valid
+   until the reader is closed or reopened).
+   ============================================================================ */
+class HexGameRecord {
+    public:
+    unsigned int Size(void);
+    unsigned int Moves(void);
+    HexColor Winner(void);
+    HexColor First(void);
+    std::string Player(HexColor color);
+    HexColor Color(unsigned int iMove);
+    void Move(unsigned int iMove, unsigned int &row, unsigned int &col);
+    bool HasStats(void);
+    const HexRecordMoveStats &Stats(unsigned int iMove);
+    void Sgf(std::ostream &out);
+
+    private:
+    const HexRecordHeader *header;
+    const uint8_t *moves;
+    const HexRecordMoveStats *stats;
+
+    friend class HexRecordReader;
+};
+
+/* ============================================================================
+   HexRecordWriter class
+
+   Collects the moves of one game and appends the finished record to a file.
+   ============================================================================ */
+class HexRecordWriter {
+    public:
+    void Start(unsigned int size, HexColor first, const char *bluePlayer, const char *redPlayer);
+    void Move(unsigned int row, unsigned int col, const HexRecordMoveStats &moveStats);
+    bool Finish(HexColor winner, const char *filename);
+
+    private:
+    HexRecordHeader header;
+    std::vector<uint8_t> moves;
+    std::vector<HexRecordMoveStats> stats;
+};
+
+/* ============================================================================
+   HexRecordReader class
+
+   Memory maps a record file and iterates over its games without copying
+   them.  A truncated last record (e.g. from a crash during a write) ends the
+   iteration.
+   ============================================================================ */
+class HexRecordReader {
+    public:
+    HexRecordReader(void);
+    ~HexRecordReader(void);
+    bool Open(const char *filename);
+    void Close(void);
+    void Rewind(void);
+    bool Next(HexGameRecord &game);
+
+    private:
+    void *mapping;
+    size_t mappingSize;
+    size_t offset;              // of the next record
+
+    // no copies, the mapping is owned by a single object
+    HexRecordReader(const HexRecordReader &);
+    HexRecordReader &operator=(const HexRecordReader &);
+};
+
+#endif
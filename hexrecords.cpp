@@ -0,0 +1,381 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include "hexboard.h"
+#include "hexpattern.h"
+#include "hexrollout.h"
+#include "hexrecord.h"
+#include "hexnet.h"
+
+/* ============================================================================
+   hexrecords
+
+   Reads game record files written by HexGame (the record option, hexmain
+   -record, hextournament -record).
+
+   usage:  hexrecords <recordfile>
+           hexrecords -sgf <recordfile> [first [count]]
+           hexrecords -tensors <recordfile> <outfile> [size]
+           hexrecords -patterns <recordfile> <outfile> [iterations]
+
+   The first form summarizes the file:  games per board size, wins by color
+   and by player, average game length and engine work per move.  The second
+   writes games to stdout as SGF, one game per line, starting at game number
+   first (0 based).  The third writes every position of the games of the
+   given board size (default: that of the first game) as training data for
+   a HexNet policy/value network:  the network's input planes, the move
+   played and the game's result (format in hexnet.h).  The fourth fits
+   the ring weights of a HexPatternPolicy to the moves of every game, and
+   writes them as a weight file (format in hexrollout.h).
+   ============================================================================ */
+
+static void usage(void)
+{
+    std::cout << "usage: hexrecords <recordfile>\n"
+              << "       hexrecords -sgf <recordfile> [first [count]]\n"
+              << "       hexrecords -tensors <recordfile> <outfile> [size]\n"
+              << "       hexrecords -patterns <recordfile> <outfile> [iterations]\n";
+    exit(1);
+}
+
+static unsigned long readArg(const char *arg)
+{
+    std::istringstream ss(arg);
+    unsigned long t;
+
+    ss >> t;
+    if (ss.fail())
+        usage();
+
+    return t;
+}
+
+typedef struct structPlayerTotals {
+    unsigned long games, wins;
+} PlayerTotals;
+
+/* ----------------------------------------------------------------------------
+   static int summarize(HexRecordReader &reader);
+
+   Prints totals over every game in the file
+   ---------------------------------------------------------------------------- */
+static int summarize(HexRecordReader &reader)
+{
+    HexGameRecord game;
+    std::map<unsigned int, unsigned long> sizes;
+    std::map<std::string, PlayerTotals> players;
+    unsigned long nGames = 0, nMoves = 0, blueWins = 0, redWins = 0;
+    unsigned long long rollouts = 0, micros = 0, statMoves = 0;
+
+    while (reader.Next(game))
+    {
+        nGames++;
+        nMoves += game.Moves();
+        sizes[game.Size()]++;
+
+        if (game.Winner() == HEXBLUE) blueWins++;
+        if (game.Winner() == HEXRED) redWins++;
+
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            HexColor color = ((i == 0) ? HEXBLUE : HEXRED);
+            PlayerTotals &t = players[game.Player(color)];
+            t.games++;
+            if (game.Winner() == color) t.wins++;
+        }
+
+        if (game.HasStats())
+        {
+            for (unsigned int i = 0; i < game.Moves(); i++)
+            {
+                rollouts += game.Stats(i).rollouts;
+                micros += game.Stats(i).micros;
+                statMoves++;
+            }
+        }
+    }
+
+    std::cout << "games:        " << nGames << "\n";
+    if (nGames == 0)
+        return 0;
+
+    std::cout << "sizes:       ";
+    for (std::map<unsigned int, unsigned long>::iterator it = sizes.begin(); it != sizes.end(); ++it)
+        std::cout << " " << it->first << "x" << it->first << ":" << it->second;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "\nwins:         BLUE " << blueWins << ", RED " << redWins
+              << "\nmoves/game:   " << ((double) nMoves) / nGames << "\n";
+
+    if (statMoves > 0)
+        std::cout << "per move:     " << ((double) rollouts) / statMoves << " rollouts, "
+                  << std::setprecision(3) << micros / 1000.0 / statMoves << "ms\n";
+
+    for (std::map<std::string, PlayerTotals>::iterator it = players.begin(); it != players.end(); ++it)
+        std::cout << "player " << std::left << std::setw(24) << it->first << std::right
+                  << " " << it->second.wins << "/" << it->second.games << " won\n";
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+   static int tensors(HexRecordReader &reader, const char *filename, unsigned int size);
+
+   Writes a training tensor file of the positions of every game of the given
+   size (0: the size of the first game), from the side to move
+   ---------------------------------------------------------------------------- */
+static int tensors(HexRecordReader &reader, const char *filename, unsigned int size)
+{
+    FILE *f = fopen(filename, "wb");
+    if (f == (FILE *)0)
+    {
+        std::cout << "could not write " << filename << "\n";
+        return 1;
+    }
+
+    HexNetTensorHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HexNetTensorMagic, sizeof(header.magic));
+    header.planes = HEXNET_PLANES;
+
+    // the header is written again at the end, with the size and count
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+
+    HexGameRecord game;
+    HexCellColors cells;
+    std::vector<float> planes;
+    unsigned long nGames = 0, nSkipped = 0;
+
+    while (ok && reader.Next(game))
+    {
+        if (size == 0)
+            size = game.Size();
+
+        if (game.Size() != size)
+        {
+            nSkipped++;
+            continue;
+        }
+
+        unsigned int n2 = size * size;
+        cells.assign(n2, HEXBLANK);
+        planes.resize(HEXNET_PLANES * n2);
+        nGames++;
+
+        for (unsigned int i = 0; ok && (i < game.Moves()); i++)
+        {
+            unsigned int row, col;
+            HexColor color = game.Color(i);
+            game.Move(i, row, col);
+
+            uint32_t move = HexNet::Orient(row * size + col, size, color);
+            float result = ((game.Winner() == HEXBLANK) ? 0 : ((game.Winner() == color) ? 1 : -1));
+
+            HexNet::Encode(cells, size, color, &planes[0]);
+            ok = ((fwrite(&planes[0], sizeof(float), planes.size(), f) == planes.size()) &&
+                  (fwrite(&move, sizeof(move), 1, f) == 1) &&
+                  (fwrite(&result, sizeof(result), 1, f) == 1));
+
+            cells[row * size + col] = color;
+            header.count++;
+        }
+    }
+
+    header.size = size;
+    ok = ok && (fseek(f, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, f) == 1);
+
+    if ((fclose(f) != 0) || !ok)
+    {
+        std::cout << "could not write " << filename << "\n";
+        return 1;
+    }
+
+    std::cout << header.count << " positions from " << nGames << " games of size " << size;
+    if (nSkipped > 0)
+        std::cout << " (" << nSkipped << " games of other sizes skipped)";
+    std::cout << "\n";
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+   static int patterns(HexRecordReader &reader, const char *filename, unsigned int nIterations);
+
+   Fits ring weights to the moves of every game, of any size, and writes them
+   as a HexPatternPolicy weight file.
+
+   Each move is a competition among the rings of the blank cells, won by the
+   ring of the cell played, with odds proportional to the weights (the
+   Bradley-Terry model the policy samples from).  The weights maximizing the
+   likelihood of the moves are found by minorization-maximization (Coulom,
+   "Computing Elo Ratings of Move Patterns"):  each iteration sets a ring's
+   weight to its wins over the sum, across the moves where it competed, of
+   its count of cells over the total weight of the cells.  One virtual win
+   and one virtual loss against a ring of weight 1 keep rings that were
+   never played (or always played) finite.
+   ---------------------------------------------------------------------------- */
+typedef struct structPatternMove {
+    unsigned long first;        // rings of its blank cells, in rings[first..]
+    unsigned int count;
+    unsigned short played;      // ring of the cell played
+    unsigned char turn;         // 0 blue, 1 red
+} PatternMove;
+
+static int patterns(HexRecordReader &reader, const char *filename, unsigned int nIterations)
+{
+    HexPatternEngine engine;
+    HexGameRecord game;
+    std::vector<PatternMove> moves;
+    std::vector<unsigned short> rings;
+    std::vector<double> wins[2];
+    unsigned long nGames = 0;
+
+    for (unsigned int t = 0; t < 2; t++)
+        wins[t].assign(HEXRING_CODES, 0);
+
+    while (reader.Next(game))
+    {
+        unsigned int n = game.Size();
+        HexBoard board(n);
+        nGames++;
+
+        for (unsigned int i = 0; i < game.Moves(); i++)
+        {
+            unsigned int row, col;
+            HexColor color = game.Color(i);
+            game.Move(i, row, col);
+
+            PatternMove m;
+            m.first = rings.size();
+            m.turn = ((color == HEXBLUE) ? 0 : 1);
+            m.played = engine.RingCode(board, row, col);
+
+            for (unsigned int r = 0; r < n; r++)
+                for (unsigned int c = 0; c < n; c++)
+                    if (board.GetColor(r, c) == HEXBLANK)
+                        rings.push_back(engine.RingCode(board, r, c));
+
+            m.count = rings.size() - m.first;
+            moves.push_back(m);
+            wins[m.turn][m.played] += 1;
+
+            board.SetColor(row, col, color);
+        }
+    }
+
+    if (moves.empty())
+    {
+        std::cout << "no moves in the file\n";
+        return 1;
+    }
+
+    std::vector<double> gamma[2], denom[2];
+    for (unsigned int t = 0; t < 2; t++)
+        gamma[t].assign(HEXRING_CODES, 1.0);
+
+    std::cout << moves.size() << " moves from " << nGames << " games\n";
+
+    for (unsigned int it = 0; it < nIterations; it++)
+    {
+        double logLikelihood = 0;
+
+        for (unsigned int t = 0; t < 2; t++)
+            denom[t].assign(HEXRING_CODES, 0);
+
+        for (unsigned long j = 0; j < moves.size(); j++)
+        {
+            const PatternMove &m = moves[j];
+            const std::vector<double> &g = gamma[m.turn];
+            const unsigned short *r = &rings[m.first];
+            double strength = 0;
+
+            for (unsigned int i = 0; i < m.count; i++)
+                strength += g[r[i]];
+
+            logLikelihood += log(g[m.played] / strength);
+
+            for (unsigned int i = 0; i < m.count; i++)
+                denom[m.turn][r[i]] += 1 / strength;
+        }
+
+        for (unsigned int t = 0; t < 2; t++)
+            for (unsigned int code = 0; code < HEXRING_CODES; code++)
+                gamma[t][code] = (wins[t][code] + 1) / (denom[t][code] + 2 / (gamma[t][code] + 1));
+
+        std::cout << "iteration " << std::setw(3) << it + 1 << "   log likelihood per move "
+                  << std::fixed << std::setprecision(4) << logLikelihood / moves.size() << "\n";
+    }
+
+    HexPatternPolicy policy;
+    for (unsigned int code = 0; code < HEXRING_CODES; code++)
+    {
+        policy.SetWeight(HEXBLUE, code, (float) gamma[0][code]);
+        policy.SetWeight(HEXRED, code, (float) gamma[1][code]);
+    }
+
+    try
+    {
+        policy.Save(filename);
+    }
+    catch (HexRolloutError e)
+    {
+        std::cout << "could not write " << filename << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc > 1) && (!strcmp(argv[1], "-tensors") || !strcmp(argv[1], "-patterns")))
+    {
+        if ((argc < 4) || (argc > 5))
+            usage();
+
+        HexRecordReader reader;
+        if (!reader.Open(argv[2]))
+        {
+            std::cout << "could not read " << argv[2] << "\n";
+            return 1;
+        }
+
+        if (!strcmp(argv[1], "-patterns"))
+            return patterns(reader, argv[3], ((argc > 4) ? readArg(argv[4]) : 20));
+
+        return tensors(reader, argv[3], ((argc > 4) ? readArg(argv[4]) : 0));
+    }
+
+    bool sgf = ((argc > 1) && !strcmp(argv[1], "-sgf"));
+    int iFile = (sgf ? 2 : 1);
+
+    if ((argc <= iFile) || (!sgf && (argc > 2)) || (argc > iFile + 3))
+        usage();
+
+    HexRecordReader reader;
+    if (!reader.Open(argv[iFile]))
+    {
+        std::cout << "could not read " << argv[iFile] << "\n";
+        return 1;
+    }
+
+    if (!sgf)
+        return summarize(reader);
+
+    unsigned long first = ((argc > iFile + 1) ? readArg(argv[iFile + 1]) : 0);
+    unsigned long count = ((argc > iFile + 2) ? readArg(argv[iFile + 2]) : (unsigned long) -1);
+
+    HexGameRecord game;
+    for (unsigned long iGame = 0; reader.Next(game); iGame++)
+    {
+        if (iGame < first) continue;
+        if (iGame - first >= count) break;
+        game.Sgf(std::cout);
+    }
+
+    return 0;
+}
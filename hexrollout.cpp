@@ -0,0 +1,861 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "hexrollout.h"
+
+/* ============================================================================
+   HexRolloutPolicy class
+
+   Default rollout policy:  plays the open cells in uniformly random order,
+   alternating colors.
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   HexRolloutPolicy *HexRolloutPolicy::Clone(void) const;
+
+   Returns a new copy of the policy (owned by the caller), so that parallel
+   searches can give each thread a policy of its own.  Every policy with
+   state of its own overrides this.
+   ---------------------------------------------------------------------------- */
+HexRolloutPolicy *HexRolloutPolicy::Clone(void) const
+{   return new HexRolloutPolicy(*this); }
+
+/* ----------------------------------------------------------------------------
+   void HexRolloutPolicy::Start(HexBoard &board);
+
+   Called once before a series of playouts from the position on board, so that
+   a policy can precompute whatever it needs about that position.
+   ---------------------------------------------------------------------------- */
+void HexRolloutPolicy::Start(HexBoard &)
+{}
+
+/* ----------------------------------------------------------------------------
+   void HexRolloutPolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+
+   Fills all the cells produced by mg, alternating colors beginning with first.
+   board must be in trial mode, so that cells from a previous playout can be
+   overwritten.
+   ---------------------------------------------------------------------------- */
+void HexRolloutPolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first)
+{
+    HexColor turns[2] = {first, ((first == HEXBLUE) ? HEXRED : HEXBLUE)};
+    unsigned int idMove, moveRow, moveCol;
+
+    // reshuffle sequence
+    mg.Shuffle();
+
+    // play all moves sequentially until board full
+    for (unsigned int i = 0; mg.Next(idMove, moveRow, moveCol); i++)
+        board.SetColor(moveRow, moveCol, turns[i % 2]);
+}
+
+/* ----------------------------------------------------------------------------
+   void HexRolloutPolicy::Result(HexColor winner);
+   HexReplyTable *HexRolloutPolicy::Replies(void);
+
+   Result() is called with the winner after every playout;  the default
+   policy learns nothing from it.  Replies() returns the policy's reply
+   table, or a null pointer if it does not keep one.
+   ---------------------------------------------------------------------------- */
+void HexRolloutPolicy::Result(HexColor)
+{}
+
+HexReplyTable *HexRolloutPolicy::Replies(void)
+{   return (HexReplyTable *)0;  }
+
+/* ============================================================================
+   HexReplyTable class
+   ============================================================================ */
+
+static inline unsigned int replyIndex(HexColor color)
+{   return ((color == HEXBLUE) ? 0 : 1);  }
+
+/* ----------------------------------------------------------------------------
+   HexReplyTable::HexReplyTable(void);
+   void HexReplyTable::Clear(void);
+
+   constructor - the table starts (and is cleared to) empty;  it is sized by
+   the first Update()
+   ---------------------------------------------------------------------------- */
+HexReplyTable::HexReplyTable(void)
+{   Clear();    }
+
+void HexReplyTable::Clear(void)
+{
+    cells = 0;
+    clock = 0;
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        reply[t].clear();
+        stamp[t].clear();
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexReplyTable::Reply(HexColor color, unsigned int previous) const;
+
+   Returns color's last good reply to the opponent playing cell previous, or
+   HEXREPLY_NONE if there is none.  The reply may have been played since.
+   ---------------------------------------------------------------------------- */
+unsigned int HexReplyTable::Reply(HexColor color, unsigned int previous) const
+{
+    if (previous >= cells)
+        return HEXREPLY_NONE;
+
+    return reply[replyIndex(color)][previous];
+}
+
+/* ----------------------------------------------------------------------------
+   void HexReplyTable::Update(const std::vector<unsigned int> &moves, unsigned int nCells,
+                              HexColor first, HexColor winner);
+
+   Learns from a playout on a board of nCells cells that played moves in
+   order, alternating colors beginning with first:  every move of winner
+   becomes the reply to the move before it, and every move of the loser
+   that is its current reply to the move before it is forgotten.  A table
+   for a different board size is emptied first.
+   ---------------------------------------------------------------------------- */
+void HexReplyTable::Update(const std::vector<unsigned int> &moves, unsigned int nCells, HexColor first, HexColor winner)
+{
+    if (nCells != cells)
+    {
+        cells = nCells;
+        for (unsigned int t = 0; t < 2; t++)
+        {
+            reply[t].assign(cells, HEXREPLY_NONE);
+            stamp[t].assign(cells, 0);
+        }
+    }
+
+    clock++;
+
+    HexColor color = first;
+    for (unsigned int i = 1; i < moves.size(); i++)
+    {
+        color = ((color == HEXBLUE) ? HEXRED : HEXBLUE);
+
+        unsigned int t = replyIndex(color);
+        unsigned int previous = moves[i - 1];
+
+        if (color == winner)
+        {
+            reply[t][previous] = moves[i];
+            stamp[t][previous] = clock;
+        }
+        else if (reply[t][previous] == moves[i])
+        {
+            reply[t][previous] = HEXREPLY_NONE;
+            stamp[t][previous] = clock;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   static void HexReplyTable::Merge(const std::vector<HexReplyTable *> &tables);
+
+   Gives every table the same entries:  for each color and cell, the one
+   learned (or forgotten) most recently by any table, by the tables' own
+   playout counts, which are then all set to the largest.  Tables for a
+   smaller board than the largest table's are emptied first.  Meant for the
+   tables of threads that ran playouts from the same positions, at about
+   the same rate.
+   ---------------------------------------------------------------------------- */
+void HexReplyTable::Merge(const std::vector<HexReplyTable *> &tables)
+{
+    HexReplyTable *largest = (HexReplyTable *)0;
+    uint32_t latest = 0;
+
+    for (unsigned int i = 0; i < tables.size(); i++)
+    {
+        if ((largest == (HexReplyTable *)0) || (tables[i]->cells > largest->cells))
+            largest = tables[i];
+    }
+
+    if ((largest == (HexReplyTable *)0) || (largest->cells == 0))
+        return;
+
+    for (unsigned int i = 0; i < tables.size(); i++)
+    {
+        HexReplyTable *table = tables[i];
+        if (table->cells != largest->cells)
+        {
+            table->cells = largest->cells;
+            table->clock = 0;
+            for (unsigned int t = 0; t < 2; t++)
+            {
+                table->reply[t].assign(table->cells, HEXREPLY_NONE);
+                table->stamp[t].assign(table->cells, 0);
+            }
+        }
+        latest = std::max(latest, table->clock);
+    }
+
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        for (unsigned int previous = 0; previous < largest->cells; previous++)
+        {
+            const HexReplyTable *best = largest;
+            for (unsigned int i = 0; i < tables.size(); i++)
+            {
+                if (tables[i]->stamp[t][previous] > best->stamp[t][previous])
+                    best = tables[i];
+            }
+
+            unsigned short r = best->reply[t][previous];
+            uint32_t s = best->stamp[t][previous];
+            for (unsigned int i = 0; i < tables.size(); i++)
+            {
+                tables[i]->reply[t][previous] = r;
+                tables[i]->stamp[t][previous] = s;
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < tables.size(); i++)
+        tables[i]->clock = latest;
+}
+
+/* ============================================================================
+   HexBridgePolicy class
+
+   A bridge is a pair of stones that share two empty neighbors (the carrier);
+   the pair is safely connected, since an intrusion on one carrier cell can be
+   answered on the other.  Random playouts ignore this and break bridges half
+   of the time.
+
+   For every cell we precompute the (up to 6) bridges it is a carrier cell of:
+   the other carrier cell plus the two endpoints, where an endpoint may also be
+   the virtual edge of a player (a stone on the second row is bridged to its
+   edge).  After each playout move, checking those entries against the cell
+   colors tells whether the move intruded a bridge, and where to answer.
+   ============================================================================ */
+
+static const int ringRow[6] = {-1, -1, 0, 1,  1,  0};
+static const int ringCol[6] = { 0,  1, 1, 0, -1, -1};
+
+/* ----------------------------------------------------------------------------
+   HexBridgePolicy::HexBridgePolicy(void);
+
+   constructor - bridge tables are built on the first call to Start()
+   ---------------------------------------------------------------------------- */
+HexBridgePolicy::HexBridgePolicy(void)
+{
+    size = 0;
+    useReplies = false;
+    lastFirst = HEXBLUE;
+}
+
+HexRolloutPolicy *HexBridgePolicy::Clone(void) const
+{   return new HexBridgePolicy(*this);  }
+
+/* ----------------------------------------------------------------------------
+   void HexBridgePolicy::Start(HexBoard &board);
+
+   Records the colors of the cells of board, and (re)builds the bridge tables
+   if the board size has changed.
+   ---------------------------------------------------------------------------- */
+void HexBridgePolicy::Start(HexBoard &board)
+{
+    if (board.Size() != size)
+        Reset(board.Size());
+
+    for (unsigned int row = 0, iCell = 0; row < size; row++)
+        for (unsigned int col = 0; col < size; col++, iCell++)
+            start[iCell] = board.GetColor(row, col);
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBridgePolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+
+   Same as the default policy, except that whenever a move lands on a carrier
+   cell of an opponent bridge whose other carrier cell is still open, the
+   opponent's next move is that other carrier cell;  with replies on, any
+   other move is answered by the last good reply to it, if that is open.
+   ---------------------------------------------------------------------------- */
+void HexBridgePolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first)
+{
+    const unsigned int NOREPLY = size * size;
+    unsigned int idMove, moveRow, moveCol;
+
+    // random base order of the open cells
+    mg.Shuffle();
+    sequence.clear();
+    while (mg.Next(idMove, moveRow, moveCol))
+        sequence.push_back(moveRow * size + moveCol);
+
+    for (unsigned int i = 0; i < sequence.size(); i++)
+        position[sequence[i]] = i;
+
+    std::copy(start.begin(), start.end(), state.begin());
+
+    HexColor turn = first;
+    unsigned int reply = NOREPLY;
+    lastFirst = first;
+
+    for (unsigned int i = 0; i < sequence.size(); i++)
+    {
+        // bring the pending reply forward, swapping it with the cell it displaces
+        if ((reply != NOREPLY) && (state[reply] == HEXBLANK))
+        {
+            unsigned int j = position[reply];
+            sequence[j] = sequence[i];
+            position[sequence[j]] = j;
+            sequence[i] = reply;
+            position[reply] = i;
+        }
+
+        unsigned int iCell = sequence[i];
+        HexColor opponent = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+
+        state[iCell] = turn;
+        board.SetColor(iCell / size, iCell % size, turn);
+
+        // look for an opponent bridge this move intruded upon
+        reply = NOREPLY;
+        const HexBridge *b = &bridges[iCell * 6];
+        for (unsigned int k = 0; k < nBridges[iCell]; k++)
+        {
+            if ((state[b[k].partner] == HEXBLANK) &&
+                (state[b[k].end1] == opponent) && (state[b[k].end2] == opponent))
+            {
+                reply = b[k].partner;
+                break;
+            }
+        }
+
+        if ((reply == NOREPLY) && useReplies)
+        {
+            unsigned int good = replies.Reply(opponent, iCell);
+            if ((good != HEXREPLY_NONE) && (state[good] == HEXBLANK))
+                reply = good;
+        }
+
+        turn = opponent;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBridgePolicy::Result(HexColor winner);
+   HexReplyTable *HexBridgePolicy::Replies(void);
+   void HexBridgePolicy::SetReplies(bool on);
+
+   With replies on, each playout's moves (sequence, in the order played)
+   update the reply table, which Replies() exposes;  turning them off or on
+   starts an empty table.
+   ---------------------------------------------------------------------------- */
+void HexBridgePolicy::Result(HexColor winner)
+{
+    if (useReplies)
+        replies.Update(sequence, size * size, lastFirst, winner);
+}
+
+HexReplyTable *HexBridgePolicy::Replies(void)
+{   return (useReplies ? &replies : (HexReplyTable *)0);   }
+
+void HexBridgePolicy::SetReplies(bool on)
+{
+    useReplies = on;
+    replies.Clear();
+}
+
+/* ----------------------------------------------------------------------------
+   void HexBridgePolicy::Reset(unsigned int n);
+
+   Builds the bridge tables for a board of n x n cells.
+   ---------------------------------------------------------------------------- */
+void HexBridgePolicy::Reset(unsigned int n)
+{
+    unsigned int n2 = n * n;
+
+    size = n;
+    BLUEEDGE = n2 + 0;
+    REDEDGE  = n2 + 1;
+
+    bridges.clear();
+    bridges.resize(n2 * 6);
+    nBridges.clear();
+    nBridges.resize(n2, 0);
+
+    // cell colors, followed by the two virtual edges
+    start.clear();
+    start.resize(n2 + 2, HEXBLANK);
+    start[BLUEEDGE] = HEXBLUE;
+    start[REDEDGE]  = HEXRED;
+    state = start;
+
+    sequence.reserve(n2);
+    position.resize(n2);
+
+    for (int r = 0; r < (int) n; r++)
+    {
+        for (int c = 0; c < (int) n; c++)
+        {
+            unsigned int iCell = r * n + c;
+
+            for (unsigned int k = 0; k < 6; k++)
+            {
+                int pr = r + ringRow[k];
+                int pc = c + ringCol[k];
+
+                // the other carrier cell must be on the board
+                if ((pr < 0) || (pr >= (int) n) || (pc < 0) || (pc >= (int) n))
+                    continue;
+
+                // the endpoints are the two cells adjacent to both carrier cells,
+                // which are the ring neighbors on either side of the partner
+                unsigned int ends[2];
+                unsigned int nEdges = 0;
+                for (unsigned int e = 0; e < 2; e++)
+                {
+                    unsigned int slot = ((e == 0) ? (k + 5) : (k + 1)) % 6;
+                    int er = r + ringRow[slot];
+                    int ec = c + ringCol[slot];
+
+                    if ((er < 0) || (er >= (int) n))
+                    {
+                        ends[e] = BLUEEDGE;
+                        nEdges++;
+                    }
+                    else if ((ec < 0) || (ec >= (int) n))
+                    {
+                        ends[e] = REDEDGE;
+                        nEdges++;
+                    }
+                    else
+                        ends[e] = er * n + ec;
+                }
+
+                // an edge cannot be bridged to itself
+                if (nEdges == 2)
+                    continue;
+
+                HexBridge &b = bridges[iCell * 6 + nBridges[iCell]++];
+                b.partner = pr * n + pc;
+                b.end1 = ends[0];
+                b.end2 = ends[1];
+            }
+        }
+    }
+}
+
+/* ============================================================================
+   HexPatternPolicy class
+
+   A Fenwick tree over the cells keeps prefix sums of their weights, so that
+   changing one weight and finding the cell where a running sum crosses a
+   value both take O(log n) steps.  There is one tree per color to move,
+   since the same ring weighs differently for blue and red.  Start() builds
+   the rings and trees of the starting position once, and each playout
+   begins from a copy of them.
+
+   A stone only changes the rings of its (up to 6) neighbors:  to each of
+   them it is the neighbor in the opposite slot.
+
+   As in HexBridgePolicy, an intrusion into a bridge is answered on the
+   other carrier cell, which no ring weight could make certain.  The ring
+   of the intruding stone tells:  an open neighbor flanked, in the slots on
+   either side of it, by two opponent stones (or one and the opponent's
+   edge) is the other carrier cell of a bridge between them.
+   ============================================================================ */
+
+static const char patternMagic[8] = {'H', 'E', 'X', 'P', 'A', 'T', '0', '1'};
+
+static const unsigned int HEXPATTERN_NONE = (unsigned int) -1;
+static const unsigned int HEXPATTERN_DRAWS = 1 << 30;       // resolution of a weighted draw
+
+// 2 bit encoding of a color within a ring code, as in HexPatternEngine
+static inline unsigned int ringBits(HexColor color)
+{
+    if (color == HEXBLUE) return 1;
+    if (color == HEXRED) return 2;
+    return 0;
+}
+
+static inline unsigned int turnIndex(HexColor turn)
+{   return ((turn == HEXBLUE) ? 0 : 1);  }
+
+/* ----------------------------------------------------------------------------
+   HexPatternPolicy::HexPatternPolicy(void);
+
+   constructor - every ring weighs 1 until weights are loaded or set
+   ---------------------------------------------------------------------------- */
+HexPatternPolicy::HexPatternPolicy(void)
+{
+    size = 0;
+    useReplies = false;
+    lastFirst = HEXBLUE;
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        weights[t].assign(HEXRING_CODES, 1.0f);
+        startTotal[t] = total[t] = 0;
+    }
+}
+
+HexRolloutPolicy *HexPatternPolicy::Clone(void) const
+{   return new HexPatternPolicy(*this); }
+
+/* ----------------------------------------------------------------------------
+   bool HexPatternPolicy::Load(const char *filename);
+
+   Reads a weight file.  Returns false (and keeps the current weights) if the
+   file does not exist or is not a valid weight file.
+   ---------------------------------------------------------------------------- */
+bool HexPatternPolicy::Load(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == (FILE *)0)
+        return false;
+
+    HexPatternFileHeader header;
+    std::vector<float> loaded[2];
+    bool ok = ((fread(&header, sizeof(header), 1, f) == 1) &&
+               !memcmp(header.magic, patternMagic, sizeof(patternMagic)) &&
+               (header.rings == HEXRING_CODES));
+
+    for (unsigned int t = 0; ok && (t < 2); t++)
+    {
+        loaded[t].resize(HEXRING_CODES);
+        ok = (fread(&loaded[t][0], sizeof(float), HEXRING_CODES, f) == HEXRING_CODES);
+
+        // weights must be positive (and not NaN), or cells could never be drawn
+        for (unsigned int i = 0; ok && (i < HEXRING_CODES); i++)
+            ok = (loaded[t][i] > 0) && (loaded[t][i] < 1e30f);
+    }
+
+    fclose(f);
+    if (!ok)
+        return false;
+
+    weights[0].swap(loaded[0]);
+    weights[1].swap(loaded[1]);
+    size = 0;                               // rebuild the trees on the next Start()
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::Save(const char *filename);
+
+   Writes the weights out as a weight file.  Throws HEXROLLOUT_ERR_WRITE if
+   the file cannot be written.
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::Save(const char *filename)
+{
+    HexPatternFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, patternMagic, sizeof(patternMagic));
+    header.rings = HEXRING_CODES;
+
+    FILE *f = fopen(filename, "wb");
+    if (f == (FILE *)0)
+        throw HEXROLLOUT_ERR_WRITE;
+
+    bool ok = ((fwrite(&header, sizeof(header), 1, f) == 1) &&
+               (fwrite(&weights[0][0], sizeof(float), HEXRING_CODES, f) == HEXRING_CODES) &&
+               (fwrite(&weights[1][0], sizeof(float), HEXRING_CODES, f) == HEXRING_CODES));
+
+    if ((fclose(f) != 0) || !ok)
+        throw HEXROLLOUT_ERR_WRITE;
+}
+
+/* ----------------------------------------------------------------------------
+   float HexPatternPolicy::Weight(HexColor turn, unsigned int ring) const;
+   void HexPatternPolicy::SetWeight(HexColor turn, unsigned int ring, float w);
+
+   Weight of a cell with the given ring code as a move for turn.  w must be
+   positive;  a change takes effect on the next Start().
+   ---------------------------------------------------------------------------- */
+float HexPatternPolicy::Weight(HexColor turn, unsigned int ring) const
+{   return weights[turnIndex(turn)][ring & (HEXRING_CODES - 1)];   }
+
+void HexPatternPolicy::SetWeight(HexColor turn, unsigned int ring, float w)
+{
+    weights[turnIndex(turn)][ring & (HEXRING_CODES - 1)] = w;
+    size = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::Start(HexBoard &board);
+
+   Records the colors and rings of the cells of board, and builds the trees
+   of the open cells' weights for either color to move.
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::Start(HexBoard &board)
+{
+    if (board.Size() != size)
+        reset(board.Size());
+
+    unsigned int n2 = size * size;
+
+    for (unsigned int row = 0, iCell = 0; row < size; row++)
+        for (unsigned int col = 0; col < size; col++, iCell++)
+            start[iCell] = board.GetColor(row, col);
+
+    for (unsigned int iCell = 0; iCell < n2; iCell++)
+    {
+        unsigned int code = edgeRing[iCell];
+        for (unsigned int k = 0; k < 6; k++)
+        {
+            unsigned int nb = nbrs[iCell * 6 + k];
+            if (nb != HEXPATTERN_NONE)
+                code |= ringBits((HexColor) start[nb]) << (2 * k);
+        }
+        startRing[iCell] = code;
+    }
+
+    // Fenwick trees built in place:  each node adds itself into its parent
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        std::vector<double> &ft = startTree[t];
+        startTotal[t] = 0;
+
+        ft[0] = 0;
+        for (unsigned int iCell = 0; iCell < n2; iCell++)
+        {
+            double w = ((start[iCell] == HEXBLANK) ? weights[t][startRing[iCell]] : 0);
+            startValue[t][iCell] = w;
+            ft[iCell + 1] = w;
+            startTotal[t] += w;
+        }
+
+        for (unsigned int j = 1; j <= n2; j++)
+        {
+            unsigned int parent = j + (j & (0 - j));
+            if (parent <= n2)
+                ft[parent] += ft[j];
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+
+   Fills the open cells of the starting position (those produced by mg),
+   alternating colors beginning with first, each move drawn with probability
+   proportional to the weight of its ring for the color to move, except
+   that an intrusion into a bridge is answered at once, and with replies on
+   any other move by its last good reply, if that is open.
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first)
+{
+    unsigned int n2 = size * size;
+    unsigned int nMoves = mg.Count();
+
+    std::copy(start.begin(), start.end(), state.begin());
+    std::copy(startRing.begin(), startRing.end(), ring.begin());
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        std::copy(startTree[t].begin(), startTree[t].end(), tree[t].begin());
+        std::copy(startValue[t].begin(), startValue[t].end(), value[t].begin());
+        total[t] = startTotal[t];
+    }
+
+    HexColor turn = first;
+    unsigned int reply = HEXPATTERN_NONE;
+
+    lastFirst = first;
+    sequence.clear();
+
+    for (unsigned int i = 0; i < nMoves; i++)
+    {
+        unsigned int iCell = reply;
+
+        if (iCell == HEXPATTERN_NONE)
+        {
+            unsigned int t = turnIndex(turn);
+            double u = total[t] * ((double) HexRandom(HEXPATTERN_DRAWS) / HEXPATTERN_DRAWS);
+            iCell = find(t, u);
+
+            // rounding in the running sums can land past the last open cell
+            if ((iCell >= n2) || (state[iCell] != HEXBLANK))
+                for (iCell = 0; state[iCell] != HEXBLANK; iCell++)
+                    ;
+        }
+
+        play(board, iCell, turn);
+        sequence.push_back(iCell);
+        reply = bridgeReply(iCell, turn);
+        turn = ((turn == HEXBLUE) ? HEXRED : HEXBLUE);
+
+        if ((reply == HEXPATTERN_NONE) && useReplies)
+        {
+            unsigned int good = replies.Reply(turn, iCell);
+            if ((good != HEXREPLY_NONE) && (state[good] == HEXBLANK))
+                reply = good;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::Result(HexColor winner);
+   HexReplyTable *HexPatternPolicy::Replies(void);
+   void HexPatternPolicy::SetReplies(bool on);
+
+   As for HexBridgePolicy
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::Result(HexColor winner)
+{
+    if (useReplies)
+        replies.Update(sequence, size * size, lastFirst, winner);
+}
+
+HexReplyTable *HexPatternPolicy::Replies(void)
+{   return (useReplies ? &replies : (HexReplyTable *)0);   }
+
+void HexPatternPolicy::SetReplies(bool on)
+{
+    useReplies = on;
+    replies.Clear();
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexPatternPolicy::bridgeReply(unsigned int iCell, HexColor color);
+
+   Returns the other carrier cell of the opponent bridge that color's stone
+   on iCell intruded into, or HEXPATTERN_NONE if there is none
+   ---------------------------------------------------------------------------- */
+unsigned int HexPatternPolicy::bridgeReply(unsigned int iCell, HexColor color)
+{
+    unsigned int opponent = ringBits((color == HEXBLUE) ? HEXRED : HEXBLUE);
+    unsigned int code = ring[iCell];
+    unsigned int edges = edgeRing[iCell];
+
+    for (unsigned int k = 0; k < 6; k++)
+    {
+        unsigned int partner = nbrs[iCell * 6 + k];
+        if ((partner == HEXPATTERN_NONE) || (state[partner] != HEXBLANK))
+            continue;
+
+        unsigned int s1 = 2 * ((k + 5) % 6), s2 = 2 * ((k + 1) % 6);
+
+        // both endpoints the opponent's, and not both beyond the edges
+        if ((((code >> s1) & 3) == opponent) && (((code >> s2) & 3) == opponent) &&
+            ((((edges >> s1) & 3) == 0) || (((edges >> s2) & 3) == 0)))
+            return partner;
+    }
+
+    return HEXPATTERN_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::reset(unsigned int n);
+
+   Sizes the tables for a board of n x n cells, and finds the neighbors of
+   each cell in ring slot order, with the ring bits of the neighbors beyond
+   the edges.
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::reset(unsigned int n)
+{
+    unsigned int n2 = n * n;
+
+    size = n;
+    nbrs.assign(n2 * 6, HEXPATTERN_NONE);
+    edgeRing.assign(n2, 0);
+    start.assign(n2, HEXBLANK);
+    state.assign(n2, HEXBLANK);
+    startRing.assign(n2, 0);
+    ring.assign(n2, 0);
+    sequence.reserve(n2);
+
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        startTree[t].assign(n2 + 1, 0);
+        tree[t].assign(n2 + 1, 0);
+        startValue[t].assign(n2, 0);
+        value[t].assign(n2, 0);
+    }
+
+    for (int r = 0; r < (int) n; r++)
+    {
+        for (int c = 0; c < (int) n; c++)
+        {
+            unsigned int iCell = r * n + c;
+
+            for (unsigned int k = 0; k < 6; k++)
+            {
+                int nr = r + ringRow[k];
+                int nc = c + ringCol[k];
+
+                if ((nr < 0) || (nr >= (int) n))
+                    edgeRing[iCell] |= ringBits(HEXBLUE) << (2 * k);    // beyond blue's edges
+                else if ((nc < 0) || (nc >= (int) n))
+                    edgeRing[iCell] |= ringBits(HEXRED) << (2 * k);     // beyond red's edges
+                else
+                    nbrs[iCell * 6 + k] = nr * n + nc;
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::update(unsigned int t, unsigned int iCell, double w);
+
+   Sets the weight of iCell in tree t to w
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::update(unsigned int t, unsigned int iCell, double w)
+{
+    unsigned int n2 = size * size;
+    double delta = w - value[t][iCell];
+
+    value[t][iCell] = w;
+    total[t] += delta;
+    for (unsigned int j = iCell + 1; j <= n2; j += (j & (0 - j)))
+        tree[t][j] += delta;
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexPatternPolicy::find(unsigned int t, double u);
+
+   Returns the first cell whose running sum of weights in tree t exceeds u
+   (size * size if none does), descending the tree from its largest power
+   of two.
+   ---------------------------------------------------------------------------- */
+unsigned int HexPatternPolicy::find(unsigned int t, double u)
+{
+    unsigned int n2 = size * size;
+    unsigned int step = 1;
+    unsigned int pos = 0;
+
+    while ((step << 1) <= n2)
+        step <<= 1;
+
+    for ( ; step > 0; step >>= 1)
+    {
+        if ((pos + step <= n2) && (tree[t][pos + step] <= u))
+        {
+            pos += step;
+            u -= tree[t][pos];
+        }
+    }
+
+    return pos;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexPatternPolicy::play(HexBoard &board, unsigned int iCell, HexColor color);
+
+   Plays color on iCell:  takes the cell out of both trees, and reweighs
+   its open neighbors for their new rings.
+   ---------------------------------------------------------------------------- */
+void HexPatternPolicy::play(HexBoard &board, unsigned int iCell, HexColor color)
+{
+    unsigned int bits = ringBits(color);
+
+    state[iCell] = color;
+    board.SetColor(iCell / size, iCell % size, color);
+    update(0, iCell, 0);
+    update(1, iCell, 0);
+
+    for (unsigned int k = 0; k < 6; k++)
+    {
+        unsigned int nb = nbrs[iCell * 6 + k];
+        if (nb == HEXPATTERN_NONE)
+            continue;
+
+        ring[nb] |= bits << (2 * ((k + 3) % 6));
+        if (state[nb] == HEXBLANK)
+        {
+            update(0, nb, weights[0][ring[nb]]);
+            update(1, nb, weights[1][ring[nb]]);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#ifndef _HEXROLLOUT_H_
+#define _HEXROLLOUT_H_
+
+#include <stdint.h>
+#include <vector>
+#include "hexboard.h"
+#include "hexpattern.h"
+
+/* ============================================================================
+   HexReplyTable class
+
+   Last good replies with forgetting (Baier, Drake):  for each color and
+   each cell the opponent may play, the reply that last followed it in a
+   playout the color won.  A reply that is repeated in a lost playout is
+   forgotten.  Entries are flat per color, indexed by the opponent's cell.
+
+   Every entry carries the table's playout count when it was learned, so
+   that Merge() can keep the most recent of several threads' tables.
+   ============================================================================ */
+const unsigned int HEXREPLY_NONE = 0xFFFF;
+
+class HexReplyTable {
+    public:
+    HexReplyTable(void);
+    void Clear(void);
+    unsigned int Reply(HexColor color, unsigned int previous) const;
+    void Update(const std::vector<unsigned int> &moves, unsigned int nCells, HexColor first, HexColor winner);
+    static void Merge(const std::vector<HexReplyTable *> &tables);
+
+    private:
+    unsigned int cells;                     // cells of the board the entries are for
+    uint32_t clock;                         // playouts learned from
+    std::vector<unsigned short> reply[2];   // per opponent cell, blue and red replies
+    std::vector<uint32_t> stamp[2];         // clock when each reply was learned
+};
+
+/* ============================================================================
+   HexRolloutPolicy class
+
+   Decides the order in which the open cells of a board are filled during a
+   Monte Carlo rollout.  The default policy plays a uniformly random
+   permutation of the open cells.  Policies that learn from the playouts
+   they run are told who won each one (Result), and may expose what they
+   learned as a HexReplyTable, for the caller to merge across threads.
+   ============================================================================ */
+class HexRolloutPolicy {
+    public:
+    virtual ~HexRolloutPolicy(void) {}
+    virtual HexRolloutPolicy *Clone(void) const;
+    virtual void Start(HexBoard &board);
+    virtual void Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+    virtual void Result(HexColor winner);
+    virtual HexReplyTable *Replies(void);
+};
+
+/* ============================================================================
+   HexBridgePolicy class
+
+   Rollout policy that answers an intrusion into a bridge by playing the other
+   carrier cell, and otherwise plays at random.  With replies on, a move
+   that is not a bridge answer is answered by the last good reply to it,
+   if that cell is still open.
+   ============================================================================ */
+typedef struct structHexBridge {
+    unsigned char partner;      // the other carrier cell
+    unsigned char end1;         // bridge endpoints (cells or virtual edges)
+    unsigned char end2;
+} HexBridge;
+
+class HexBridgePolicy : public HexRolloutPolicy {
+    public:
+    HexBridgePolicy(void);
+    virtual HexRolloutPolicy *Clone(void) const;
+    virtual void Start(HexBoard &board);
+    virtual void Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+    virtual void Result(HexColor winner);
+    virtual HexReplyTable *Replies(void);
+    void SetReplies(bool on);
+
+    private:
+    unsigned int size;
+    unsigned int BLUEEDGE, REDEDGE;
+    bool useReplies;
+    HexReplyTable replies;
+    HexColor lastFirst;                     // color that began the last playout
+
+    std::vector<HexBridge> bridges;         // 6 entries per cell, indexed by carrier cell
+    std::vector<unsigned char> nBridges;    // number of valid entries per cell
+    std::vector<unsigned char> start;       // cell colors when Start() was called
+    std::vector<unsigned char> state;       // cell colors during a playout
+    std::vector<unsigned int> sequence;     // order in which cells are played
+    std::vector<unsigned int> position;     // position of each cell within sequence
+
+    void Reset(unsigned int n);
+};
+
+/* ============================================================================
+   HexPatternPolicy class
+
+   Rollout policy that plays each open cell with probability proportional to
+   a weight learned for its ring (the 12 bit code of its 6 neighbors, as in
+   HexPatternEngine::RingCode()), with separate weights for each color to
+   move.  The rings, and so the weights, of the neighbors of each stone
+   played are updated in place, and a move is drawn in O(log n) from a
+   Fenwick tree of the weights of the open cells.  Intrusions into bridges
+   are answered as by HexBridgePolicy, and so are other moves with replies
+   on.  With no weights loaded every ring weighs 1, which plays as
+   HexBridgePolicy does.
+
+   Weight files (Load, Save, hexrecords -patterns) are a
+   HexPatternFileHeader, then float weights[2][HEXRING_CODES]:  blue to
+   move, then red to move, in the byte order of the machine that wrote them.
+   ============================================================================ */
+typedef enum enumHexRolloutError {
+    HEXROLLOUT_ERR_WRITE = 0x600
+} HexRolloutError;
+
+typedef struct structHexPatternFileHeader {
+    char     magic[8];          // "HEXPAT01"
+    uint32_t rings;             // HEXRING_CODES
+    uint32_t reserved;
+} HexPatternFileHeader;
+
+class HexPatternPolicy : public HexRolloutPolicy {
+    public:
+    HexPatternPolicy(void);
+    virtual HexRolloutPolicy *Clone(void) const;
+    virtual void Start(HexBoard &board);
+    virtual void Playout(HexBoard &board, HexMoveGenerator &mg, HexColor first);
+    virtual void Result(HexColor winner);
+    virtual HexReplyTable *Replies(void);
+    void SetReplies(bool on);
+
+    bool Load(const char *filename);
+    void Save(const char *filename);
+    float Weight(HexColor turn, unsigned int ring) const;
+    void SetWeight(HexColor turn, unsigned int ring, float w);
+
+    private:
+    unsigned int size;
+    std::vector<float> weights[2];          // per ring, blue and red to move
+    std::vector<unsigned int> nbrs;         // 6 entries per cell, by ring slot;  NONE off the board
+    std::vector<unsigned char> start;       // cell colors when Start() was called
+    std::vector<unsigned char> state;       // cell colors during a playout
+    std::vector<unsigned short> edgeRing;   // ring bits of the off-board neighbors of each cell
+    std::vector<unsigned short> startRing;  // ring of each cell when Start() was called
+    std::vector<unsigned short> ring;       // same, during a playout
+    std::vector<double> startTree[2];       // Fenwick trees of the open cells' weights, blue and red to move
+    std::vector<double> tree[2];
+    std::vector<double> startValue[2];      // weight of each open cell (0 if occupied)
+    std::vector<double> value[2];
+    double startTotal[2], total[2];
+    bool useReplies;
+    HexReplyTable replies;
+    HexColor lastFirst;
+    std::vector<unsigned int> sequence;     // cells in the order the last playout played them
+
+    void reset(unsigned int n);
+    void update(unsigned int t, unsigned int iCell, double w);
+    unsigned int find(unsigned int t, double u);
+    void play(HexBoard &board, unsigned int iCell, HexColor color);
+    unsigned int bridgeReply(unsigned int iCell, HexColor color);
+};
+
+#endif
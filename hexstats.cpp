@@ -0,0 +1,226 @@
+#include <cstring>
+#include <vector>
+#include <mutex>
+#include "hexstats.h"
+
+/* ============================================================================
+   HexStats class
+
+   Each thread gets its own block of counters the first time it records
+   something.  Blocks are registered in a global list so that Snapshot() can
+   add them all up; when a thread exits, its block is folded into a block of
+   retired totals and unregistered.
+   ============================================================================ */
+
+thread_local HexStatsBlock *HexStats::block = (HexStatsBlock *)0;
+
+static std::mutex registryLock;
+static std::vector<HexStatsBlock *> registry;
+static HexStatsBlock retired;
+
+// add the contents of block from into block to (registryLock must be held)
+static void mergeBlock(HexStatsBlock &to, HexStatsBlock &from)
+{
+    for (unsigned int i = 0; i < HEXSTAT_NCOUNTERS; i++)
+        to.counters[i] += from.counters[i].load(std::memory_order_relaxed);
+
+    for (unsigned int t = 0; t < HEXTIMER_NTIMERS; t++)
+    {
+        to.calls[t] += from.calls[t].load(std::memory_order_relaxed);
+        to.totalNs[t] += from.totalNs[t].load(std::memory_order_relaxed);
+        for (unsigned int b = 0; b < HEXHIST_BUCKETS; b++)
+            to.buckets[t][b] += from.buckets[t][b].load(std::memory_order_relaxed);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   ThreadBlock class
+
+   Owns a thread's block:  registers it when the thread first records
+   something, and retires it when the thread exits.
+   ---------------------------------------------------------------------------- */
+class ThreadBlock {
+    public:
+    ThreadBlock(void)
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        registry.push_back(&data);
+    }
+
+    ~ThreadBlock(void)
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        mergeBlock(retired, data);
+        for (unsigned int i = 0; i < registry.size(); i++)
+        {
+            if (registry[i] == &data)
+            {
+                registry[i] = registry.back();
+                registry.pop_back();
+                break;
+            }
+        }
+    }
+
+    HexStatsBlock data;             // zero initialized, as a thread_local
+};
+
+static thread_local ThreadBlock threadBlockOwner;
+
+/* ----------------------------------------------------------------------------
+   HexStatsBlock *HexStats::registerThread(void);
+
+   Slow path of threadBlock():  creates and registers the calling thread's
+   block.
+   ---------------------------------------------------------------------------- */
+HexStatsBlock *HexStats::registerThread(void)
+{
+    block = &threadBlockOwner.data;
+    return block;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexStats::Snapshot(HexStatsSnapshot &s);
+
+   Returns the totals across all threads, past and present.  Threads keep
+   running while blocks are read, so counters recorded concurrently may or
+   may not be included.
+   ---------------------------------------------------------------------------- */
+void HexStats::Snapshot(HexStatsSnapshot &s)
+{
+    s = HexStatsSnapshot();
+
+    std::lock_guard<std::mutex> guard(registryLock);
+
+    for (unsigned int iBlock = 0; iBlock <= registry.size(); iBlock++)
+    {
+        HexStatsBlock &b = ((iBlock < registry.size()) ? *registry[iBlock] : retired);
+
+        for (unsigned int i = 0; i < HEXSTAT_NCOUNTERS; i++)
+            s.counters[i] += b.counters[i].load(std::memory_order_relaxed);
+
+        for (unsigned int t = 0; t < HEXTIMER_NTIMERS; t++)
+        {
+            s.calls[t] += b.calls[t].load(std::memory_order_relaxed);
+            s.totalNs[t] += b.totalNs[t].load(std::memory_order_relaxed);
+            for (unsigned int k = 0; k < HEXHIST_BUCKETS; k++)
+                s.buckets[t][k] += b.buckets[t][k].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   uint64_t HexStats::BucketValue(unsigned int b);
+
+   Returns the midpoint (in ns) of the range of values counted in bucket b
+   ---------------------------------------------------------------------------- */
+uint64_t HexStats::BucketValue(unsigned int b)
+{
+    if (b < 16)
+        return b;
+
+    unsigned int e = b / 16 + 3;
+    uint64_t low = ((uint64_t) (16 + (b % 16))) << (e - 4);
+    uint64_t width = ((uint64_t) 1) << (e - 4);
+    return low + width / 2;
+}
+
+/* ----------------------------------------------------------------------------
+   const char *HexStats::Name(HexCounter c);
+   const char *HexStats::Name(HexTimer t);
+
+   Short lower case names, used as labels and JSON keys
+   ---------------------------------------------------------------------------- */
+const char *HexStats::Name(HexCounter c)
+{
+    static const char *names[HEXSTAT_NCOUNTERS] = {"rollouts", "candidates", "cutoffs", "book"};
+    return names[c];
+}
+
+const char *HexStats::Name(HexTimer t)
+{
+    static const char *names[HEXTIMER_NTIMERS] = {"move", "evaluate", "playout", "shuffle", "winner"};
+    return names[t];
+}
+
+/* ============================================================================
+   HexStatsSnapshot class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   HexStatsSnapshot::HexStatsSnapshot(void);
+
+   constructor - creates a snapshot with all totals at zero
+   ---------------------------------------------------------------------------- */
+HexStatsSnapshot::HexStatsSnapshot(void)
+{
+    memset(counters, 0, sizeof(counters));
+    memset(calls, 0, sizeof(calls));
+    memset(totalNs, 0, sizeof(totalNs));
+    memset(buckets, 0, sizeof(buckets));
+}
+
+/* ----------------------------------------------------------------------------
+   uint64_t HexStatsSnapshot::Count(HexCounter c);
+   uint64_t HexStatsSnapshot::Calls(HexTimer t);
+   double   HexStatsSnapshot::Seconds(HexTimer t);
+
+   Value of a counter;  number of times a timer was recorded, and their total
+   time in seconds.
+   ---------------------------------------------------------------------------- */
+uint64_t HexStatsSnapshot::Count(HexCounter c)
+{   return counters[c]; }
+
+uint64_t HexStatsSnapshot::Calls(HexTimer t)
+{   return calls[t];    }
+
+double HexStatsSnapshot::Seconds(HexTimer t)
+{   return totalNs[t] * 1e-9;   }
+
+/* ----------------------------------------------------------------------------
+   double HexStatsSnapshot::Percentile(HexTimer t, double p);
+
+   Returns the p-th percentile (0-100) of the times recorded by timer t, in
+   seconds, to the resolution of the histogram (1/16 of a power of 2).
+   Returns 0 if nothing was recorded.
+   ---------------------------------------------------------------------------- */
+double HexStatsSnapshot::Percentile(HexTimer t, double p)
+{
+    if (calls[t] == 0)
+        return 0.0;
+
+    uint64_t rank = (uint64_t) (p / 100.0 * (calls[t] - 1)) + 1;
+    uint64_t seen = 0;
+
+    for (unsigned int b = 0; b < HEXHIST_BUCKETS; b++)
+    {
+        seen += buckets[t][b];
+        if (seen >= rank)
+            return HexStats::BucketValue(b) * 1e-9;
+    }
+
+    return HexStats::BucketValue(HEXHIST_BUCKETS - 1) * 1e-9;
+}
+
+/* ----------------------------------------------------------------------------
+   HexStatsSnapshot HexStatsSnapshot::operator-(const HexStatsSnapshot &s) const;
+
+   Returns the activity recorded between snapshot s and this one
+   ---------------------------------------------------------------------------- */
+HexStatsSnapshot HexStatsSnapshot::operator-(const HexStatsSnapshot &s) const
+{
+    HexStatsSnapshot d;
+
+    for (unsigned int i = 0; i < HEXSTAT_NCOUNTERS; i++)
+        d.counters[i] = counters[i] - s.counters[i];
+
+    for (unsigned int t = 0; t < HEXTIMER_NTIMERS; t++)
+    {
+        d.calls[t] = calls[t] - s.calls[t];
+        d.totalNs[t] = totalNs[t] - s.totalNs[t];
+        for (unsigned int b = 0; b < HEXHIST_BUCKETS; b++)
+            d.buckets[t][b] = buckets[t][b] - s.buckets[t][b];
+    }
+
+    return d;
+}
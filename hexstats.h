@@ -0,0 +1,152 @@
+#ifndef _HEXSTATS_H_
+#define _HEXSTATS_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+typedef enum enumHexCounter {
+    HEXSTAT_ROLLOUTS,           // rollouts played by EvaluateMove
+    HEXSTAT_CANDIDATES,         // candidate moves evaluated
+    HEXSTAT_CUTOFFS,            // candidates abandoned before running all trials
+    HEXSTAT_BOOKMOVES,          // moves answered from an opening book
+    HEXSTAT_NCOUNTERS
+} HexCounter;
+
+typedef enum enumHexTimer {
+    HEXTIMER_MOVE,              // a player's move, as seen by HexGame
+    HEXTIMER_EVALUATE,          // EvaluateMove, one candidate
+    HEXTIMER_PLAYOUT,           // filling the board for one rollout
+    HEXTIMER_SHUFFLE,           // HexMoveGenerator::Shuffle
+    HEXTIMER_WINNER,            // HexBoard::Winner
+    HEXTIMER_NTIMERS
+} HexTimer;
+
+// log-linear histogram:  16 buckets per power of 2, exact below 16ns, up to ~2^47ns
+const unsigned int HEXHIST_BUCKETS = 16 * 45;
+
+/* ============================================================================
+   HexStatsSnapshot class
+
+   Totals of all counters and timers, as returned by HexStats::Snapshot().
+   Subtracting two snapshots gives the activity between them.
+   ============================================================================ */
+class HexStatsSnapshot {
+    public:
+    HexStatsSnapshot(void);
+    uint64_t Count(HexCounter c);
+    uint64_t Calls(HexTimer t);
+    double   Seconds(HexTimer t);
+    double   Percentile(HexTimer t, double p);
+    HexStatsSnapshot operator-(const HexStatsSnapshot &s) const;
+
+    private:
+    uint64_t counters[HEXSTAT_NCOUNTERS];
+    uint64_t calls[HEXTIMER_NTIMERS];
+    uint64_t totalNs[HEXTIMER_NTIMERS];
+    uint64_t buckets[HEXTIMER_NTIMERS][HEXHIST_BUCKETS];
+
+    friend class HexStats;
+};
+
+/* ============================================================================
+   HexStats class
+
+   Process wide engine counters and latency histograms.  Every thread updates
+   its own block without contention; Snapshot() merges all blocks (including
+   those of threads that have exited) when the numbers are read.
+   ============================================================================ */
+typedef struct structHexStatsBlock {
+    std::atomic<uint64_t> counters[HEXSTAT_NCOUNTERS];
+    std::atomic<uint64_t> calls[HEXTIMER_NTIMERS];
+    std::atomic<uint64_t> totalNs[HEXTIMER_NTIMERS];
+    std::atomic<uint64_t> buckets[HEXTIMER_NTIMERS][HEXHIST_BUCKETS];
+} HexStatsBlock;
+
+class HexStats {
+    public:
+    static inline void Add(HexCounter c, uint64_t n);
+    static inline void Record(HexTimer t, uint64_t ns);
+    static inline uint64_t ThreadCount(HexCounter c);
+    static void Snapshot(HexStatsSnapshot &s);
+    static inline unsigned int Bucket(uint64_t ns);
+    static uint64_t BucketValue(unsigned int b);
+    static const char *Name(HexCounter c);
+    static const char *Name(HexTimer t);
+
+    private:
+    static thread_local HexStatsBlock *block;   // this thread's block, once registered
+    static HexStatsBlock *registerThread(void);
+    static inline HexStatsBlock *threadBlock(void);
+    static inline void bump(std::atomic<uint64_t> &x, uint64_t n);
+};
+
+inline HexStatsBlock *HexStats::threadBlock(void)
+{
+    HexStatsBlock *b = block;
+    return ((b != (HexStatsBlock *)0) ? b : registerThread());
+}
+
+// bucket b < 16 holds b ns;  above that, 16 buckets split each power of 2 evenly
+inline unsigned int HexStats::Bucket(uint64_t ns)
+{
+    if (ns < 16)
+        return (unsigned int) ns;
+
+    unsigned int e = 63 - __builtin_clzll(ns);          // position of leading bit, >= 4
+    unsigned int b = (e - 3) * 16 + ((ns >> (e - 4)) & 15);
+    return ((b < HEXHIST_BUCKETS) ? b : (HEXHIST_BUCKETS - 1));
+}
+
+// single writer per block: a relaxed load and store is enough, and avoids a locked add
+inline void HexStats::bump(std::atomic<uint64_t> &x, uint64_t n)
+{   x.store(x.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);   }
+
+inline void HexStats::Add(HexCounter c, uint64_t n)
+{   bump(threadBlock()->counters[c], n);    }
+
+// value of a counter as recorded by the calling thread alone
+inline uint64_t HexStats::ThreadCount(HexCounter c)
+{   return threadBlock()->counters[c].load(std::memory_order_relaxed);  }
+
+inline void HexStats::Record(HexTimer t, uint64_t ns)
+{
+    HexStatsBlock *b = threadBlock();
+    bump(b->calls[t], 1);
+    bump(b->totalNs[t], ns);
+    bump(b->buckets[t][Bucket(ns)], 1);
+}
+
+/* ============================================================================
+   HexScopedTimer class
+
+   Records the time between its construction and destruction under a timer.
+   ============================================================================ */
+class HexScopedTimer {
+    public:
+    HexScopedTimer(HexTimer t) : timer(t), start(std::chrono::steady_clock::now()) {}
+    ~HexScopedTimer(void)
+    {
+        HexStats::Record(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start).count());
+    }
+
+    private:
+    HexTimer timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Counters are always on.  Timers on the search hot path cost a clock read on
+// each side, so they are compiled out of release (NDEBUG) builds unless
+// HEXSTATS_TIMERS is defined.
+#define HEXSTATS_COUNT(c, n) HexStats::Add((c), (n))
+
+#if defined(NDEBUG) && !defined(HEXSTATS_TIMERS)
+#define HEXSTATS_TIMER(t)
+#else
+#define HEXSTATS_CONCAT2(a, b) a##b
+#define HEXSTATS_CONCAT(a, b) HEXSTATS_CONCAT2(a, b)
+#define HEXSTATS_TIMER(t) HexScopedTimer HEXSTATS_CONCAT(hexScopedTimer, __LINE__)(t)
+#endif
+
+#endif
@@ -0,0 +1,504 @@
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "hexthreadpool.h"
+#include "hextrace.h"
+
+/* ============================================================================
+   HexWorkDeque class
+
+   Chase and Lev, "Dynamic Circular Work-Stealing Deque" (SPAA 2005), in the
+   C11 formulation of Le et al. (PPoPP 2013).  top and bottom only grow;  a
+   task lives in cell index & mask of the current array.  The owner and the
+   thieves race for the last task through a CAS on top.
+   ============================================================================ */
+const int64_t HEXDEQUE_INITIALSIZE = 64;
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexWorkDeque(void)                  -- an empty deque
+    ~HexWorkDeque(void)                 -- frees the arrays;  tasks still in
+                                           the deque are not freed
+   ---------------------------------------------------------------------------- */
+HexWorkDeque::HexWorkDeque(void) : top(0), bottom(0)
+{
+    HexWorkArray *a = new HexWorkArray;
+    a->mask = HEXDEQUE_INITIALSIZE - 1;
+    a->cells = new std::atomic<HexTask *>[HEXDEQUE_INITIALSIZE];
+    array.store(a, std::memory_order_relaxed);
+}
+
+HexWorkDeque::~HexWorkDeque(void)
+{
+    retired.push_back(array.load(std::memory_order_relaxed));
+
+    for (unsigned int i = 0; i < retired.size(); i++)
+    {
+        delete [] retired[i]->cells;
+        delete retired[i];
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexWorkDeque::Push(HexTask *task);
+
+   Owner only:  adds a task at the bottom, growing the array if it is full.
+   ---------------------------------------------------------------------------- */
+void HexWorkDeque::Push(HexTask *task)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    HexWorkArray *a = array.load(std::memory_order_relaxed);
+
+    if (b - t > a->mask)
+        a = grow(a, t, b);
+
+    a->cells[b & a->mask].store(task, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+}
+
+/* ----------------------------------------------------------------------------
+   HexTask *HexWorkDeque::Take(void);
+
+   Owner only:  removes the newest task, or returns a null pointer if the
+   deque is empty (or a thief won the last task).
+   ---------------------------------------------------------------------------- */
+HexTask *HexWorkDeque::Take(void)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    HexWorkArray *a = array.load(std::memory_order_relaxed);
+
+    // the store to bottom must be visible before top is read (seq_cst), so
+    // that a thief and the owner cannot both take the last task
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return (HexTask *)0;
+    }
+
+    HexTask *task = a->cells[b & a->mask].load(std::memory_order_relaxed);
+
+    if (t == b)
+    {
+        // last task:  race the thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = (HexTask *)0;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return task;
+}
+
+/* ----------------------------------------------------------------------------
+   HexTask *HexWorkDeque::Steal(void);
+
+   Any thread:  removes the oldest task, or returns a null pointer if the
+   deque is empty or another thread got there first.
+   ---------------------------------------------------------------------------- */
+HexTask *HexWorkDeque::Steal(void)
+{
+    int64_t t = top.load(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_seq_cst);
+
+    if (t >= b)
+        return (HexTask *)0;
+
+    HexWorkArray *a = array.load(std::memory_order_acquire);
+    HexTask *task = a->cells[t & a->mask].load(std::memory_order_relaxed);
+
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return (HexTask *)0;
+
+    return task;
+}
+
+// owner only:  copies the tasks from t to b into an array twice as large
+HexWorkDeque::HexWorkArray *HexWorkDeque::grow(HexWorkArray *a, int64_t t, int64_t b)
+{
+    HexWorkArray *larger = new HexWorkArray;
+    larger->mask = 2 * (a->mask + 1) - 1;
+    larger->cells = new std::atomic<HexTask *>[larger->mask + 1];
+
+    for (int64_t i = t; i < b; i++)
+        larger->cells[i & larger->mask].store(a->cells[i & a->mask].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    retired.push_back(a);
+    array.store(larger, std::memory_order_release);
+    return larger;
+}
+
+/* ============================================================================
+   HexThreadPool class
+
+   Runs tasks on a fixed set of worker threads, so that parallel features do
+   not each create and tear down their own threads.
+
+   Idle workers look for work in their own deque, then the shared queue, then
+   the deques of the others, starting at a random victim.  When there is none
+   (queued is 0) they sleep;  Submit() wakes one if any sleep.  Both sides
+   update their own counter before reading the other's (seq_cst), so either
+   the worker sees the new task or the submitter sees the sleeper.
+   ============================================================================ */
+
+// the pool and worker index of the calling thread, if it is a worker
+static thread_local HexThreadPool *currentPool = (HexThreadPool *)0;
+static thread_local int currentWorker = -1;
+
+// failed searches before an idle worker goes to sleep
+const unsigned int HEXPOOL_SPINS = 64;
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexThreadPool(unsigned int nThreads=0, bool pin=false)
+                                            -- starts nThreads workers, or one
+                                               per core if nThreads is 0;  with
+                                               pin, worker i is bound to core
+                                               i (Linux only)
+    ~HexThreadPool(void)                    -- waits for submitted tasks to
+                                               finish, then stops the workers
+   ---------------------------------------------------------------------------- */
+HexThreadPool::HexThreadPool(unsigned int nThreads, bool pin) : queued(0), pending(0), sleeping(0)
+{
+    if (nThreads == 0)
+        nThreads = std::thread::hardware_concurrency();
+    if (nThreads == 0)
+        nThreads = 1;
+
+    stopping = false;
+
+    // all deques exist before any worker may steal from them
+    for (unsigned int i = 0; i < nThreads; i++)
+        deques.push_back(new HexWorkDeque);
+
+    for (unsigned int i = 0; i < nThreads; i++)
+        workers.push_back(std::thread(&HexThreadPool::worker, this, i, pin));
+}
+
+HexThreadPool::~HexThreadPool(void)
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+        taskAvailable.notify_all();
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    for (unsigned int i = 0; i < deques.size(); i++)
+        delete deques[i];
+}
+
+/* ----------------------------------------------------------------------------
+   void HexThreadPool::Submit(HexTask task);
+
+   Queues a task to be run by one of the workers:  on the calling worker's
+   own deque if it is one of this pool's workers, else on the shared queue.
+   ---------------------------------------------------------------------------- */
+void HexThreadPool::Submit(HexTask task)
+{
+    HexTask *t = new HexTask(task);
+
+    pending.fetch_add(1);
+
+    if (currentPool == this)
+    {
+        queued.fetch_add(1);
+        deques[currentWorker]->Push(t);
+
+        if (sleeping.load() > 0)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            taskAvailable.notify_one();
+        }
+        return;
+    }
+
+    // notify under the lock:  tasks may be submitted from another pool's
+    // threads, and the task may run and this pool be destroyed as soon as
+    // the lock is released
+    std::lock_guard<std::mutex> guard(lock);
+    queued.fetch_add(1);
+    injected.push_back(t);
+    if (sleeping.load() > 0)
+        taskAvailable.notify_one();
+}
+
+/* ----------------------------------------------------------------------------
+   void HexThreadPool::Wait(void);
+
+   Blocks until every task submitted so far has finished running.  Not to be
+   called from a task;  use a HexTaskGroup there.
+   ---------------------------------------------------------------------------- */
+void HexThreadPool::Wait(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (pending.load() > 0)
+        allDone.wait(guard);
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int HexThreadPool::Size(void);
+   unsigned int HexThreadPool::Slots(void);
+
+   Return the number of worker threads, and the number of distinct slot
+   values ParallelFor may pass (the workers plus the calling thread)
+   ---------------------------------------------------------------------------- */
+unsigned int HexThreadPool::Size(void)
+{   return workers.size();  }
+
+unsigned int HexThreadPool::Slots(void)
+{   return workers.size() + 1;  }
+
+/* ----------------------------------------------------------------------------
+   void HexThreadPool::ParallelFor(unsigned int n, HexForBody body, HexCancelToken *cancel=0);
+
+   Calls body(i, slot) for every i in [0, n), spread over the workers and the
+   calling thread, and returns when all calls have finished.  Indices are
+   handed out one at a time in increasing order, so that earlier indices
+   tend to start first.  No two concurrent calls get the same slot, which is
+   below Slots();  bodies can use it to pick per-thread scratch state.  Once
+   cancel is cancelled, no more indices are started.
+   ---------------------------------------------------------------------------- */
+void HexThreadPool::ParallelFor(unsigned int n, HexForBody body, HexCancelToken *cancel)
+{
+    if (n == 0)
+        return;
+
+    std::atomic<unsigned int> next(0);
+    unsigned int nRunners = std::min(n, Slots());
+
+    // each runner claims indices until there are none left
+    std::function<void(unsigned int)> runner = [&](unsigned int slot) {
+        while ((cancel == (HexCancelToken *)0) || !cancel->Cancelled())
+        {
+            unsigned int i = next.fetch_add(1);
+            if (i >= n)
+                return;
+            body(i, slot);
+        }
+    };
+
+    HexTaskGroup group(*this, cancel);
+    for (unsigned int slot = 1; slot < nRunners; slot++)
+        group.Run(std::bind(runner, slot));
+
+    runner(0);
+    group.Wait();
+}
+
+/* ----------------------------------------------------------------------------
+   HexThreadPool &HexThreadPool::Shared(void);
+
+   Returns the process-wide pool, one worker per core, created on first use.
+   Parallel features use it unless given a pool of their own.
+   ---------------------------------------------------------------------------- */
+HexThreadPool &HexThreadPool::Shared(void)
+{
+    static HexThreadPool pool;
+    return pool;
+}
+
+/* ----------------------------------------------------------------------------
+   void HexThreadPool::worker(unsigned int index, bool pin);
+
+   Worker thread body:  runs tasks until the pool is destroyed.
+   ---------------------------------------------------------------------------- */
+void HexThreadPool::worker(unsigned int index, bool pin)
+{
+    currentPool = this;
+    currentWorker = index;
+    HexTrace::ThreadName("pool worker");
+
+#ifdef __linux__
+    if (pin)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#endif
+
+    uint64_t rng = 0x9E3779B97F4A7C15ull * (index + 1);
+    unsigned int spins = 0;
+
+    while (true)
+    {
+        HexTask *task = find(index, rng);
+        if (task != (HexTask *)0)
+        {
+            run(task);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < HEXPOOL_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        spins = 0;
+
+        std::unique_lock<std::mutex> guard(lock);
+        sleeping.fetch_add(1);
+        while ((queued.load() == 0) && !stopping)
+            taskAvailable.wait(guard);
+        sleeping.fetch_sub(1);
+
+        if (stopping && (queued.load() == 0))
+            return;                 // stopping, and nothing left to run
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   HexTask *HexThreadPool::find(int self, uint64_t &rng);
+
+   Takes a task for worker self (-1 for a thread outside the pool):  from its
+   own deque, else the shared queue, else stolen from another worker.
+   Returns a null pointer if none was found.
+   ---------------------------------------------------------------------------- */
+HexTask *HexThreadPool::find(int self, uint64_t &rng)
+{
+    HexTask *task;
+
+    if (self >= 0)
+    {
+        task = deques[self]->Take();
+        if (task != (HexTask *)0)
+        {
+            queued.fetch_sub(1);
+            return task;
+        }
+    }
+
+    if (queued.load() == 0)
+        return (HexTask *)0;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!injected.empty())
+        {
+            task = injected.front();
+            injected.pop_front();
+            queued.fetch_sub(1);
+            return task;
+        }
+    }
+
+    // xorshift for the first victim, so that thieves spread out
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+
+    unsigned int n = deques.size();
+    unsigned int first = (rng * 0x2545F4914F6CDD1Dull) >> 32;
+
+    for (unsigned int k = 0; k < n; k++)
+    {
+        unsigned int victim = (first + k) % n;
+        if ((int) victim == self)
+            continue;
+
+        task = deques[victim]->Steal();
+        if (task != (HexTask *)0)
+        {
+            queued.fetch_sub(1);
+            return task;
+        }
+    }
+
+    return (HexTask *)0;
+}
+
+// run a task taken from a queue, and account for its completion
+void HexThreadPool::run(HexTask *task)
+{
+    {
+        HEXTRACE_SCOPE("task");
+        (*task)();
+    }
+    delete task;
+
+    if (pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        allDone.notify_all();
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexThreadPool::helpWhile(std::atomic<unsigned int> &count);
+
+   Runs the pool's tasks on the calling thread until count drops to 0.  A
+   worker of this pool takes its own tasks first, which are those of the
+   innermost group it is waiting for.
+   ---------------------------------------------------------------------------- */
+void HexThreadPool::helpWhile(std::atomic<unsigned int> &count)
+{
+    int self = ((currentPool == this) ? currentWorker : -1);
+    uint64_t rng = 0x9E3779B97F4A7C15ull ^ (uint64_t) (uintptr_t) &count;
+
+    while (count.load(std::memory_order_acquire) > 0)
+    {
+        HexTask *task = find(self, rng);
+        if (task != (HexTask *)0)
+            run(task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+/* ============================================================================
+   HexTaskGroup class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    HexTaskGroup(HexThreadPool &p, HexCancelToken *c=0)
+                                        -- an empty group of tasks on p
+    ~HexTaskGroup(void)                 -- waits for the group's tasks
+   ---------------------------------------------------------------------------- */
+HexTaskGroup::HexTaskGroup(HexThreadPool &p, HexCancelToken *c) : pool(p), cancel(c), count(0)
+{
+}
+
+HexTaskGroup::~HexTaskGroup(void)
+{
+    Wait();
+}
+
+/* ----------------------------------------------------------------------------
+   void HexTaskGroup::Run(HexTask task);
+
+   Submits a task as part of the group.
+   ---------------------------------------------------------------------------- */
+void HexTaskGroup::Run(HexTask task)
+{
+    count.fetch_add(1);
+
+    // the group may be gone as soon as count drops, so that is the last access
+    pool.Submit([this, task]() {
+        if ((cancel == (HexCancelToken *)0) || !cancel->Cancelled())
+            task();
+        count.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+/* ----------------------------------------------------------------------------
+   void HexTaskGroup::Wait(void);
+
+   Returns when every task of the group has finished (or been skipped),
+   running other tasks of the pool meanwhile.
+   ---------------------------------------------------------------------------- */
+void HexTaskGroup::Wait(void)
+{
+    pool.helpWhile(count);
+}
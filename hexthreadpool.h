@@ -0,0 +1,138 @@
+#ifndef _HEXTHREADPOOL_H_
+#define _HEXTHREADPOOL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+typedef std::function<void()> HexTask;
+
+/* ============================================================================
+   HexCancelToken class
+
+   A flag shared by the tasks of one job:  once cancelled, ParallelFor and
+   HexTaskGroup start no more of its tasks, and long tasks may poll it to
+   stop early.  Tasks already running are not interrupted.
+   ============================================================================ */
+class HexCancelToken {
+    public:
+    HexCancelToken(void) : cancelled(false) {}
+    void Cancel(void)           { cancelled.store(true, std::memory_order_release); }
+    bool Cancelled(void) const  { return cancelled.load(std::memory_order_acquire); }
+
+    private:
+    std::atomic<bool> cancelled;
+};
+
+/* ============================================================================
+   HexWorkDeque class
+
+   Chase-Lev work-stealing deque of tasks.  Only its owner pushes and takes,
+   at the bottom, in LIFO order;  any thread may steal from the top.  The
+   array grows when full;  arrays it outgrew are kept until the deque is
+   destroyed, since a thief may still be reading one.
+   ============================================================================ */
+class HexWorkDeque {
+    public:
+    HexWorkDeque(void);
+    ~HexWorkDeque(void);
+    void Push(HexTask *task);
+    HexTask *Take(void);
+    HexTask *Steal(void);
+
+    private:
+    typedef struct structHexWorkArray {
+        int64_t mask;                           // capacity - 1, capacity a power of 2
+        std::atomic<HexTask *> *cells;
+    } HexWorkArray;
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<HexWorkArray *> array;
+    std::vector<HexWorkArray *> retired;
+
+    HexWorkArray *grow(HexWorkArray *a, int64_t t, int64_t b);
+
+    // no copies, the arrays are owned by a single object
+    HexWorkDeque(const HexWorkDeque &);
+    HexWorkDeque &operator=(const HexWorkDeque &);
+};
+
+/* ============================================================================
+   HexThreadPool class
+
+   A fixed set of worker threads with work stealing:  each worker keeps the
+   tasks it submits in its own deque and runs them newest first, and idle
+   workers steal the oldest tasks of others.  Tasks submitted from outside
+   the pool go through a shared queue.  Threads waiting on a ParallelFor or
+   a HexTaskGroup run pending tasks meanwhile, so these may be nested inside
+   pool tasks without tying up workers.
+   ============================================================================ */
+typedef std::function<void(unsigned int i, unsigned int slot)> HexForBody;
+
+class HexThreadPool {
+    public:
+    HexThreadPool(unsigned int nThreads=0, bool pin=false);    // 0: one thread per core
+    ~HexThreadPool(void);
+    void Submit(HexTask task);
+    void Wait(void);
+    unsigned int Size(void);
+    unsigned int Slots(void);
+    void ParallelFor(unsigned int n, HexForBody body, HexCancelToken *cancel=(HexCancelToken *)0);
+    static HexThreadPool &Shared(void);
+
+    private:
+    std::vector<std::thread> workers;
+    std::vector<HexWorkDeque *> deques;         // one per worker
+    std::deque<HexTask *> injected;             // tasks submitted from outside the pool
+    std::mutex lock;                            // guards injected, and sleeping workers
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    std::atomic<unsigned long> queued;          // tasks in any queue, not yet picked up
+    std::atomic<unsigned long> pending;         // tasks submitted but not yet finished
+    std::atomic<unsigned int> sleeping;         // workers blocked on taskAvailable
+    bool stopping;
+
+    void worker(unsigned int index, bool pin);
+    HexTask *find(int self, uint64_t &rng);
+    void run(HexTask *task);
+    void helpWhile(std::atomic<unsigned int> &count);
+
+    friend class HexTaskGroup;
+
+    // no copies, the pool owns its threads
+    HexThreadPool(const HexThreadPool &);
+    HexThreadPool &operator=(const HexThreadPool &);
+};
+
+/* ============================================================================
+   HexTaskGroup class
+
+   A set of tasks on a pool that can be waited for together, without waiting
+   for the rest of the pool's work.  Wait() runs pending tasks of the pool
+   while the group is unfinished.  With a cancel token, tasks of the group
+   that have not started when it is cancelled are skipped.
+   ============================================================================ */
+class HexTaskGroup {
+    public:
+    HexTaskGroup(HexThreadPool &p, HexCancelToken *c=(HexCancelToken *)0);
+    ~HexTaskGroup(void);
+    void Run(HexTask task);
+    void Wait(void);
+
+    private:
+    HexThreadPool &pool;
+    HexCancelToken *cancel;
+    std::atomic<unsigned int> count;            // tasks run but not yet finished
+
+    // no copies, tasks refer to the group
+    HexTaskGroup(const HexTaskGroup &);
+    HexTaskGroup &operator=(const HexTaskGroup &);
+};
+
+#endif
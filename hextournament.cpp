@@ -0,0 +1,483 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <time.h>
+#include <mutex>
+#include "hexboard.h"
+#include "hexbook.h"
+#include "hexnet.h"
+#include "hexthreadpool.h"
+#include "hexasync.h"
+#include "hextrace.h"
+#include "hexengines.hpp"
+
+/* ============================================================================
+   hextournament
+
+   Plays many games between two engines concurrently, and decides which
+   engine is stronger.
+
+   usage:  hextournament [options] <engineA> <engineB>
+
+   options:
+    -size n         board size (default 7)
+    -games n        maximum number of games (default 1000)
+    -threads n      compute threads running the engines (default: one per core)
+    -concurrent n   games in play at once (default: twice the compute threads)
+    -elo0 x         SPRT null hypothesis, elo(A) - elo(B) = x (default 0)
+    -elo1 x         SPRT alternative hypothesis (default 50)
+    -alpha x        SPRT false positive rate (default 0.05)
+    -beta x         SPRT false negative rate (default 0.05)
+    -book file      opening book for the engines that use one
+    -net file       policy network for the engines that use one (hexnet.h)
+    -patterns file  rollout pattern weights for mcp (hexrecords -patterns)
+    -trace file     write a Chrome trace of the whole run (chrome://tracing)
+    -record file    append a record of every game to file (see hexrecord.h)
+
+   Engines are given as in CreateEngine(), e.g. mc, mc:200, mcp:200, mcr, mc2,
+   ab:0.5, random.
+   Engine A plays blue (moving first) in even games and red in odd games.
+   One line is printed per finished game; play stops early once the SPRT
+   accepts either hypothesis.
+
+   Games are driven by a HexGameScheduler on a single game thread;  only the
+   engines' moves run on the compute threads, so many more games than threads
+   can be in play without one thread per game.
+   ============================================================================ */
+
+typedef struct structTournamentOptions {
+    unsigned int size;
+    unsigned int games;
+    unsigned int threads;
+    unsigned int concurrent;
+    double elo0, elo1;
+    double alpha, beta;
+    const char *book;
+    const char *net;
+    const HexNet *network;              // loaded from net, if given
+    const char *patterns;
+    const HexPatternPolicy *weights;    // loaded from patterns, if given
+    const char *trace;
+    const char *record;
+    const char *engine[2];
+} TournamentOptions;
+
+typedef struct structTournamentResults {
+    unsigned int started;               // games handed to the scheduler
+    unsigned int games;                 // games finished
+    unsigned int wins;                  // games won by engine A
+    unsigned int blueGames, blueWins;   // games (and wins) with engine A as blue
+    double seconds[2];                  // CPU seconds spent in each engine's moves
+    bool stop;                          // SPRT reached a decision
+    const char *decision;
+} TournamentResults;
+
+static std::mutex resultsLock;
+
+/* ----------------------------------------------------------------------------
+   static double threadSeconds(void);
+
+   Returns the CPU time consumed so far by the calling thread
+   ---------------------------------------------------------------------------- */
+static double threadSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ============================================================================
+   TimedPlayer class
+
+   Forwards moves to an engine, accumulating the CPU time they take.
+   ============================================================================ */
+class TimedPlayer : public HexPlayer {
+    public:
+    TimedPlayer(HexPlayer *p, const char *spec) : engine(p), name(spec), seconds(0) {}
+    virtual ~TimedPlayer(void) { delete engine; }
+    virtual const char *Name(void) { return name; }
+    virtual void Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col);
+    virtual bool LastMoveWork(HexMoveWork &work) { return engine->LastMoveWork(work); }
+    double Seconds(void) { return seconds; }
+
+    private:
+    HexPlayer *engine;
+    const char *name;           // engine spec, as given on the command line
+    double seconds;
+};
+
+void TimedPlayer::Move(HexBoard &board, HexColor turn, unsigned int &row, unsigned int &col)
+{
+    double t0 = threadSeconds();
+    engine->Move(board, turn, row, col);
+    seconds += threadSeconds() - t0;
+}
+
+/* ----------------------------------------------------------------------------
+   static double eloToScore(double elo);
+   static double scoreToElo(double score);
+
+   Convert between an Elo difference and the expected score (win probability)
+   ---------------------------------------------------------------------------- */
+static double eloToScore(double elo)
+{   return 1.0 / (1.0 + pow(10.0, -elo / 400.0));   }
+
+static double scoreToElo(double score)
+{
+    if (score <= 0.0) return -INFINITY;
+    if (score >= 1.0) return INFINITY;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+/* ----------------------------------------------------------------------------
+   static double llr(TournamentOptions &opt, TournamentResults &res);
+
+   Log-likelihood ratio of the SPRT for the results so far.  Hex has no draws,
+   so each game is a Bernoulli trial with win probability p0 under H0, p1
+   under H1.
+   ---------------------------------------------------------------------------- */
+static double llr(TournamentOptions &opt, TournamentResults &res)
+{
+    double p0 = eloToScore(opt.elo0);
+    double p1 = eloToScore(opt.elo1);
+    unsigned int losses = res.games - res.wins;
+
+    return res.wins * log(p1 / p0) + losses * log((1.0 - p1) / (1.0 - p0));
+}
+
+/* ----------------------------------------------------------------------------
+   static void wilson(unsigned int wins, unsigned int n, double &lo, double &hi);
+
+   95% Wilson score interval for a win rate
+   ---------------------------------------------------------------------------- */
+static void wilson(unsigned int wins, unsigned int n, double &lo, double &hi)
+{
+    const double z = 1.96;
+
+    if (n == 0)
+    {
+        lo = 0.0;
+        hi = 1.0;
+        return;
+    }
+
+    double p = ((double) wins) / n;
+    double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double half = (z / (1 + z * z / n)) * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n));
+
+    lo = center - half;
+    hi = center + half;
+}
+
+/* ============================================================================
+   TournamentGame class
+
+   One game in flight:  both engines, their compute pool wrappers and the
+   game itself.  Deleted once the game is finished.
+   ============================================================================ */
+class TournamentGame {
+    public:
+    TournamentGame(unsigned int i, TournamentOptions &opt, HexThreadPool &compute, HexBook *book);
+
+    unsigned int iGame;
+    unsigned int blue;                  // 0 if engine A is blue
+    TimedPlayer a, b;
+    HexComputePlayer asyncA, asyncB;
+    HexAsyncGame game;
+};
+
+// engine A is blue in even games
+TournamentGame::TournamentGame(unsigned int i, TournamentOptions &opt, HexThreadPool &compute, HexBook *book) :
+    iGame(i), blue(i % 2),
+    a(CreateEngine(opt.engine[0], book, opt.network, opt.weights), opt.engine[0]),
+    b(CreateEngine(opt.engine[1], book, opt.network, opt.weights), opt.engine[1]),
+    asyncA(&a, compute), asyncB(&b, compute),
+    game(opt.size, ((blue == 0) ? &asyncA : &asyncB), ((blue == 0) ? &asyncB : &asyncA), HEXBLUE)
+{
+    if (opt.record != (const char *)0)
+        game.SetRecord(opt.record);
+}
+
+static void startGame(TournamentOptions &opt, TournamentResults &res, HexBook *book,
+                      HexThreadPool &compute, HexGameScheduler &scheduler);
+
+/* ----------------------------------------------------------------------------
+   static void gameFinished(HexAsyncGame &game, TournamentGame *t, TournamentOptions &opt,
+                            TournamentResults &res, HexBook *book,
+                            HexThreadPool &compute, HexGameScheduler &scheduler);
+
+   Records and prints the result of a finished game, checks whether the SPRT
+   has reached a decision, and if not starts the next game in its place.
+   ---------------------------------------------------------------------------- */
+static void gameFinished(HexAsyncGame &game, TournamentGame *t, TournamentOptions &opt, TournamentResults &res,
+                         HexBook *book, HexThreadPool &compute, HexGameScheduler &scheduler)
+{
+    bool aWon = ((game.Winner() == HEXBLUE) == (t->blue == 0));
+    bool next = false;
+
+    {
+        std::lock_guard<std::mutex> guard(resultsLock);
+
+        if (!res.stop)                  // else decided while this game was running
+        {
+            res.games++;
+            if (aWon) res.wins++;
+            if (t->blue == 0)
+            {
+                res.blueGames++;
+                if (aWon) res.blueWins++;
+            }
+            res.seconds[0] += t->a.Seconds();
+            res.seconds[1] += t->b.Seconds();
+
+            double ratio = llr(opt, res);
+            double lower = log(opt.beta / (1.0 - opt.alpha));
+            double upper = log((1.0 - opt.beta) / opt.alpha);
+
+            std::cout << "game " << t->iGame
+                      << " blue=" << opt.engine[t->blue] << " red=" << opt.engine[1 - t->blue]
+                      << " winner=" << (aWon ? opt.engine[0] : opt.engine[1])
+                      << std::fixed << std::setprecision(3)
+                      << " cpu=" << t->a.Seconds() << "/" << t->b.Seconds()
+                      << " score=" << res.wins << "/" << res.games
+                      << " llr=" << std::setprecision(2) << ratio << "\n" << std::flush;
+
+            if (ratio >= upper)
+            {
+                res.stop = true;
+                res.decision = "H1 accepted (A is stronger by at least elo1)";
+            }
+            else if (ratio <= lower)
+            {
+                res.stop = true;
+                res.decision = "H0 accepted (A is not stronger by more than elo0)";
+            }
+        }
+
+        next = (!res.stop && (res.started < opt.games));
+    }
+
+    delete t;
+
+    if (next)
+        startGame(opt, res, book, compute, scheduler);
+}
+
+/* ----------------------------------------------------------------------------
+   static void startGame(TournamentOptions &opt, TournamentResults &res, HexBook *book,
+                         HexThreadPool &compute, HexGameScheduler &scheduler);
+
+   Hands the next game to the scheduler
+   ---------------------------------------------------------------------------- */
+static void startGame(TournamentOptions &opt, TournamentResults &res, HexBook *book,
+                      HexThreadPool &compute, HexGameScheduler &scheduler)
+{
+    unsigned int iGame;
+
+    {
+        std::lock_guard<std::mutex> guard(resultsLock);
+        iGame = res.started++;
+    }
+
+    TournamentGame *t = new TournamentGame(iGame, opt, compute, book);
+    scheduler.Add(&t->game, std::bind(gameFinished, std::placeholders::_1, t, std::ref(opt), std::ref(res),
+                                      book, std::ref(compute), std::ref(scheduler)));
+}
+
+/* ----------------------------------------------------------------------------
+   static void report(TournamentOptions &opt, TournamentResults &res);
+
+   Prints the summary of the tournament
+   ---------------------------------------------------------------------------- */
+static void report(TournamentOptions &opt, TournamentResults &res)
+{
+    double lo, hi, blueLo, blueHi, redLo, redHi;
+    unsigned int redGames = res.games - res.blueGames;
+    unsigned int redWins = res.wins - res.blueWins;
+
+    wilson(res.wins, res.games, lo, hi);
+    wilson(res.blueWins, res.blueGames, blueLo, blueHi);
+    wilson(redWins, redGames, redLo, redHi);
+
+    double score = ((res.games > 0) ? ((double) res.wins) / res.games : 0.5);
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "\n" << opt.engine[0] << " vs " << opt.engine[1] << " on " << opt.size << "x" << opt.size << "\n"
+              << "games:      " << res.games << "\n"
+              << "win rate:   " << score << "  [" << lo << ", " << hi << "] 95%\n"
+              << "  as blue:  " << res.blueWins << "/" << res.blueGames << "  [" << blueLo << ", " << blueHi << "]\n"
+              << "  as red:   " << redWins << "/" << redGames << "  [" << redLo << ", " << redHi << "]\n"
+              << std::setprecision(1)
+              << "elo:        " << scoreToElo(score) << "  [" << scoreToElo(lo) << ", " << scoreToElo(hi) << "]\n"
+              << std::setprecision(4)
+              << "cpu/game:   " << ((res.games > 0) ? res.seconds[0] / res.games : 0.0) << "s / "
+              << ((res.games > 0) ? res.seconds[1] / res.games : 0.0) << "s\n"
+              << std::setprecision(2)
+              << "sprt:       llr " << llr(opt, res) << " in (" << log(opt.beta / (1.0 - opt.alpha))
+              << ", " << log((1.0 - opt.beta) / opt.alpha) << ") for elo0=" << opt.elo0 << " elo1=" << opt.elo1 << "\n"
+              << "decision:   " << (res.stop ? res.decision : "none (game limit reached)") << "\n";
+}
+
+static void usage(void)
+{
+    std::cout << "usage: hextournament [-size n] [-games n] [-threads n] [-concurrent n]\n"
+              << "                     [-elo0 x] [-elo1 x] [-alpha x] [-beta x] [-book file] [-net file]\n"
+              << "                     [-patterns file] [-trace file] [-record file] <engineA> <engineB>\n";
+    exit(1);
+}
+
+// parse a numeric option value, exiting with the usage message if it is not valid
+template <class T>
+static T readValue(int argc, char *argv[], int &iArg)
+{
+    if (++iArg >= argc)
+        usage();
+
+    std::istringstream ss(argv[iArg]);
+    T t;
+    ss >> t;
+    if (ss.fail())
+        usage();
+
+    return t;
+}
+
+int main(int argc, char *argv[])
+{
+    TournamentOptions opt;
+    opt.size = 7;
+    opt.games = 1000;
+    opt.threads = 0;
+    opt.concurrent = 0;
+    opt.elo0 = 0;
+    opt.elo1 = 50;
+    opt.alpha = 0.05;
+    opt.beta = 0.05;
+    opt.book = (const char *)0;
+    opt.net = (const char *)0;
+    opt.network = (const HexNet *)0;
+    opt.patterns = (const char *)0;
+    opt.weights = (const HexPatternPolicy *)0;
+    opt.trace = (const char *)0;
+    opt.record = (const char *)0;
+
+    unsigned int nEngines = 0;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        if (!strcmp(argv[iArg], "-size"))          opt.size = readValue<unsigned int>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-games"))    opt.games = readValue<unsigned int>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-threads"))  opt.threads = readValue<unsigned int>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-concurrent")) opt.concurrent = readValue<unsigned int>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-elo0"))     opt.elo0 = readValue<double>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-elo1"))     opt.elo1 = readValue<double>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-alpha"))    opt.alpha = readValue<double>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-beta"))     opt.beta = readValue<double>(argc, argv, iArg);
+        else if (!strcmp(argv[iArg], "-book"))
+        {
+            if (++iArg >= argc) usage();
+            opt.book = argv[iArg];
+        }
+        else if (!strcmp(argv[iArg], "-net"))
+        {
+            if (++iArg >= argc) usage();
+            opt.net = argv[iArg];
+        }
+        else if (!strcmp(argv[iArg], "-patterns"))
+        {
+            if (++iArg >= argc) usage();
+            opt.patterns = argv[iArg];
+        }
+        else if (!strcmp(argv[iArg], "-trace"))
+        {
+            if (++iArg >= argc) usage();
+            opt.trace = argv[iArg];
+        }
+        else if (!strcmp(argv[iArg], "-record"))
+        {
+            if (++iArg >= argc) usage();
+            opt.record = argv[iArg];
+        }
+        else if ((argv[iArg][0] != '-') && (nEngines < 2))
+            opt.engine[nEngines++] = argv[iArg];
+        else
+            usage();
+    }
+
+    if ((nEngines != 2) || (opt.size < HEXMINSIZE) || (opt.size > HEXMAXSIZE) ||
+        (opt.alpha <= 0) || (opt.alpha >= 1) || (opt.beta <= 0) || (opt.beta >= 1) || (opt.elo1 <= opt.elo0))
+        usage();
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        HexPlayer *p = CreateEngine(opt.engine[i]);
+        if (p == (HexPlayer *)0)
+        {
+            std::cout << opt.engine[i] << " is not a known engine\n";
+            return 1;
+        }
+        delete p;
+    }
+
+    HexBook book;
+    if ((opt.book != (const char *)0) && !book.Open(opt.book))
+    {
+        std::cout << "could not open book " << opt.book << "\n";
+        return 1;
+    }
+
+    HexNet net;
+    if (opt.net != (const char *)0)
+    {
+        if (!net.Load(opt.net))
+        {
+            std::cout << "could not load network " << opt.net << "\n";
+            return 1;
+        }
+        opt.network = &net;
+    }
+
+    HexPatternPolicy weights;
+    if (opt.patterns != (const char *)0)
+    {
+        if (!weights.Load(opt.patterns))
+        {
+            std::cout << "could not load patterns " << opt.patterns << "\n";
+            return 1;
+        }
+        opt.weights = &weights;
+    }
+
+    TournamentResults res;
+    memset(&res, 0, sizeof(res));
+
+    srand(time(0));
+
+    if (opt.trace != (const char *)0)
+        HexTrace::Start();
+
+    {
+        HexThreadPool compute(opt.threads);
+        HexGameScheduler scheduler;
+
+        if (opt.concurrent == 0)
+            opt.concurrent = 2 * compute.Size();
+
+        std::cout << opt.engine[0] << " vs " << opt.engine[1] << ", up to " << opt.games
+                  << " games, " << opt.concurrent << " at a time on " << compute.Size() << " threads\n" << std::flush;
+
+        // each finished game starts the next one, until the limit or an SPRT decision
+        for (unsigned int i = 0; (i < opt.concurrent) && (i < opt.games); i++)
+            startGame(opt, res, &book, compute, scheduler);
+
+        scheduler.Wait();
+    }
+
+    if ((opt.trace != (const char *)0) && !HexTrace::Flush(opt.trace))
+        std::cout << "could not write trace " << opt.trace << "\n";
+
+    report(opt, res);
+    return 0;
+}
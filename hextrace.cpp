@@ -0,0 +1,270 @@
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include "hextrace.h"
+
+/* ============================================================================
+   HexTraceRing class
+
+   Single producer, single consumer ring of events.  The owning thread is the
+   only producer and only moves head;  Flush() is the only consumer and only
+   moves tail (with the registry lock held).
+
+   When the ring fills up, whole scopes are dropped, never half of one:  a
+   begin event is only kept if there is also room for the end events of it
+   and of every scope still open, and the end of a dropped begin is dropped
+   with it.  The owning thread tracks its open scopes for this.
+   ============================================================================ */
+class HexTraceRing {
+    public:
+    HexTraceRing(void);
+    ~HexTraceRing(void);
+    void Push(const HexTraceEvent &e);
+    void Drain(std::vector<HexTraceEvent> &out);
+
+    unsigned int tid;           // sequential thread id shown in the trace
+    const char *threadName;
+    std::atomic<uint64_t> dropped;              // events lost because the ring was full
+
+    private:
+    HexTraceEvent *events;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::vector<bool> open;     // per open scope, innermost last:  its begin was kept
+    uint64_t reserved;          // open scopes whose end events are still to come
+};
+
+typedef struct structHexTraceThread {
+    unsigned int tid;
+    const char *name;
+} HexTraceThread;
+
+static std::mutex registryLock;
+static std::vector<HexTraceRing *> registry;
+static std::vector<HexTraceEvent> retiredEvents;            // from threads that have exited
+static std::vector<unsigned int> retiredTids;               // thread of each retired event
+static std::vector<HexTraceThread> retiredThreads;
+static uint64_t retiredDropped = 0;
+static unsigned int nextTid = 1;
+
+static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+static thread_local const char *threadLabel = (const char *)0;   // set by ThreadName
+
+std::atomic<bool> HexTrace::enabled(false);
+thread_local HexTraceRing *HexTrace::ring = (HexTraceRing *)0;
+
+HexTraceRing::HexTraceRing(void) : threadName(threadLabel), dropped(0), head(0), tail(0), reserved(0)
+{
+    events = new HexTraceEvent[HEXTRACE_RINGSIZE];
+
+    std::lock_guard<std::mutex> guard(registryLock);
+    tid = nextTid++;
+    registry.push_back(this);
+}
+
+HexTraceRing::~HexTraceRing(void)
+{
+    // keep whatever this thread recorded for the next Flush
+    std::lock_guard<std::mutex> guard(registryLock);
+
+    std::vector<HexTraceEvent> rest;
+    Drain(rest);
+    retiredEvents.insert(retiredEvents.end(), rest.begin(), rest.end());
+    retiredTids.insert(retiredTids.end(), rest.size(), tid);
+    retiredDropped += dropped;
+
+    HexTraceThread t = {tid, threadName};
+    retiredThreads.push_back(t);
+
+    registry.erase(std::find(registry.begin(), registry.end(), this));
+    delete [] events;
+}
+
+void HexTraceRing::Push(const HexTraceEvent &e)
+{
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t used = h - tail.load(std::memory_order_acquire);
+    bool keep;
+
+    if (e.phase == 'B')
+    {
+        // room for this begin and its end, past the ends already owed
+        keep = (used + reserved + 2 <= HEXTRACE_RINGSIZE);
+        open.push_back(keep);
+        if (keep) reserved++;
+    }
+    else if (!open.empty())
+    {
+        // the end of a kept begin always has its reserved slot
+        keep = open.back();
+        open.pop_back();
+        if (keep) reserved--;
+    }
+    else
+        keep = (used + reserved < HEXTRACE_RINGSIZE);
+
+    if (!keep)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    events[h % HEXTRACE_RINGSIZE] = e;
+    head.store(h + 1, std::memory_order_release);
+}
+
+void HexTraceRing::Drain(std::vector<HexTraceEvent> &out)
+{
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    uint64_t h = head.load(std::memory_order_acquire);
+
+    for ( ; t < h; t++)
+        out.push_back(events[t % HEXTRACE_RINGSIZE]);
+
+    tail.store(h, std::memory_order_release);
+}
+
+// owns the calling thread's ring, so that it is retired when the thread exits
+static thread_local std::unique_ptr<HexTraceRing> ringOwner;
+
+/* ----------------------------------------------------------------------------
+   void HexTrace::Start(void);
+   void HexTrace::Stop(void);
+
+   Turn recording on and off.  Events already recorded are kept until Flush.
+   ---------------------------------------------------------------------------- */
+void HexTrace::Start(void)
+{   enabled.store(true, std::memory_order_relaxed);    }
+
+void HexTrace::Stop(void)
+{   enabled.store(false, std::memory_order_relaxed);   }
+
+/* ----------------------------------------------------------------------------
+   void HexTrace::ThreadName(const char *name);
+
+   Labels the calling thread in the trace (name must be a string literal).
+   Does not allocate a ring, so it is cheap to call while tracing is off.
+   ---------------------------------------------------------------------------- */
+void HexTrace::ThreadName(const char *name)
+{
+    threadLabel = name;
+
+    if (ring != (HexTraceRing *)0)
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        ring->threadName = name;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   void HexTrace::record(char phase, const char *name, int64_t arg);
+
+   Appends an event to the calling thread's ring, creating the ring on first
+   use.
+   ---------------------------------------------------------------------------- */
+void HexTrace::record(char phase, const char *name, int64_t arg)
+{
+    if (ring == (HexTraceRing *)0)
+    {
+        ringOwner.reset(new HexTraceRing);
+        ring = ringOwner.get();
+    }
+
+    HexTraceEvent e;
+    e.name = name;
+    e.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    e.arg = arg;
+    e.phase = phase;
+    ring->Push(e);
+}
+
+/* ----------------------------------------------------------------------------
+   bool HexTrace::Flush(const char *filename);
+
+   Drains the events of all threads (including those that have exited) and
+   writes them to filename as a Chrome trace.  Rings are emptied even if the
+   file cannot be written.  Returns true if successful.
+
+   Threads may keep recording while Flush runs;  their later events go to
+   the next Flush.
+   ---------------------------------------------------------------------------- */
+static void writeString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for ( ; *s; s++)
+    {
+        if ((*s == '"') || (*s == '\\')) fputc('\\', f);
+        if ((unsigned char) *s >= 0x20) fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool HexTrace::Flush(const char *filename)
+{
+    std::vector<HexTraceEvent> events;
+    std::vector<unsigned int> tids;
+    std::vector<HexTraceThread> threads;
+    uint64_t dropped;
+
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+
+        events.swap(retiredEvents);
+        tids.swap(retiredTids);
+        threads.swap(retiredThreads);
+        dropped = retiredDropped;
+        retiredDropped = 0;
+
+        for (unsigned int i = 0; i < registry.size(); i++)
+        {
+            registry[i]->Drain(events);
+            tids.resize(events.size(), registry[i]->tid);
+
+            HexTraceThread t = {registry[i]->tid, registry[i]->threadName};
+            threads.push_back(t);
+
+            dropped += registry[i]->dropped.exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+    FILE *f = fopen(filename, "w");
+    if (f == (FILE *)0)
+        return false;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+
+    bool first = true;
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        if (threads[i].name == (const char *)0) continue;
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                (first ? "" : ",\n"), threads[i].tid);
+        writeString(f, threads[i].name);
+        fprintf(f, "}}");
+        first = false;
+    }
+
+    for (unsigned int i = 0; i < events.size(); i++)
+    {
+        HexTraceEvent &e = events[i];
+
+        fprintf(f, "%s{\"name\":", (first ? "" : ",\n"));
+        writeString(f, e.name);
+        fprintf(f, ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u",
+                e.phase, (unsigned long long) (e.ns / 1000), (unsigned int) (e.ns % 1000), tids[i]);
+        if (e.arg >= 0)
+            fprintf(f, ",\"args\":{\"value\":%lld}", (long long) e.arg);
+        fprintf(f, "}");
+        first = false;
+    }
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%llu}}\n", (unsigned long long) dropped);
+
+    bool ok = !ferror(f);
+    return ((fclose(f) == 0) && ok);
+}
@@ -0,0 +1,80 @@
+#ifndef _HEXTRACE_H_
+#define _HEXTRACE_H_
+
+#include <stdint.h>
+#include <atomic>
+
+/* ============================================================================
+   HexTrace class
+
+   Optional timeline of begin/end events, written as a Chrome trace JSON file
+   (chrome://tracing, ui.perfetto.dev).  Each thread appends events to its
+   own fixed size ring without locking;  Flush() drains every ring and writes
+   the file.  While tracing is off, an event costs one relaxed load and a
+   branch.
+
+   Event names are not copied, they must be string literals (or otherwise
+   outlive the next Flush).
+   ============================================================================ */
+typedef struct structHexTraceEvent {
+    const char *name;
+    uint64_t    ns;             // steady clock, ns since the process trace origin
+    int64_t     arg;            // shown as args.value, omitted if negative
+    char        phase;          // 'B' begin, 'E' end
+} HexTraceEvent;
+
+// events per thread; when a ring is full, new scopes (begin and end) are dropped and counted
+const unsigned int HEXTRACE_RINGSIZE = 1 << 16;
+
+class HexTraceRing;
+
+class HexTrace {
+    public:
+    static void Start(void);
+    static void Stop(void);
+    static bool Flush(const char *filename);
+    static void ThreadName(const char *name);
+    static inline bool Enabled(void);
+    static inline void Begin(const char *name, int64_t arg=-1);
+    static inline void End(const char *name);
+
+    private:
+    static std::atomic<bool> enabled;
+    static thread_local HexTraceRing *ring;     // this thread's ring, once registered
+    static void record(char phase, const char *name, int64_t arg);
+
+    friend class HexTraceScope;
+};
+
+inline bool HexTrace::Enabled(void)
+{   return enabled.load(std::memory_order_relaxed); }
+
+inline void HexTrace::Begin(const char *name, int64_t arg)
+{   if (Enabled()) record('B', name, arg);  }
+
+inline void HexTrace::End(const char *name)
+{   if (Enabled()) record('E', name, -1);   }
+
+/* ============================================================================
+   HexTraceScope class
+
+   Brackets the enclosing scope with a begin and an end event.  If tracing is
+   turned on or off inside the scope, the pair is still balanced.
+   ============================================================================ */
+class HexTraceScope {
+    public:
+    HexTraceScope(const char *n, int64_t arg=-1) : name(n), active(HexTrace::Enabled())
+    {   if (active) HexTrace::record('B', name, arg);   }
+    ~HexTraceScope(void)
+    {   if (active) HexTrace::record('E', name, -1);    }
+
+    private:
+    const char *name;
+    bool active;
+};
+
+#define HEXTRACE_CONCAT2(a, b) a##b
+#define HEXTRACE_CONCAT(a, b) HEXTRACE_CONCAT2(a, b)
+#define HEXTRACE_SCOPE(...) HexTraceScope HEXTRACE_CONCAT(hexTraceScope, __LINE__)(__VA_ARGS__)
+
+#endif
@@ -1,15 +1,309 @@
 #ifndef _MINGRAPH_HPP_
 #define _MINGRAPH_HPP_
 
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
 #include <vector>
 #include <queue>
+#include <atomic>
+#include <limits>
 #include <algorithm>
+#include <functional>
+#include <type_traits>
+#include "concurrentunionfind.h"
+#include "hexthreadpool.h"
+#include "mingraphfile.h"
 
 typedef unsigned int VertexID;
 typedef std::vector<VertexID> VertexIDSet;
 
 template <class T> class MinGraph;
 
+const VertexID MINGRAPH_NOVERTEX = (VertexID) -1;
+const unsigned int MINGRAPH_UNREACHED = (unsigned int) -1;
+const unsigned int MINGRAPH_BLOCKED = (unsigned int) -1;   // cost of a vertex no path may enter
+
+typedef std::function<unsigned int(VertexID v)> MinGraphCost;
+const unsigned int MINGRAPH_CHUNK = 4096;       // vertices per parallel task, a multiple of 64
+const unsigned int MINGRAPH_EDGECHUNK = 65536;  // least edge ends per parallel task when loading
+const unsigned int MINGRAPH_EDGETASKS = 64;     // most parallel tasks over the edges when loading
+const size_t MINGRAPH_TEXTCHUNK = 1 << 20;      // bytes of edge list text per parallel task
+
+typedef enum enumMinGraphFormat {
+    MINGRAPH_EDGES_BINARY,                      // uint32_t vertex pairs
+    MINGRAPH_EDGES_TEXT                         // "u v" lines
+} MinGraphFormat;
+
+/* ============================================================================
+   class MinGraphComponents
+
+   Connected components of a graph as labelled by MinGraph::Components():
+   each vertex is labelled with the smallest vertex of its component, so
+   that two vertices are connected exactly when their labels are equal.
+   ============================================================================ */
+class MinGraphComponents {
+    public:
+    MinGraphComponents(void) : count(0) {}
+    inline bool Same(VertexID u, VertexID v) { return (label[u] == label[v]); }
+    inline VertexID Component(VertexID v) { return label[v]; }
+    inline unsigned int Count(void) { return count; }
+
+    private:
+    std::vector<VertexID> label;
+    unsigned int count;
+
+    template <class T> friend class MinGraph;
+};
+
+/* ============================================================================
+   class MinGraphBFS
+
+   Result of a breadth-first search by MinGraph::BFS():  the distance of each
+   reached vertex from the source, in edges, and its parent on a shortest
+   path (the source is its own parent).  Unreached vertices have distance
+   MINGRAPH_UNREACHED and parent MINGRAPH_NOVERTEX.
+   
+   It also holds the search's frontiers, so searching graphs of the same size
+   again with the same MinGraphBFS allocates nothing.
+   ============================================================================ */
+class MinGraphBFS {
+    public:
+    MinGraphBFS(void) : levels(0), bottomUp(0), reached(0) {}
+    inline bool Reached(VertexID v) { return (dist[v] != MINGRAPH_UNREACHED); }
+    inline unsigned int Distance(VertexID v) { return dist[v]; }
+    inline VertexID Parent(VertexID v) { return parent[v].load(std::memory_order_relaxed); }
+    inline unsigned int Count(void) { return reached; }         // vertices reached, with the source
+    inline unsigned int Levels(void) { return levels; }         // levels expanded
+    inline unsigned int BottomUpLevels(void) { return bottomUp; }
+    void Path(VertexID v, VertexIDSet &path);
+
+    private:
+    std::vector<std::atomic<VertexID> > parent;
+    std::vector<unsigned int> dist;
+    std::vector<uint64_t> frontier;             // frontier bitmap, on bottom-up levels
+    std::vector<uint64_t> next;
+    VertexIDSet queue;                          // frontier list, on top-down levels
+    VertexIDSet spare;
+    std::vector<VertexIDSet> parts;             // next frontier, one list per chunk
+    std::vector<unsigned int> found;            // vertices found, per chunk
+    std::vector<unsigned long> degrees;         // their degrees, per chunk
+    unsigned int levels;
+    unsigned int bottomUp;
+    unsigned int reached;
+
+    void reset(unsigned int size, unsigned int nChunks);
+
+    template <class T> friend class MinGraph;
+
+    // no copies, atomics cannot be copied
+    MinGraphBFS(const MinGraphBFS &);
+    MinGraphBFS &operator=(const MinGraphBFS &);
+};
+
+// sizes the arrays for a graph of size vertices, reallocating only if that changed
+inline void MinGraphBFS::reset(unsigned int size, unsigned int nChunks)
+{
+    if (parent.size() != size)
+    {
+        // atomics cannot be moved, so the vector is rebuilt rather than resized
+        std::vector<std::atomic<VertexID> > items(size);
+        parent.swap(items);
+        dist.resize(size);
+    }
+
+    frontier.resize(nChunks * (MINGRAPH_CHUNK / 64));
+    next.resize(frontier.size());
+    parts.resize(nChunks);
+    found.resize(nChunks);
+    degrees.resize(nChunks);
+}
+
+/* ----------------------------------------------------------------------------
+   void MinGraphBFS::Path(VertexID v, VertexIDSet &path);
+
+   Returns a shortest path from the source to v, both included, following
+   the parents;  empty if v was not reached.
+   ---------------------------------------------------------------------------- */
+inline void MinGraphBFS::Path(VertexID v, VertexIDSet &path)
+{
+    path.clear();
+    if (!Reached(v))
+        return;
+
+    path.push_back(v);
+    while (Parent(v) != v)
+    {
+        v = Parent(v);
+        path.push_back(v);
+    }
+
+    std::reverse(path.begin(), path.end());
+}
+
+/* ============================================================================
+   class MinGraphRadixHeap
+
+   Monotone priority queue of (key, vertex) for Dijkstra's algorithm with
+   integer costs (Ahuja, Mehlhorn, Orlin and Tarjan, 1990).  An entry goes
+   to the bucket of the highest bit in which its key differs from the last
+   key popped, so no key smaller than that may be pushed.  Popping empties
+   the lowest nonempty bucket into lower ones, each entry moving down at
+   most 32 times in all, so push and pop cost O(1) amortized, with no
+   comparisons between entries.  The buckets keep their capacity across
+   uses.
+   ============================================================================ */
+class MinGraphRadixHeap {
+    public:
+    MinGraphRadixHeap(void) : last(0), count(0) {}
+    inline bool Empty(void) { return (count == 0); }
+    void Clear(void);
+    void Push(unsigned int key, VertexID v);
+    void Pop(unsigned int &key, VertexID &v);
+
+    private:
+    typedef struct structRadixEntry {
+        unsigned int key;
+        VertexID v;
+    } RadixEntry;
+
+    std::vector<RadixEntry> buckets[33];        // 0:  key == last;  b:  highest differing bit is b - 1
+    unsigned int last;
+    unsigned int count;
+
+    inline unsigned int bucket(unsigned int key) { return ((key == last) ? 0 : 32 - __builtin_clz(key ^ last)); }
+};
+
+inline void MinGraphRadixHeap::Clear(void)
+{
+    for (unsigned int b = 0; b < 33; b++)
+        buckets[b].clear();
+    last = 0;
+    count = 0;
+}
+
+inline void MinGraphRadixHeap::Push(unsigned int key, VertexID v)
+{
+    RadixEntry e;
+    e.key = key;
+    e.v = v;
+    buckets[bucket(key)].push_back(e);
+    count++;
+}
+
+// removes an entry with the smallest key;  the heap must not be empty
+inline void MinGraphRadixHeap::Pop(unsigned int &key, VertexID &v)
+{
+    if (buckets[0].empty())
+    {
+        unsigned int b = 1;
+        while (buckets[b].empty())
+            b++;
+
+        // the smallest key of the bucket becomes last, and the rest of the
+        // bucket differs from it in lower bits only
+        last = buckets[b][0].key;
+        for (unsigned int i = 1; i < buckets[b].size(); i++)
+            last = std::min(last, buckets[b][i].key);
+
+        for (unsigned int i = 0; i < buckets[b].size(); i++)
+            buckets[bucket(buckets[b][i].key)].push_back(buckets[b][i]);
+        buckets[b].clear();
+    }
+
+    key = buckets[0].back().key;
+    v = buckets[0].back().v;
+    buckets[0].pop_back();
+    count--;
+}
+
+/* ============================================================================
+   class MinGraphPaths
+
+   Result of a cheapest path search by MinGraph::ShortestPaths():  the cost
+   of the cheapest path from any source to each reached vertex, and its
+   parent on that path (sources are their own parents).  Unreached vertices
+   have cost MINGRAPH_UNREACHED and parent MINGRAPH_NOVERTEX.
+
+   It is also the search's workspace:  the arrays are allocated for the
+   first graph of a size, and later searches only reset the vertices the
+   previous one reached, so repeated searches on a small board allocate
+   nothing and cost nothing for the parts of the graph they do not reach.
+   ============================================================================ */
+class MinGraphPaths {
+    public:
+    inline bool Reached(VertexID v) { return (cost[v] != MINGRAPH_UNREACHED); }
+    inline unsigned int Cost(VertexID v) { return cost[v]; }
+    inline VertexID Parent(VertexID v) { return parent[v]; }
+    void Path(VertexID v, VertexIDSet &path);
+
+    private:
+    std::vector<unsigned int> cost;
+    std::vector<VertexID> parent;
+    VertexIDSet touched;                        // vertices reached, to reset
+    VertexIDSet current;                        // 0-1 BFS:  vertices at the current cost
+    VertexIDSet next;                           // 0-1 BFS:  vertices at the next cost
+    MinGraphRadixHeap heap;
+
+    void reset(unsigned int size);
+    inline void reach(VertexID v, unsigned int c, VertexID from);
+
+    template <class T> friend class MinGraph;
+};
+
+// prepares for a search of a graph of size vertices
+inline void MinGraphPaths::reset(unsigned int size)
+{
+    if (cost.size() != size)
+    {
+        cost.assign(size, MINGRAPH_UNREACHED);
+        parent.assign(size, MINGRAPH_NOVERTEX);
+        touched.clear();
+    }
+
+    for (unsigned int i = 0; i < touched.size(); i++)
+    {
+        cost[touched[i]] = MINGRAPH_UNREACHED;
+        parent[touched[i]] = MINGRAPH_NOVERTEX;
+    }
+
+    touched.clear();
+    current.clear();
+    next.clear();
+    heap.Clear();
+}
+
+// records a cheaper path to v
+inline void MinGraphPaths::reach(VertexID v, unsigned int c, VertexID from)
+{
+    if (cost[v] == MINGRAPH_UNREACHED)
+        touched.push_back(v);
+    cost[v] = c;
+    parent[v] = from;
+}
+
+/* ----------------------------------------------------------------------------
+   void MinGraphPaths::Path(VertexID v, VertexIDSet &path);
+
+   Returns a cheapest path to v from its source, both included;  empty if v
+   was not reached.
+   ---------------------------------------------------------------------------- */
+inline void MinGraphPaths::Path(VertexID v, VertexIDSet &path)
+{
+    path.clear();
+    if (!Reached(v))
+        return;
+
+    path.push_back(v);
+    while (parent[v] != v)
+    {
+        v = parent[v];
+        path.push_back(v);
+    }
+
+    std::reverse(path.begin(), path.end());
+}
+
 template <class T>
 class Vertex {
     T value;
@@ -27,7 +321,14 @@ class MinGraph {
     inline int V(void) { return VS.size(); }
     
     void AddEdge(VertexID u, VertexID v);
-    bool HasPath(VertexID u, VertexID v, bool restrictToSimilar=false);    
+    bool HasPath(VertexID u, VertexID v, bool restrictToSimilar=false, HexThreadPool *pool=(HexThreadPool *)0);
+    bool BFS(VertexID source, MinGraphBFS &bfs, bool restrictToSimilar=false, HexThreadPool *pool=(HexThreadPool *)0,
+             VertexID target=MINGRAPH_NOVERTEX);
+    void Components(MinGraphComponents &cc, bool restrictToSimilar=false, HexThreadPool *pool=(HexThreadPool *)0);
+    unsigned int ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths, const std::vector<unsigned int> &valueCost,
+                               VertexID target=MINGRAPH_NOVERTEX);
+    unsigned int ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths, const MinGraphCost &cost,
+                               unsigned int maxCost, VertexID target=MINGRAPH_NOVERTEX);
     void Neighbors(VertexID v, VertexIDSet &vs, bool restrictToSimilar=false);
     T    SetVertexValue(VertexID v, T value);
     T    GetVertexValue(VertexID v);
@@ -35,14 +336,27 @@ class MinGraph {
     void Reset(int n);  
     void Reset(int n, T value);
     
+    bool LoadEdges(const char *filename, MinGraphFormat format=MINGRAPH_EDGES_BINARY, unsigned int nVertices=0,
+                   HexThreadPool *pool=(HexThreadPool *)0);
+    void Save(const char *filename);
+    bool Load(const char *filename, HexThreadPool *pool=(HexThreadPool *)0);
+    
     private:
     std::vector<Vertex<T> > VS;
+    
+    bool build(const uint32_t *ends, size_t nEnds, unsigned int nVertices, HexThreadPool *pool);
+    template <class Cost> unsigned int shortestPaths(const VertexIDSet &sources, MinGraphPaths &paths, Cost cost,
+                                                     bool unitCosts, VertexID target);
+    template <class Cost> unsigned int zeroOneBFS(MinGraphPaths &paths, Cost cost, VertexID target);
+    template <class Cost> unsigned int dijkstra(MinGraphPaths &paths, Cost cost, VertexID target);
+    static void forChunks(unsigned int nChunks, const HexForBody &body, HexThreadPool *pool);
 };
 
 typedef enum enumMinGraphError {
     MINGRAPH_ERR_INVALIDSIZE = 0x100,
     MINGRAPH_ERR_INVALIDEDGE,
-    MINGRAPH_ERR_INVALIDVERTEX
+    MINGRAPH_ERR_INVALIDVERTEX,
+    MINGRAPH_ERR_WRITE
 } MinGraphError;
 
 
@@ -87,7 +401,8 @@ void MinGraph<T>::AddEdge(VertexID u, VertexID v)
 }
 
 /* ----------------------------------------------------------------------------
-   bool HasPath(VertexID u, VertexID v, bool restrictToSimilar=false);
+   bool HasPath(VertexID u, VertexID v, bool restrictToSimilar=false,
+                HexThreadPool *pool=0);
    
    Determines whether a path exists between vertices u, v.
    Returns true if a path exists, false otherwise
@@ -95,14 +410,23 @@ void MinGraph<T>::AddEdge(VertexID u, VertexID v)
    If the optional third parameter restrictToSimilar is set to true, then a path 
    will be considered only through vertices that have same value as the source 
    vertex.
+   
+   With a pool, the search is BFS() on the pool, for large graphs;  otherwise
+   a plain queue-based search on the calling thread.
    ---------------------------------------------------------------------------- */
 template <class T>
-bool MinGraph<T>::HasPath(VertexID u, VertexID v, bool restrictToSimilar)
+bool MinGraph<T>::HasPath(VertexID u, VertexID v, bool restrictToSimilar, HexThreadPool *pool)
 {    
     int size = V();
     
     if ((u < 0) || (u >= size) || (v < 0) || (v >= size) || (u == v))
         throw MINGRAPH_ERR_INVALIDVERTEX;
+    
+    if (pool != (HexThreadPool *)0)
+    {
+        MinGraphBFS bfs;
+        return BFS(u, bfs, restrictToSimilar, pool, v);
+    }
 
     std::vector<bool> seen(size, false);
     std::queue<VertexID> Q;
@@ -111,13 +435,12 @@ bool MinGraph<T>::HasPath(VertexID u, VertexID v, bool restrictToSimilar)
     
     // initialize the queue with the source vertex u;
     Q.push(u);
+    seen[u] = true;
     
     while (!Q.empty())
     {        
         VertexID x = Q.front();         // retrieve a vertex to examine
         Q.pop();                        // and remove it from the queue
-            
-        seen[x] = true;                 // mark vertex as seen            
         
         // examine x's neighbors
         for (int i = 0; i < VS[x].neighbors.size(); i++)
@@ -135,6 +458,7 @@ bool MinGraph<T>::HasPath(VertexID u, VertexID v, bool restrictToSimilar)
             // skip this neighbor if we have already seen it
             if (seen[idNeighbor]) continue;
             
+            seen[idNeighbor] = true;    // mark when queued, so it is queued only once
             Q.push(idNeighbor);         // add neighbor to queue for later processing
         }    
     }
@@ -144,6 +468,446 @@ bool MinGraph<T>::HasPath(VertexID u, VertexID v, bool restrictToSimilar)
     return false;
 }
 
+/* ----------------------------------------------------------------------------
+   bool BFS(VertexID source, MinGraphBFS &bfs, bool restrictToSimilar=false,
+            HexThreadPool *pool=0, VertexID target=MINGRAPH_NOVERTEX);
+   
+   Breadth-first search from source, level by level, recording distances
+   and parents in bfs.  If restrictToSimilar is true, only vertices with the
+   source's value are reached, as in HasPath.  Given a target, the search
+   stops after the level that reaches it, leaving farther vertices
+   unreached, and returns whether it was reached;  otherwise returns true.
+   
+   Direction-optimizing (Beamer, Asanovic and Patterson, SC 2012):  while
+   the frontier is small, each frontier vertex claims its unreached
+   neighbors (top-down, over a list);  once the frontier's edges outnumber
+   the unreached vertices' edges by MINGRAPH_BFS_ALPHA, each unreached
+   vertex looks for a neighbor in the frontier instead, and stops at the
+   first (bottom-up, over bitmaps), until the frontier shrinks below
+   1/MINGRAPH_BFS_BETA of the graph again.  With a pool, each level's vertices
+   are spread over it in chunks.
+   ---------------------------------------------------------------------------- */
+const unsigned int MINGRAPH_BFS_ALPHA = 14;
+const unsigned int MINGRAPH_BFS_BETA = 24;
+
+template <class T>
+bool MinGraph<T>::BFS(VertexID source, MinGraphBFS &bfs, bool restrictToSimilar, HexThreadPool *pool, VertexID target)
+{
+    unsigned int size = V();
+    
+    if ((source >= size) || ((target != MINGRAPH_NOVERTEX) && (target >= size)))
+        throw MINGRAPH_ERR_INVALIDVERTEX;
+    
+    unsigned int nChunks = (size + MINGRAPH_CHUNK - 1) / MINGRAPH_CHUNK;
+    const unsigned int nWords = MINGRAPH_CHUNK / 64;
+    T sourceValue = VS[source].value;
+    
+    bfs.reset(size, nChunks);
+    
+    // clears the results, and sums the degrees of the vertices that may be reached
+    HexForBody clearChunk = [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min(size, (iChunk + 1) * MINGRAPH_CHUNK);
+        unsigned long degree = 0;
+        for (VertexID v = iChunk * MINGRAPH_CHUNK; v < last; v++)
+        {
+            bfs.parent[v].store(MINGRAPH_NOVERTEX, std::memory_order_relaxed);
+            bfs.dist[v] = MINGRAPH_UNREACHED;
+            if (!restrictToSimilar || (VS[v].value == sourceValue))
+                degree += VS[v].neighbors.size();
+        }
+        bfs.degrees[iChunk] = degree;
+    };
+    
+    unsigned int level = 0;
+    
+    // top-down:  each vertex of the frontier list claims its unreached neighbors
+    HexForBody topDownChunk = [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min((unsigned int) bfs.queue.size(), (iChunk + 1) * MINGRAPH_CHUNK);
+        VertexIDSet &part = bfs.parts[iChunk];
+        unsigned long degree = 0;
+        
+        part.clear();
+        for (unsigned int i = iChunk * MINGRAPH_CHUNK; i < last; i++)
+        {
+            VertexID u = bfs.queue[i];
+            const VertexIDSet &neighbors = VS[u].neighbors;
+            for (unsigned int j = 0; j < neighbors.size(); j++)
+            {
+                VertexID v = neighbors[j], none = MINGRAPH_NOVERTEX;
+                if (restrictToSimilar && (VS[v].value != sourceValue))
+                    continue;
+                
+                // the check first saves a CAS on vertices already reached
+                if ((bfs.parent[v].load(std::memory_order_relaxed) == MINGRAPH_NOVERTEX) &&
+                    bfs.parent[v].compare_exchange_strong(none, u, std::memory_order_relaxed))
+                {
+                    bfs.dist[v] = level + 1;
+                    part.push_back(v);
+                    degree += VS[v].neighbors.size();
+                }
+            }
+        }
+        bfs.found[iChunk] = part.size();
+        bfs.degrees[iChunk] = degree;
+    };
+    
+    // bottom-up:  each unreached vertex looks for a neighbor in the frontier
+    // bitmap;  a chunk's vertices only touch its own words of the next bitmap
+    HexForBody bottomUpChunk = [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min(size, (iChunk + 1) * MINGRAPH_CHUNK);
+        unsigned int nFound = 0;
+        unsigned long degree = 0;
+        
+        std::fill(bfs.next.begin() + iChunk * nWords, bfs.next.begin() + (iChunk + 1) * nWords, 0);
+        for (VertexID v = iChunk * MINGRAPH_CHUNK; v < last; v++)
+        {
+            if (bfs.dist[v] != MINGRAPH_UNREACHED)
+                continue;
+            if (restrictToSimilar && (VS[v].value != sourceValue))
+                continue;
+            
+            const VertexIDSet &neighbors = VS[v].neighbors;
+            for (unsigned int j = 0; j < neighbors.size(); j++)
+            {
+                VertexID u = neighbors[j];
+                if (bfs.frontier[u / 64] & ((uint64_t) 1 << (u % 64)))
+                {
+                    bfs.parent[v].store(u, std::memory_order_relaxed);
+                    bfs.dist[v] = level + 1;
+                    bfs.next[v / 64] |= ((uint64_t) 1 << (v % 64));
+                    nFound++;
+                    degree += neighbors.size();
+                    break;
+                }
+            }
+        }
+        bfs.found[iChunk] = nFound;
+        bfs.degrees[iChunk] = degree;
+    };
+    
+    forChunks(nChunks, clearChunk, pool);
+    
+    unsigned long unexplored = 0;               // edges from vertices not yet reached
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+        unexplored += bfs.degrees[iChunk];
+    
+    bfs.parent[source].store(source, std::memory_order_relaxed);
+    bfs.dist[source] = 0;
+    bfs.queue.assign(1, source);
+    
+    unsigned long frontierEdges = VS[source].neighbors.size();
+    unsigned int frontierSize = 1, lastSize = 0;
+    bool topDown = true;
+    
+    unexplored -= frontierEdges;
+    bfs.reached = 1;
+    bfs.bottomUp = 0;
+    
+    while (frontierSize > 0)
+    {
+        if ((target != MINGRAPH_NOVERTEX) && (bfs.dist[target] != MINGRAPH_UNREACHED))
+            break;
+        
+        // switch only while the frontier grows (to bottom-up) or shrinks (back)
+        bool growing = (frontierSize > lastSize);
+        if (topDown && growing && (frontierEdges > unexplored / MINGRAPH_BFS_ALPHA))
+        {
+            // frontier list to bitmap
+            std::fill(bfs.frontier.begin(), bfs.frontier.end(), 0);
+            for (unsigned int i = 0; i < bfs.queue.size(); i++)
+                bfs.frontier[bfs.queue[i] / 64] |= ((uint64_t) 1 << (bfs.queue[i] % 64));
+            topDown = false;
+        }
+        else if (!topDown && !growing && (frontierSize < size / MINGRAPH_BFS_BETA))
+        {
+            // frontier bitmap to list
+            bfs.queue.clear();
+            for (unsigned int w = 0; w < bfs.frontier.size(); w++)
+                for (uint64_t bits = bfs.frontier[w]; bits != 0; bits &= bits - 1)
+                    bfs.queue.push_back(w * 64 + __builtin_ctzll(bits));
+            topDown = true;
+        }
+        
+        unsigned int nParts = nChunks;
+        if (topDown)
+        {
+            nParts = (bfs.queue.size() + MINGRAPH_CHUNK - 1) / MINGRAPH_CHUNK;
+            forChunks(nParts, topDownChunk, pool);
+            
+            bfs.spare.clear();
+            for (unsigned int iPart = 0; iPart < nParts; iPart++)
+                bfs.spare.insert(bfs.spare.end(), bfs.parts[iPart].begin(), bfs.parts[iPart].end());
+            bfs.queue.swap(bfs.spare);
+        }
+        else
+        {
+            forChunks(nChunks, bottomUpChunk, pool);
+            bfs.frontier.swap(bfs.next);
+            bfs.bottomUp++;
+        }
+        
+        lastSize = frontierSize;
+        frontierSize = 0;
+        frontierEdges = 0;
+        for (unsigned int iPart = 0; iPart < nParts; iPart++)
+        {
+            frontierSize += bfs.found[iPart];
+            frontierEdges += bfs.degrees[iPart];
+        }
+        
+        unexplored -= frontierEdges;
+        bfs.reached += frontierSize;
+        level++;
+    }
+    
+    bfs.levels = level;
+    return ((target == MINGRAPH_NOVERTEX) || (bfs.dist[target] != MINGRAPH_UNREACHED));
+}
+
+/* ----------------------------------------------------------------------------
+   void Components(MinGraphComponents &cc, bool restrictToSimilar=false,
+                   HexThreadPool *pool=0);
+   
+   Labels the connected components of the graph into cc, after which any
+   number of "same component" queries take O(1) each, where HasPath would
+   search the graph every time.
+   
+   If restrictToSimilar is true, only edges between vertices of equal value
+   connect, as in HasPath.  With a pool, the edges are joined in parallel
+   in a ConcurrentUnionFind, in chunks of vertices;  otherwise on the calling
+   thread.  The labels do not depend on the order of the joins.
+   ---------------------------------------------------------------------------- */
+template <class T>
+void MinGraph<T>::Components(MinGraphComponents &cc, bool restrictToSimilar, HexThreadPool *pool)
+{
+    unsigned int size = V();
+    unsigned int nChunks = (size + MINGRAPH_CHUNK - 1) / MINGRAPH_CHUNK;
+    std::vector<unsigned int> roots(nChunks, 0);
+    ConcurrentUnionFind uf(size);
+    
+    cc.label.resize(size);
+    
+    // each edge is stored at both ends, join it from its smaller end only
+    HexForBody joinChunk = [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min(size, (iChunk + 1) * MINGRAPH_CHUNK);
+        for (VertexID u = iChunk * MINGRAPH_CHUNK; u < last; u++)
+        {
+            const VertexIDSet &neighbors = VS[u].neighbors;
+            for (unsigned int i = 0; i < neighbors.size(); i++)
+            {
+                VertexID v = neighbors[i];
+                if ((v > u) && (!restrictToSimilar || (VS[v].value == VS[u].value)))
+                    uf.Join(u, v);
+            }
+        }
+    };
+    
+    // roots are the smallest vertex of their component, so they are the labels
+    HexForBody labelChunk = [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min(size, (iChunk + 1) * MINGRAPH_CHUNK);
+        for (VertexID u = iChunk * MINGRAPH_CHUNK; u < last; u++)
+        {
+            cc.label[u] = uf.Find(u);
+            if (cc.label[u] == u)
+                roots[iChunk]++;
+        }
+    };
+    
+    forChunks(nChunks, joinChunk, pool);
+    forChunks(nChunks, labelChunk, pool);
+    
+    cc.count = 0;
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+        cc.count += roots[iChunk];
+}
+
+/* ----------------------------------------------------------------------------
+   unsigned int ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths,
+                              const std::vector<unsigned int> &valueCost,
+                              VertexID target=MINGRAPH_NOVERTEX);
+   unsigned int ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths,
+                              const MinGraphCost &cost, unsigned int maxCost,
+                              VertexID target=MINGRAPH_NOVERTEX);
+   
+   Finds the cheapest path from any of the sources to every vertex, into
+   paths.  A path costs the sum of the costs of its vertices, its source
+   included, and never enters a vertex that costs MINGRAPH_BLOCKED (not
+   even as a source).  A vertex costs valueCost[its value] in the first
+   form (values without an entry are blocked), and cost(v) in the second,
+   which is never more than maxCost unless blocked.  On a Hex board, own
+   stones might cost 0, empty cells 1 and the opponent's stones be blocked.
+   
+   When every cost is 0 or 1 the search is a 0-1 BFS;  otherwise it is
+   Dijkstra's algorithm on a MinGraphRadixHeap.  Given a target, the search
+   stops as soon as the target's cost is final, and the costs of other
+   vertices may not be.
+   
+   Returns the target's cost, MINGRAPH_UNREACHED if there is no path to it;
+   without a target, the highest cost of any vertex reached.  Throws
+   MINGRAPH_ERR_INVALIDVERTEX if a source or the target is not a vertex.
+   ---------------------------------------------------------------------------- */
+template <class T>
+unsigned int MinGraph<T>::ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths,
+                                        const std::vector<unsigned int> &valueCost, VertexID target)
+{
+    bool unitCosts = true;
+    for (unsigned int i = 0; i < valueCost.size(); i++)
+        unitCosts = unitCosts && ((valueCost[i] <= 1) || (valueCost[i] == MINGRAPH_BLOCKED));
+    
+    unsigned int nValues = valueCost.size();
+    const unsigned int *table = valueCost.data();
+    
+    return shortestPaths(sources, paths, [this, nValues, table](VertexID v) {
+        unsigned int value = (unsigned int) VS[v].value;
+        return ((value < nValues) ? table[value] : MINGRAPH_BLOCKED);
+    }, unitCosts, target);
+}
+
+template <class T>
+unsigned int MinGraph<T>::ShortestPaths(const VertexIDSet &sources, MinGraphPaths &paths, const MinGraphCost &cost,
+                                        unsigned int maxCost, VertexID target)
+{   return shortestPaths(sources, paths, cost, (maxCost <= 1), target); }
+
+// ShortestPaths() with any callable cost;  sets up paths and picks the search
+template <class T>
+template <class Cost>
+unsigned int MinGraph<T>::shortestPaths(const VertexIDSet &sources, MinGraphPaths &paths, Cost cost, bool unitCosts,
+                                        VertexID target)
+{
+    unsigned int size = V();
+    
+    if ((target != MINGRAPH_NOVERTEX) && (target >= size))
+        throw MINGRAPH_ERR_INVALIDVERTEX;
+    
+    paths.reset(size);
+    
+    for (unsigned int i = 0; i < sources.size(); i++)
+    {
+        VertexID s = sources[i];
+        if (s >= size)
+            throw MINGRAPH_ERR_INVALIDVERTEX;
+        
+        unsigned int c = cost(s);
+        if ((c == MINGRAPH_BLOCKED) || (c >= paths.cost[s]))
+            continue;
+        
+        paths.reach(s, c, s);
+        if (!unitCosts)
+            paths.heap.Push(c, s);
+        else
+            ((c == 0) ? paths.current : paths.next).push_back(s);
+    }
+    
+    return (unitCosts ? zeroOneBFS(paths, cost, target) : dijkstra(paths, cost, target));
+}
+
+/* ----------------------------------------------------------------------------
+   template <class Cost> unsigned int zeroOneBFS(MinGraphPaths &paths, Cost cost, VertexID target);
+   
+   0-1 BFS from the sources queued in paths:  paths.current holds the
+   vertices at the cost being settled, and a vertex reached through one
+   that costs 0 joins them, while one that costs 1 waits in paths.next.
+   Vertices are only queued again when their cost drops, and entries whose
+   cost has dropped since are skipped.
+   ---------------------------------------------------------------------------- */
+template <class T>
+template <class Cost>
+unsigned int MinGraph<T>::zeroOneBFS(MinGraphPaths &paths, Cost cost, VertexID target)
+{
+    unsigned int level = 0, highest = 0;
+    
+    while (!paths.current.empty() || !paths.next.empty())
+    {
+        if (paths.current.empty())
+        {
+            paths.current.swap(paths.next);
+            level++;
+            continue;
+        }
+        
+        VertexID u = paths.current.back();
+        paths.current.pop_back();
+        
+        if (paths.cost[u] != level)
+            continue;
+        
+        highest = level;
+        if (u == target)
+            return level;
+        
+        const VertexIDSet &neighbors = VS[u].neighbors;
+        for (unsigned int i = 0; i < neighbors.size(); i++)
+        {
+            VertexID v = neighbors[i];
+            unsigned int c = cost(v);
+            
+            if ((c == MINGRAPH_BLOCKED) || (level + c >= paths.cost[v]))
+                continue;
+            
+            paths.reach(v, level + c, u);
+            ((c == 0) ? paths.current : paths.next).push_back(v);
+        }
+    }
+    
+    return ((target != MINGRAPH_NOVERTEX) ? paths.cost[target] : highest);
+}
+
+/* ----------------------------------------------------------------------------
+   template <class Cost> unsigned int dijkstra(MinGraphPaths &paths, Cost cost, VertexID target);
+   
+   Dijkstra's algorithm from the sources pushed on paths.heap, skipping heap
+   entries whose vertex has become cheaper since they were pushed.
+   ---------------------------------------------------------------------------- */
+template <class T>
+template <class Cost>
+unsigned int MinGraph<T>::dijkstra(MinGraphPaths &paths, Cost cost, VertexID target)
+{
+    unsigned int highest = 0;
+    
+    while (!paths.heap.Empty())
+    {
+        unsigned int k;
+        VertexID u;
+        paths.heap.Pop(k, u);
+        
+        if (paths.cost[u] != k)
+            continue;
+        
+        highest = k;
+        if (u == target)
+            return k;
+        
+        const VertexIDSet &neighbors = VS[u].neighbors;
+        for (unsigned int i = 0; i < neighbors.size(); i++)
+        {
+            VertexID v = neighbors[i];
+            unsigned int c = cost(v);
+            
+            if ((c == MINGRAPH_BLOCKED) || (k + c >= paths.cost[v]))
+                continue;
+            
+            paths.reach(v, k + c, u);
+            paths.heap.Push(k + c, v);
+        }
+    }
+    
+    return ((target != MINGRAPH_NOVERTEX) ? paths.cost[target] : highest);
+}
+
+// calls body for every chunk, on the pool if there is one, else in order on this thread
+template <class T>
+void MinGraph<T>::forChunks(unsigned int nChunks, const HexForBody &body, HexThreadPool *pool)
+{
+    if (pool != (HexThreadPool *)0)
+    {
+        pool->ParallelFor(nChunks, body);
+        return;
+    }
+    
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+        body(iChunk, 0);
+}
+
 /* ----------------------------------------------------------------------------
    void SetVertexValue(VertexID v, T value);
    
@@ -231,4 +995,294 @@ void MinGraph<T>::Reset(int n, T value)
         VS[i].value = value;
 }
 
+/* ----------------------------------------------------------------------------
+   bool MinGraph::LoadEdges(const char *filename, MinGraphFormat format=MINGRAPH_EDGES_BINARY,
+                            unsigned int nVertices=0, HexThreadPool *pool=0);
+   
+   Replaces the graph with the edges listed in the given file (formats in
+   mingraphfile.h), read in place from a mapping of the file.  The graph has
+   nVertices vertices, or more if the edges name higher ones, with values
+   as after Reset(n).
+   
+   Rather than one AddEdge per edge, which lands each edge end in a
+   separate allocation at random, the ends are first counted and then
+   scattered into buckets of MINGRAPH_CHUNK vertices each;  each bucket
+   then fits in cache while it allocates its vertices' lists once, at their
+   final size, and fills them.  No pass needs atomics, and lists are sorted,
+   so the result does not depend on how the passes were spread over
+   threads.  With a pool, text is parsed and every pass is run in parallel.
+   
+   Returns false, leaving the graph empty, if the file cannot be read or is
+   malformed, or an edge is a self loop.
+   ---------------------------------------------------------------------------- */
+template <class T>
+bool MinGraph<T>::LoadEdges(const char *filename, MinGraphFormat format, unsigned int nVertices, HexThreadPool *pool)
+{
+    MinGraphFile file;
+    
+    Reset(0);
+    if (!file.Open(filename))
+        return false;
+    
+    if (format == MINGRAPH_EDGES_BINARY)
+    {
+        if (file.Size() % (2 * sizeof(uint32_t)) != 0)
+            return false;
+        
+        return build((const uint32_t *) file.Data(), file.Size() / sizeof(uint32_t), nVertices, pool);
+    }
+    
+    // text is parsed into per-chunk lists of ends, then joined
+    unsigned int nChunks = (file.Size() + MINGRAPH_TEXTCHUNK - 1) / MINGRAPH_TEXTCHUNK;
+    std::vector<std::vector<uint32_t> > parts(nChunks);
+    std::vector<char> parsed(nChunks);
+    
+    forChunks(nChunks, [&](unsigned int iChunk, unsigned int) {
+        size_t to = std::min(file.Size(), (iChunk + 1) * MINGRAPH_TEXTCHUNK);
+        parsed[iChunk] = file.ParseEdges(iChunk * MINGRAPH_TEXTCHUNK, to, parts[iChunk]);
+    }, pool);
+    
+    std::vector<uint32_t> ends;
+    size_t nEnds = 0;
+    
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+        if (!parsed[iChunk])
+            return false;
+        nEnds += parts[iChunk].size();
+    }
+    
+    ends.reserve(nEnds);
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+        ends.insert(ends.end(), parts[iChunk].begin(), parts[iChunk].end());
+        std::vector<uint32_t>().swap(parts[iChunk]);
+    }
+    
+    return build(ends.empty() ? (const uint32_t *)0 : &ends[0], nEnds, nVertices, pool);
+}
+
+/* ----------------------------------------------------------------------------
+   bool MinGraph::build(const uint32_t *ends, size_t nEnds, unsigned int nVertices,
+                        HexThreadPool *pool);
+   
+   LoadEdges() once the edges are in memory, as pairs of ends.
+   ---------------------------------------------------------------------------- */
+template <class T>
+bool MinGraph<T>::build(const uint32_t *ends, size_t nEnds, unsigned int nVertices, HexThreadPool *pool)
+{
+    // at most MINGRAPH_EDGETASKS chunks of edges, to bound the bucket counts
+    size_t edgeChunk = std::max((size_t) MINGRAPH_EDGECHUNK, (nEnds / MINGRAPH_EDGETASKS + 2) & ~(size_t) 1);
+    unsigned int nEdgeChunks = (nEnds + edgeChunk - 1) / edgeChunk;
+    std::vector<uint32_t> highest(nEdgeChunks);
+    std::vector<char> valid(nEdgeChunks);
+    
+    // pass 1:  the highest vertex, and no self loops
+    forChunks(nEdgeChunks, [&](unsigned int iChunk, unsigned int) {
+        size_t last = std::min(nEnds, (iChunk + 1) * edgeChunk);
+        uint32_t high = 0;
+        bool ok = true;
+        for (size_t i = iChunk * edgeChunk; i < last; i += 2)
+        {
+            high = std::max(high, std::max(ends[i], ends[i + 1]));
+            ok = ok && (ends[i] != ends[i + 1]);
+        }
+        highest[iChunk] = high;
+        valid[iChunk] = ok;
+    }, pool);
+    
+    uint64_t size = nVertices;
+    for (unsigned int iChunk = 0; iChunk < nEdgeChunks; iChunk++)
+    {
+        if (!valid[iChunk])
+            return false;
+        size = std::max(size, (uint64_t) highest[iChunk] + 1);
+    }
+    
+    if (size > (uint64_t) std::numeric_limits<int>::max())
+        return false;
+    
+    Reset((int) size);
+    
+    // edge ends are bucketed by the chunk of vertices they belong to;
+    // counts[iEdgeChunk * nChunks + iBucket] are the ends one chunk of edges
+    // has in one bucket, and become where it writes them
+    unsigned int nChunks = (size + MINGRAPH_CHUNK - 1) / MINGRAPH_CHUNK;
+    std::vector<size_t> counts((size_t) nEdgeChunks * nChunks, 0);
+    std::vector<size_t> bucketStart(nChunks + 1, 0);
+    
+    // pass 2:  count
+    forChunks(nEdgeChunks, [&](unsigned int iChunk, unsigned int) {
+        size_t last = std::min(nEnds, (iChunk + 1) * edgeChunk);
+        size_t *row = &counts[(size_t) iChunk * nChunks];
+        for (size_t i = iChunk * edgeChunk; i < last; i++)
+            row[ends[i] / MINGRAPH_CHUNK]++;
+    }, pool);
+    
+    size_t start = 0;
+    for (unsigned int iBucket = 0; iBucket < nChunks; iBucket++)
+    {
+        bucketStart[iBucket] = start;
+        for (unsigned int iChunk = 0; iChunk < nEdgeChunks; iChunk++)
+        {
+            size_t count = counts[(size_t) iChunk * nChunks + iBucket];
+            counts[(size_t) iChunk * nChunks + iBucket] = start;
+            start += count;
+        }
+    }
+    bucketStart[nChunks] = start;
+    
+    // pass 3:  scatter (vertex, neighbor) pairs to their buckets;  each chunk
+    // of edges writes a region of its own in each bucket, in edge order
+    std::vector<uint32_t> pairs(2 * nEnds);
+    
+    forChunks(nEdgeChunks, [&](unsigned int iChunk, unsigned int) {
+        size_t last = std::min(nEnds, (iChunk + 1) * edgeChunk);
+        size_t *row = &counts[(size_t) iChunk * nChunks];
+        for (size_t i = iChunk * edgeChunk; i < last; i++)
+        {
+            size_t at = 2 * row[ends[i] / MINGRAPH_CHUNK]++;
+            pairs[at] = ends[i];
+            pairs[at + 1] = ends[i ^ 1];
+        }
+    }, pool);
+    
+    // pass 4:  each chunk of vertices sizes and fills its lists from its
+    // bucket, which is small enough to stay in cache, then sorts them
+    forChunks(nChunks, [&](unsigned int iChunk, unsigned int) {
+        unsigned int first = iChunk * MINGRAPH_CHUNK;
+        unsigned int last = std::min((unsigned int) size, first + MINGRAPH_CHUNK);
+        std::vector<unsigned int> degree(last - first, 0);
+        
+        for (size_t at = 2 * bucketStart[iChunk]; at < 2 * bucketStart[iChunk + 1]; at += 2)
+            degree[pairs[at] - first]++;
+        
+        for (VertexID v = first; v < last; v++)
+        {
+            VS[v].neighbors.resize(degree[v - first]);
+            degree[v - first] = 0;
+        }
+        
+        for (size_t at = 2 * bucketStart[iChunk]; at < 2 * bucketStart[iChunk + 1]; at += 2)
+            VS[pairs[at]].neighbors[degree[pairs[at] - first]++] = pairs[at + 1];
+        
+        for (VertexID v = first; v < last; v++)
+            std::sort(VS[v].neighbors.begin(), VS[v].neighbors.end());
+    }, pool);
+    
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+   void MinGraph::Save(const char *filename);
+   
+   Writes the graph, vertex values included, in the native format of
+   mingraphfile.h, which Load() reads back without parsing.  T must be
+   trivially copyable.  Throws MINGRAPH_ERR_WRITE if the file cannot be
+   written.
+   ---------------------------------------------------------------------------- */
+template <class T>
+void MinGraph<T>::Save(const char *filename)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "MinGraph::Save needs trivially copyable values");
+    
+    unsigned int size = V();
+    std::vector<uint64_t> offsets(size + 1, 0);
+    
+    for (VertexID v = 0; v < size; v++)
+        offsets[v + 1] = offsets[v] + VS[v].neighbors.size();
+    
+    MinGraphFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MinGraphMagic, sizeof(MinGraphMagic));
+    header.nVertices = size;
+    header.valueSize = sizeof(T);
+    header.nAdjacency = offsets[size];
+    
+    FILE *f = fopen(filename, "wb");
+    if (f == (FILE *)0)
+        throw MINGRAPH_ERR_WRITE;
+    
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+              (fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), f) == offsets.size());
+    
+    for (VertexID v = 0; ok && (v < size); v++)
+        if (!VS[v].neighbors.empty())
+            ok = (fwrite(&VS[v].neighbors[0], sizeof(VertexID), VS[v].neighbors.size(), f) == VS[v].neighbors.size());
+    
+    for (VertexID v = 0; ok && (v < size); v++)
+        ok = (fwrite(&VS[v].value, sizeof(T), 1, f) == 1);
+    
+    if ((fclose(f) != 0) || !ok)
+        throw MINGRAPH_ERR_WRITE;
+}
+
+/* ----------------------------------------------------------------------------
+   bool MinGraph::Load(const char *filename, HexThreadPool *pool=0);
+   
+   Replaces the graph with one written by Save(), copying each adjacency
+   list straight from a mapping of the file;  in parallel with a pool.
+   Returns false, leaving the graph empty, if the file cannot be read, is
+   not a graph file for this T, or is inconsistent.
+   ---------------------------------------------------------------------------- */
+template <class T>
+bool MinGraph<T>::Load(const char *filename, HexThreadPool *pool)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "MinGraph::Load needs trivially copyable values");
+    
+    MinGraphFile file;
+    
+    Reset(0);
+    if (!file.Open(filename) || (file.Size() < sizeof(MinGraphFileHeader)))
+        return false;
+    
+    const MinGraphFileHeader *header = (const MinGraphFileHeader *) file.Data();
+    uint64_t size = header->nVertices;
+    uint64_t expected = sizeof(MinGraphFileHeader) + (size + 1) * sizeof(uint64_t) +
+                        header->nAdjacency * sizeof(uint32_t) + size * sizeof(T);
+    
+    if ((memcmp(header->magic, MinGraphMagic, sizeof(MinGraphMagic)) != 0) || (header->valueSize != sizeof(T)) ||
+        (size > (uint64_t) std::numeric_limits<int>::max()) || (header->nAdjacency > file.Size()) ||
+        (expected != file.Size()))
+        return false;
+    
+    const uint64_t *offsets = (const uint64_t *) (header + 1);
+    const uint32_t *adjacency = (const uint32_t *) (offsets + size + 1);
+    const char *values = (const char *) (adjacency + header->nAdjacency);
+    
+    if ((offsets[0] != 0) || (offsets[size] != header->nAdjacency))
+        return false;
+    
+    Reset((int) size);
+    
+    unsigned int nChunks = (size + MINGRAPH_CHUNK - 1) / MINGRAPH_CHUNK;
+    std::vector<char> valid(nChunks);
+    
+    forChunks(nChunks, [&](unsigned int iChunk, unsigned int) {
+        unsigned int last = std::min((unsigned int) size, (iChunk + 1) * MINGRAPH_CHUNK);
+        bool ok = true;
+        for (VertexID v = iChunk * MINGRAPH_CHUNK; ok && (v < last); v++)
+        {
+            ok = (offsets[v] <= offsets[v + 1]) && (offsets[v + 1] <= header->nAdjacency);
+            if (ok)
+                VS[v].neighbors.assign(adjacency + offsets[v], adjacency + offsets[v + 1]);
+            for (unsigned int i = 0; ok && (i < VS[v].neighbors.size()); i++)
+                ok = (VS[v].neighbors[i] < size) && (VS[v].neighbors[i] != v);
+            memcpy(&VS[v].value, values + (size_t) v * sizeof(T), sizeof(T));
+        }
+        valid[iChunk] = ok;
+    }, pool);
+    
+    for (unsigned int iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+        if (!valid[iChunk])
+        {
+            Reset(0);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 #endif
@@ -0,0 +1,133 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mingraphfile.h"
+
+const char MinGraphMagic[8] = {'M', 'I', 'N', 'G', 'R', 'P', 'H', '1'};
+
+/* ============================================================================
+   MinGraphFile class
+   ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+   constructor, destructor
+    MinGraphFile(void)      -- no file
+    ~MinGraphFile(void)     -- unmaps the file, if any
+   ---------------------------------------------------------------------------- */
+MinGraphFile::MinGraphFile(void)
+{
+    mapping = (void *)0;
+    mappingSize = 0;
+}
+
+MinGraphFile::~MinGraphFile(void)
+{   Close();    }
+
+/* ----------------------------------------------------------------------------
+   bool MinGraphFile::Open(const char *filename);
+
+   Maps the given file.  Returns false if it does not exist, cannot be mapped
+   or is empty.
+   ---------------------------------------------------------------------------- */
+bool MinGraphFile::Open(const char *filename)
+{
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                          // the mapping stays valid
+
+    if (p == MAP_FAILED)
+        return false;
+
+    // loaders read the file front to back, several threads at a time
+    madvise(p, st.st_size, MADV_WILLNEED);
+
+    mapping = p;
+    mappingSize = st.st_size;
+    return true;
+}
+
+void MinGraphFile::Close(void)
+{
+    if (mapping != (void *)0)
+        munmap(mapping, mappingSize);
+
+    mapping = (void *)0;
+    mappingSize = 0;
+}
+
+const char *MinGraphFile::Data(void)
+{   return (const char *) mapping;  }
+
+size_t MinGraphFile::Size(void)
+{   return mappingSize; }
+
+/* ----------------------------------------------------------------------------
+   bool MinGraphFile::ParseEdges(size_t from, size_t to, std::vector<uint32_t> &ends);
+
+   Parses the text edge list lines that start at bytes [from, to) of the
+   file, appending both ends of each edge to ends.  A line belongs to the
+   range its first byte is in, so ranges that split the file parse every
+   line once.  Returns false on a malformed line.
+   ---------------------------------------------------------------------------- */
+bool MinGraphFile::ParseEdges(size_t from, size_t to, std::vector<uint32_t> &ends)
+{
+    const char *text = Data();
+    size_t i = from;
+
+    // skip the line that started before the range
+    if (i > 0)
+        while ((i < mappingSize) && (text[i - 1] != '\n'))
+            i++;
+
+    while (i < to)
+    {
+        unsigned int nFields = 0;
+
+        while ((i < mappingSize) && (text[i] != '\n'))
+        {
+            char c = text[i];
+
+            if ((c == ' ') || (c == '\t') || (c == '\r'))
+                i++;
+            else if (c == '#')
+            {
+                while ((i < mappingSize) && (text[i] != '\n'))
+                    i++;
+            }
+            else if ((c >= '0') && (c <= '9') && (nFields < 2))
+            {
+                uint64_t id = 0;
+                while ((i < mappingSize) && (text[i] >= '0') && (text[i] <= '9'))
+                {
+                    id = id * 10 + (text[i++] - '0');
+                    if (id > 0xFFFFFFFEu)
+                        return false;
+                }
+                ends.push_back((uint32_t) id);
+                nFields++;
+            }
+            else
+                return false;
+        }
+
+        if (nFields == 1)
+            return false;
+
+        i++;                            // past the newline
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef _MINGRAPHFILE_H_
+#define _MINGRAPHFILE_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/* ----------------------------------------------------------------------------
+   MinGraph files (MinGraph::Save, MinGraph::Load) are
+
+        MinGraphFileHeader
+        uint64_t offsets[nVertices + 1]     vertex v's neighbors are
+                                            adjacency[offsets[v], offsets[v + 1])
+        uint32_t adjacency[nAdjacency]      each edge appears at both ends
+        T values[nVertices]                 raw bytes, valueSize each
+
+   Edge lists (MinGraph::LoadEdges) are either binary, a plain array of
+   uint32_t vertex pairs, or text, one "u v" pair per line, separated by
+   blanks;  '#' starts a comment, and blank lines are ignored.
+
+   All values are in the byte order of the machine that wrote them.
+   ---------------------------------------------------------------------------- */
+typedef struct structMinGraphFileHeader {
+    char     magic[8];          // "MINGRPH1"
+    uint32_t nVertices;
+    uint32_t valueSize;         // sizeof(T)
+    uint64_t nAdjacency;        // twice the number of edges
+} MinGraphFileHeader;
+
+extern const char MinGraphMagic[8];
+
+/* ============================================================================
+   MinGraphFile class
+
+   A file mapped read-only, for MinGraph's loaders to read in place.
+   ============================================================================ */
+class MinGraphFile {
+    public:
+    MinGraphFile(void);
+    ~MinGraphFile(void);
+    bool Open(const char *filename);
+    void Close(void);
+    const char *Data(void);
+    size_t Size(void);
+    bool ParseEdges(size_t from, size_t to, std::vector<uint32_t> &ends);
+
+    private:
+    void *mapping;
+    size_t mappingSize;
+
+    // no copies, the mapping is owned by a single object
+    MinGraphFile(const MinGraphFile &);
+    MinGraphFile &operator=(const MinGraphFile &);
+};
+
+#endif
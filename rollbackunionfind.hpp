@@ -0,0 +1,188 @@
+#ifndef _ROLLBACKUNIONFIND_HPP_
+#define _ROLLBACKUNIONFIND_HPP_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "unionfind.h"
+
+/* ============================================================================
+   RollbackUnionFind class
+
+   Union-find that can undo its joins.  Union by size without path
+   compression keeps every tree at most log2(n) deep, and leaves each join as
+   a single parent link, recorded on a trail;  undoing a join unlinks it.
+
+    Checkpoint()    marks the current state
+    Rollback()      undoes every join since the most recent checkpoint, and
+                    removes that checkpoint
+    Reset(n)        with an unchanged n, undoes every join (only the elements
+                    that changed are touched)
+
+   Index is the unsigned type used for parents and sizes, so a Hex board
+   (at most 15 * 15 cells plus virtual edges) fits in bytes:  the number of
+   elements may not exceed the largest Index.
+   ============================================================================ */
+template <class Index>
+class RollbackUnionFind {
+    public:
+    RollbackUnionFind(void);
+    RollbackUnionFind(unsigned int size);
+    void Reset(unsigned int size);
+    bool Join(unsigned int i, unsigned int j);  // join elements i and j, false if already joined
+    unsigned int Find(unsigned int i);          // retrieve root of element i
+    unsigned int Size(unsigned int i);          // return size of element i's component
+    bool Connected(unsigned int i, unsigned int j);
+    void Checkpoint(void);
+    void Rollback(void);
+    unsigned int Changes(void);                 // joins since the most recent checkpoint
+
+    private:
+    typedef struct structRBNode {
+        Index parent;
+        Index size;
+    } RBNode;
+
+    std::vector<RBNode> items;
+    std::vector<Index> trail;                   // roots linked under another root, oldest first
+    std::vector<unsigned int> checkpoints;      // trail length at each checkpoint
+
+    unsigned int root(unsigned int i);
+    void undo(unsigned int length);
+};
+
+template <class Index>
+RollbackUnionFind<Index>::RollbackUnionFind(void) {}
+
+template <class Index>
+RollbackUnionFind<Index>::RollbackUnionFind(unsigned int size)
+{   Reset(size);    }
+
+/* ----------------------------------------------------------------------------
+   void RollbackUnionFind<Index>::Reset(unsigned int size);
+
+   Makes every element its own component and drops all checkpoints.  If size
+   is unchanged, only the joins on the trail are undone.  Throws
+   UNIONFIND_ERR_INVALIDSIZE if size does not fit in Index.
+   ---------------------------------------------------------------------------- */
+template <class Index>
+void RollbackUnionFind<Index>::Reset(unsigned int size)
+{
+    checkpoints.clear();
+
+    if (size == items.size())
+    {
+        undo(0);
+        return;
+    }
+
+    if (size > (unsigned long) std::numeric_limits<Index>::max())
+        throw UNIONFIND_ERR_INVALIDSIZE;
+
+    items.clear();
+    trail.clear();
+    items.resize(size);
+
+    if (items.size() != size)
+        throw UNIONFIND_ERR_OUTOFMEMORY;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        items[i].parent = i;
+        items[i].size = 1;
+    }
+}
+
+// join i and j, linking the smaller component under the larger;  returns false if already joined
+template <class Index>
+bool RollbackUnionFind<Index>::Join(unsigned int i, unsigned int j)
+{
+    if ((i >= items.size()) || (j >= items.size()))
+        throw UNIONFIND_ERR_INDEXOUTOFRANGE;
+
+    unsigned int pi = root(i);
+    unsigned int pj = root(j);
+
+    if (pi == pj)
+        return false;
+
+    if (items[pi].size > items[pj].size)
+        std::swap(pi, pj);
+
+    items[pi].parent = pj;
+    items[pj].size += items[pi].size;
+    trail.push_back(pi);
+    return true;
+}
+
+// retrieve root of given element
+template <class Index>
+unsigned int RollbackUnionFind<Index>::Find(unsigned int i)
+{
+    if (i >= items.size())
+        throw UNIONFIND_ERR_INDEXOUTOFRANGE;
+
+    return root(i);
+}
+
+// return size of given element's component
+template <class Index>
+unsigned int RollbackUnionFind<Index>::Size(unsigned int i)
+{   return items[Find(i)].size;    }
+
+// return true if i and j are in the same component
+template <class Index>
+bool RollbackUnionFind<Index>::Connected(unsigned int i, unsigned int j)
+{   return (Find(i) == Find(j));    }
+
+// mark the current state, to return to with Rollback()
+template <class Index>
+void RollbackUnionFind<Index>::Checkpoint(void)
+{   checkpoints.push_back(trail.size());    }
+
+/* ----------------------------------------------------------------------------
+   void RollbackUnionFind<Index>::Rollback(void);
+
+   Returns to the state of the most recent checkpoint, in time proportional
+   to the joins made since, and removes the checkpoint.  Throws
+   UNIONFIND_ERR_NOCHECKPOINT if there is none.
+   ---------------------------------------------------------------------------- */
+template <class Index>
+void RollbackUnionFind<Index>::Rollback(void)
+{
+    if (checkpoints.empty())
+        throw UNIONFIND_ERR_NOCHECKPOINT;
+
+    undo(checkpoints.back());
+    checkpoints.pop_back();
+}
+
+template <class Index>
+unsigned int RollbackUnionFind<Index>::Changes(void)
+{   return trail.size() - (checkpoints.empty() ? 0 : checkpoints.back());  }
+
+// follow parent links to the root, without compressing the path
+template <class Index>
+unsigned int RollbackUnionFind<Index>::root(unsigned int i)
+{
+    while (items[i].parent != i)
+        i = items[i].parent;
+
+    return i;
+}
+
+// undo joins, newest first, until the trail is down to length
+template <class Index>
+void RollbackUnionFind<Index>::undo(unsigned int length)
+{
+    while (trail.size() > length)
+    {
+        unsigned int child = trail.back();
+        trail.pop_back();
+
+        items[items[child].parent].size -= items[child].size;
+        items[child].parent = child;
+    }
+}
+
+#endif
@@ -6,7 +6,8 @@
 typedef enum enumUnionFindError {
     UNIONFIND_ERR_INDEXOUTOFRANGE,
     UNIONFIND_ERR_INVALIDSIZE,
-    UNIONFIND_ERR_OUTOFMEMORY
+    UNIONFIND_ERR_OUTOFMEMORY,
+    UNIONFIND_ERR_NOCHECKPOINT
     } UnionFindError;
     
 typedef struct structUFNode {